@@ -0,0 +1,83 @@
+﻿# include "ArrowRenderer.hpp"
+
+namespace
+{
+	ColorF LinkColor(char link)
+	{
+		return link == 1 ? ColorF(Palette::White) : ColorF(Palette::Black);
+	}
+}
+
+void ArrowRenderer::update(const core::Board& board, const Optional<core::Line>& dragArrow)
+{
+	mesh.update(board);
+
+	const auto& arrows = mesh.arrows();
+	const auto& vertices = mesh.vertices();
+	resize(arrows.size() + (dragArrow ? 1 : 0));
+
+	const auto write = [&](size_t arrow)
+	{
+		writeArrow(arrow, vertices.data() + arrow * core::ArrowMesh::VerticesPerArrow, LinkColor(arrows[arrow].link));
+	};
+
+	if (mesh.isRebuilt())
+	{
+		for (size_t arrow = 0; arrow < arrows.size(); ++arrow)
+		{
+			write(arrow);
+		}
+	}
+	else
+	{
+		for (const size_t arrow : mesh.changedArrows())
+		{
+			write(arrow);
+		}
+	}
+
+	if (dragArrow)
+	{
+		core::Vec2 positions[core::ArrowMesh::VerticesPerArrow];
+		core::ArrowMesh::BuildArrow(dragArrow.value(), 3.0, 15.0, positions);
+		writeArrow(arrows.size(), positions, Alpha(128));
+	}
+}
+
+void ArrowRenderer::resize(size_t arrowCount)
+{
+	buffers.resize((arrowCount + ArrowsPerBuffer - 1) / ArrowsPerBuffer);
+
+	for (size_t i = 0; i < buffers.size(); ++i)
+	{
+		Buffer2D& buffer = buffers[i];
+		const size_t count = std::min(ArrowsPerBuffer, arrowCount - i * ArrowsPerBuffer);
+		const size_t oldCount = buffer.vertices.size() / core::ArrowMesh::VerticesPerArrow;
+
+		buffer.vertices.resize(count * core::ArrowMesh::VerticesPerArrow);
+		buffer.indices.resize(count * core::ArrowMesh::TrianglesPerArrow);
+		for (size_t arrow = oldCount; arrow < count; ++arrow)
+		{
+			const auto first = static_cast<uint16>(arrow * core::ArrowMesh::VerticesPerArrow);
+			for (size_t t = 0; t < core::ArrowMesh::TrianglesPerArrow; ++t)
+			{
+				const auto& triangle = core::ArrowMesh::Triangles[t];
+				buffer.indices[arrow * core::ArrowMesh::TrianglesPerArrow + t] = { static_cast<uint16>(first + triangle[0]), static_cast<uint16>(first + triangle[1]), static_cast<uint16>(first + triangle[2]) };
+			}
+		}
+	}
+}
+
+void ArrowRenderer::writeArrow(size_t arrow, const core::Vec2* positions, const ColorF& color)
+{
+	Buffer2D& buffer = buffers[arrow / ArrowsPerBuffer];
+	const Float4 vertexColor = color.toFloat4();
+	Vertex2D* out = buffer.vertices.data() + (arrow % ArrowsPerBuffer) * core::ArrowMesh::VerticesPerArrow;
+
+	for (size_t i = 0; i < core::ArrowMesh::VerticesPerArrow; ++i)
+	{
+		out[i].pos = Float2(static_cast<float>(positions[i].x), static_cast<float>(positions[i].y));
+		out[i].tex = Float2(0.0f, 0.0f);
+		out[i].color = vertexColor;
+	}
+}
@@ -0,0 +1,44 @@
+﻿# pragma once
+# include <Siv3D.hpp>
+# include "Core/ArrowMesh.hpp"
+
+//盤面のリンクの矢印を白と黒をまとめて一つの Buffer2D にして、一回で描く
+//頂点番号が16ビットなので、矢印が ArrowsPerBuffer 本を超えるときだけ Buffer2D を分ける
+class ArrowRenderer
+{
+public:
+	//board に合わせて頂点を更新する、両端が動いていない矢印は作り直さない
+	//dragArrow: リンクを引いている途中の矢印、他の矢印と同じバッファの最後に半透明で入れる
+	void update(const core::Board& board, const Optional<core::Line>& dragArrow);
+
+	void draw()const
+	{
+		for (const auto& buffer : buffers)
+		{
+			buffer.draw();
+		}
+	}
+
+	//直前の update でリンクが付いたり消えたりしたか
+	bool isLinksChanged()const
+	{
+		return mesh.isRebuilt();
+	}
+
+	//描画の回数
+	size_t bufferCount()const
+	{
+		return buffers.size();
+	}
+
+private:
+	static constexpr size_t ArrowsPerBuffer = 65536 / core::ArrowMesh::VerticesPerArrow;
+
+	//矢印の本数を変える、増えた矢印の三角形の頂点番号もここで入れる
+	void resize(size_t arrowCount);
+
+	void writeArrow(size_t arrow, const core::Vec2* positions, const ColorF& color);
+
+	core::ArrowMesh mesh;
+	Array<Buffer2D> buffers;
+};
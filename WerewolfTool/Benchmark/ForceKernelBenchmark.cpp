@@ -0,0 +1,113 @@
+﻿# include <algorithm>
+# include <chrono>
+# include <cmath>
+# include <cstdio>
+# include <random>
+# include <vector>
+# include "Core/BoardGenerator.hpp"
+# include "Core/ForceKernel.hpp"
+# include "Core/NodeArrays.hpp"
+
+//総当たりの斥力計算について、core::Node の配列(AoS)をそのまま読む実装と
+//NodeArrays(SoA)に対する各カーネルの速度を比較する
+//usage: ForceKernelBenchmark
+
+namespace
+{
+	using core::Vec2;
+
+	constexpr double Strength = 0.2 * 300.0 * 300.0;
+
+	//分割前の Graph::physicsUpdate と同じ書き方
+	void RepulsionAoS(const std::vector<core::Node>& nodes, std::vector<Vec2>& forces)
+	{
+		forces.assign(nodes.size(), Vec2::Zero());
+		for (size_t me = 0; me < nodes.size(); ++me)
+		{
+			if (!nodes[me].isAutoLayout)
+			{
+				continue;
+			}
+
+			const Vec2 pos_me = nodes[me].position;
+			for (size_t other = 0; other < nodes.size(); ++other)
+			{
+				if (me == other)
+				{
+					continue;
+				}
+
+				const Vec2 relative = nodes[other].position - pos_me;
+				forces[me] += -Strength * relative / relative.dot(relative);
+			}
+		}
+	}
+
+	template <class Func>
+	double MeasureMs(Func func)
+	{
+		using Clock = std::chrono::steady_clock;
+		int count = 0;
+		const auto begin = Clock::now();
+		auto now = begin;
+		do
+		{
+			func();
+			++count;
+			now = Clock::now();
+		} while (now - begin < std::chrono::milliseconds(200));
+
+		return std::chrono::duration<double, std::milli>(now - begin).count() / count;
+	}
+}
+
+int main()
+{
+	const core::ForceKernel detected = core::DetectForceKernel();
+	std::printf("detected kernel: %s\n", core::ToString(detected));
+
+	std::vector<core::ForceKernel> kernels = { core::ForceKernel::Scalar };
+	if (detected != core::ForceKernel::Scalar)
+	{
+		kernels.push_back(core::ForceKernel::SSE2);
+	}
+	if (detected == core::ForceKernel::AVX2)
+	{
+		kernels.push_back(core::ForceKernel::AVX2);
+	}
+
+	std::printf("%8s %10s %12s %12s %10s %12s\n", "N", "kernel", "time[ms]", "ns/pair", "speedup", "max rel err");
+
+	for (const size_t n : { 16, 64, 256, 1024, 4096 })
+	{
+		const core::Board board = core::RandomBoard(n, 0, core::SceneForNodeCount(n), 1);
+
+		std::vector<Vec2> reference;
+		const double aosMs = MeasureMs([&] { RepulsionAoS(board.nodes, reference); });
+		const double pairs = static_cast<double>(n) * (n - 1);
+		std::printf("%8zu %10s %12.4f %12.3f %9.2fx %12s\n", n, "aos", aosMs, aosMs * 1e6 / pairs, 1.0, "-");
+
+		core::NodeArrays arrays;
+		arrays.load(board.nodes);
+		std::vector<double> fx(n);
+		std::vector<double> fy(n);
+
+		for (const auto kernel : kernels)
+		{
+			const double ms = MeasureMs([&]
+			{
+				std::fill(fx.begin(), fx.end(), 0.0);
+				std::fill(fy.begin(), fy.end(), 0.0);
+				core::AccumulateRepulsion(kernel, arrays.x.data(), arrays.y.data(), arrays.fixed.data(), n, Strength, 0, n, fx.data(), fy.data());
+			});
+
+			double maxError = 0.0;
+			for (size_t i = 0; i < n; ++i)
+			{
+				maxError = std::max(maxError, (Vec2(fx[i], fy[i]) - reference[i]).length() / reference[i].length());
+			}
+
+			std::printf("%8zu %10s %12.4f %12.3f %9.2fx %12.2e\n", n, core::ToString(kernel), ms, ms * 1e6 / pairs, aosMs / ms, maxError);
+		}
+	}
+}
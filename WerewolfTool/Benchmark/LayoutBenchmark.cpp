@@ -0,0 +1,433 @@
+﻿# include <chrono>
+# include <cmath>
+# include <cstdio>
+# include <cstdlib>
+# include <cstring>
+# include <functional>
+# include <iterator>
+# include <limits>
+# include <random>
+# include <string>
+# include <vector>
+# include "Core/BoardGenerator.hpp"
+# include "Core/Geometry.hpp"
+# include "Core/Layout.hpp"
+# include "Core/SceneClamp.hpp"
+
+//幾何の補助関数の一回あたりの時間と、生成した盤面でのレイアウトの速さと落ち着くまでの時間を測る
+//今後の最適化の比較の基準にする
+//最初に ClampToScene の結果が FixedPosVel と一致するかを確かめ、一致しなければ失敗で終わる
+//usage: LayoutBenchmark [--max-nodes=10000] [--budget=3] [--scenario=NAME] [--verify]
+
+namespace
+{
+	using core::Vec2;
+	using Clock = std::chrono::steady_clock;
+
+	//最適化で計算が消えないように結果を混ぜておく
+	volatile double sink = 0.0;
+
+	//func(i) を count 回呼ぶことを合計0.2秒以上になるまで繰り返し、一回あたりの時間[ns]を返す
+	template <class Func>
+	double MeasureNs(size_t count, Func func)
+	{
+		size_t calls = 0;
+		const auto begin = Clock::now();
+		auto now = begin;
+		do
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				func(i);
+			}
+			calls += count;
+			now = Clock::now();
+		} while (now - begin < std::chrono::milliseconds(200));
+
+		return std::chrono::duration<double, std::nano>(now - begin).count() / calls;
+	}
+
+	constexpr core::ForceKernel ClampKernels[] = { core::ForceKernel::Scalar, core::ForceKernel::SSE2, core::ForceKernel::AVX2 };
+
+	//NaN の符号と中身は演算の順で変わるので、NaN 同士は同じとみなす
+	bool SameBits(double a, double b)
+	{
+		if (a != a && b != b)
+		{
+			return true;
+		}
+		return std::memcmp(&a, &b, sizeof(double)) == 0;
+	}
+
+	//ClampToScene を各実装で呼び、一点ずつ FixedPosVel を呼んだ結果とビット単位で比べる
+	//境界ちょうどの値、四隅、NaN、無限大、画面より大きい半径、位置を固定した頂点を混ぜる
+	bool VerifyClampToScene()
+	{
+		constexpr size_t Count = 100003;
+		constexpr double Inf = std::numeric_limits<double>::infinity();
+		constexpr double NaN = std::numeric_limits<double>::quiet_NaN();
+		std::mt19937 rng(2024);
+
+		const core::RectF scene(0, 0, 1280, 720);
+		const double radii[] = { core::DefaultNodeRadius, core::DefaultNodeRadius, core::DefaultNodeRadius, 0.0, 10.5, 400.0, 700.0 };
+		std::uniform_int_distribution<size_t> radiusIndex(0, std::size(radii) - 1);
+		std::uniform_int_distribution<int> kind(0, 9);
+		std::uniform_real_distribution<double> unit(-0.5, 1.5);
+		std::uniform_real_distribution<double> v(-500.0, 500.0);
+
+		std::vector<double> radius(Count), x(Count), y(Count), vx(Count), vy(Count);
+		std::vector<std::uint8_t> fixed(Count);
+		for (size_t i = 0; i < Count; ++i)
+		{
+			radius[i] = radii[radiusIndex(rng)];
+			fixed[i] = kind(rng) == 0 ? 1 : 0;
+			vx[i] = v(rng);
+			vy[i] = v(rng);
+
+			//座標ごとに、範囲の端の値か特殊な値かふつうの乱数を選ぶ
+			const core::RectF scope = scene.stretched(-radius[i], -radius[i]);
+			const auto coordinate = [&](double begin, double length)
+			{
+				switch (kind(rng))
+				{
+				case 0: return begin;
+				case 1: return begin + length;
+				case 2: return begin + length + 1.0;
+				case 3: return std::nextafter(begin, -Inf);
+				case 4:
+				{
+					const double specials[] = { NaN, Inf, -Inf, -0.0, 1e300, -1e300 };
+					return specials[std::uniform_int_distribution<size_t>(0, std::size(specials) - 1)(rng)];
+				}
+				default: return begin + length * unit(rng);
+				}
+			};
+			x[i] = coordinate(scope.pos.x, scope.size.x);
+			y[i] = coordinate(scope.pos.y, scope.size.y);
+		}
+
+		std::vector<double> expectedX = x, expectedY = y, expectedVx = vx, expectedVy = vy;
+		for (size_t i = 0; i < Count; ++i)
+		{
+			if (fixed[i])
+			{
+				continue;
+			}
+			const auto posVel = core::FixedPosVel(Vec2(x[i], y[i]), Vec2(vx[i], vy[i]), scene.stretched(-radius[i], -radius[i]));
+			expectedX[i] = posVel.first.x;
+			expectedY[i] = posVel.first.y;
+			expectedVx[i] = posVel.second.x;
+			expectedVy[i] = posVel.second.y;
+		}
+
+		bool isSame = true;
+		for (const auto kernel : ClampKernels)
+		{
+			std::vector<double> cx = x, cy = y, cvx = vx, cvy = vy;
+			//区間の途中から始めて、端数の処理も通す
+			core::ClampToScene(kernel, scene, radius.data(), fixed.data(), 0, 3, cx.data(), cy.data(), cvx.data(), cvy.data());
+			core::ClampToScene(kernel, scene, radius.data(), fixed.data(), 3, Count, cx.data(), cy.data(), cvx.data(), cvy.data());
+
+			size_t mismatches = 0;
+			for (size_t i = 0; i < Count; ++i)
+			{
+				if (!SameBits(cx[i], expectedX[i]) || !SameBits(cy[i], expectedY[i]) || !SameBits(cvx[i], expectedVx[i]) || !SameBits(cvy[i], expectedVy[i]))
+				{
+					if (mismatches++ == 0)
+					{
+						std::printf("ClampToScene/%s differs at %zu: (%g, %g) -> (%g, %g) v(%g, %g), expected (%g, %g) v(%g, %g)\n",
+							core::ToString(core::ResolveForceKernel(kernel)), i, x[i], y[i], cx[i], cy[i], cvx[i], cvy[i],
+							expectedX[i], expectedY[i], expectedVx[i], expectedVy[i]);
+					}
+				}
+			}
+
+			std::printf("ClampToScene/%-6s %s (%zu points, %zu mismatches)\n", core::ToString(core::ResolveForceKernel(kernel)),
+				mismatches == 0 ? "matches FixedPosVel" : "DIFFERS from FixedPosVel", Count, mismatches);
+			isSame = isSame && mismatches == 0;
+		}
+		return isSame;
+	}
+
+	//同じ点を Batch 個ずつまとめて戻す、一点あたりの時間(どれも入力を書き戻す時間を含む)
+	//比べる基準は、同じ配列に一点ずつ FixedPosVel を呼ぶループ(ClampToScene を使う前の Layout と同じ書き方)
+	void BenchmarkClamp(const char* label, const core::RectF& scene, const std::vector<Vec2>& positions, const std::vector<Vec2>& velocities)
+	{
+		constexpr size_t Batch = 64;
+		const size_t count = positions.size();
+		std::vector<double> sourceX(count), sourceY(count), sourceVx(count), sourceVy(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			sourceX[i] = positions[i].x;
+			sourceY[i] = positions[i].y;
+			sourceVx[i] = velocities[i].x;
+			sourceVy[i] = velocities[i].y;
+		}
+		const std::vector<double> radius(Batch, core::DefaultNodeRadius);
+		const std::vector<std::uint8_t> fixed(Batch, 0);
+		double bx[Batch], by[Batch], bvx[Batch], bvy[Batch];
+
+		const auto measure = [&](const std::string& name, const auto& clamp)
+		{
+			std::printf("  %-24s %10.2f\n", name.c_str(), MeasureNs(count / Batch, [&](size_t chunk)
+			{
+				const size_t offset = chunk * Batch;
+				std::memcpy(bx, sourceX.data() + offset, sizeof(bx));
+				std::memcpy(by, sourceY.data() + offset, sizeof(by));
+				std::memcpy(bvx, sourceVx.data() + offset, sizeof(bvx));
+				std::memcpy(bvy, sourceVy.data() + offset, sizeof(bvy));
+				clamp();
+				sink = sink + bx[Batch - 1] + bvy[0];
+			}) / Batch);
+		};
+
+		std::printf("%s:\n", label);
+		measure("FixedPosVel loop", [&]
+		{
+			for (size_t i = 0; i < Batch; ++i)
+			{
+				if (fixed[i])
+				{
+					continue;
+				}
+				const auto posVel = core::FixedPosVel(Vec2(bx[i], by[i]), Vec2(bvx[i], bvy[i]), scene.stretched(-radius[i], -radius[i]));
+				bx[i] = posVel.first.x;
+				by[i] = posVel.first.y;
+				bvx[i] = posVel.second.x;
+				bvy[i] = posVel.second.y;
+			}
+		});
+		for (const auto kernel : ClampKernels)
+		{
+			measure(std::string("ClampToScene/") + core::ToString(core::ResolveForceKernel(kernel)), [&]
+			{
+				core::ClampToScene(kernel, scene, radius.data(), fixed.data(), 0, Batch, bx, by, bvx, bvy);
+			});
+		}
+	}
+
+	void BenchmarkHelpers()
+	{
+		constexpr size_t Count = 4096;
+		std::mt19937 rng(12345);
+
+		//画面の少し外まで散らして、内側、辺、四隅の場合が混ざるようにする
+		const core::RectF scene(0, 0, 1280, 720);
+		const core::RectF spread = scene.stretched(200, 200);
+		std::uniform_real_distribution<double> x(spread.pos.x, spread.br().x);
+		std::uniform_real_distribution<double> y(spread.pos.y, spread.br().y);
+		std::uniform_real_distribution<double> v(-500.0, 500.0);
+
+		std::vector<Vec2> positions(Count);
+		std::vector<Vec2> others(Count);
+		std::vector<Vec2> velocities(Count);
+		for (size_t i = 0; i < Count; ++i)
+		{
+			positions[i] = Vec2(x(rng), y(rng));
+			others[i] = Vec2(x(rng), y(rng));
+			velocities[i] = Vec2(v(rng), v(rng));
+		}
+
+		const core::RectF field = scene.stretched(-core::DefaultNodeRadius, -core::DefaultNodeRadius);
+
+		std::printf("%-20s %10s\n", "helper", "ns/op");
+
+		std::printf("%-20s %10.2f\n", "FixedPosVel", MeasureNs(Count, [&](size_t i)
+		{
+			const auto result = core::FixedPosVel(positions[i], velocities[i], field);
+			sink = sink + result.first.x + result.second.y;
+		}));
+
+		std::printf("%-20s %10.2f\n", "FixedRectPos", MeasureNs(Count, [&](size_t i)
+		{
+			const Vec2 result = core::FixedRectPos(core::RectF(positions[i], Vec2(256, 384)), scene);
+			sink = sink + result.x;
+		}));
+
+		std::printf("%-20s %10.2f\n", "CutoffLine", MeasureNs(Count, [&](size_t i)
+		{
+			if (const auto line = core::CutoffLine(core::Line(positions[i], others[i]), core::DefaultNodeRadius, core::DefaultNodeRadius))
+			{
+				sink = sink + line->begin.x;
+			}
+		}));
+
+		std::printf("%-20s %10.2f\n", "Line::intersects", MeasureNs(Count, [&](size_t i)
+		{
+			const size_t j = (i + 1) % Count;
+			sink = sink + (core::Line(positions[i], others[i]).intersects(core::Line(positions[j], others[j])) ? 1.0 : 0.0);
+		}));
+
+		//ClampToScene と、同じことを一点ずつ行うループの比較
+		BenchmarkClamp("clamp, mixed", scene, positions, velocities);
+
+		//実際の盤面に近い、ほとんどの頂点が画面の中にあり、少しだけはみ出した頂点が混ざる場合
+		{
+			std::bernoulli_distribution isOutside(0.03);
+			const core::RectF inner = field.stretched(-1.0, -1.0);
+			const core::RectF outer = field.stretched(50.0, 50.0);
+			std::uniform_real_distribution<double> innerX(inner.pos.x, inner.br().x);
+			std::uniform_real_distribution<double> innerY(inner.pos.y, inner.br().y);
+			std::uniform_real_distribution<double> nearX(outer.pos.x, outer.br().x);
+			std::uniform_real_distribution<double> nearY(outer.pos.y, outer.br().y);
+			std::vector<Vec2> mostlyInside(Count);
+			for (auto& position : mostlyInside)
+			{
+				position = isOutside(rng) ? Vec2(nearX(rng), nearY(rng)) : Vec2(innerX(rng), innerY(rng));
+			}
+			BenchmarkClamp("clamp, mostly inside", scene, mostlyInside, velocities);
+		}
+	}
+
+	struct Scenario
+	{
+		std::string name;
+
+		//ノード数 → 盤面
+		std::function<core::Board(size_t, const core::RectF&)> generate;
+	};
+
+	std::vector<Scenario> Scenarios()
+	{
+		constexpr std::uint32_t Seed = 1;
+		return {
+			{ "random-1", [](size_t n, const core::RectF& scene) { return core::RandomBoard(n, n, scene, Seed); } },
+			{ "random-3", [](size_t n, const core::RectF& scene) { return core::RandomBoard(n, 3 * n, scene, Seed); } },
+			{ "star", [](size_t n, const core::RectF& scene) { return core::StarBoard(n, scene, Seed); } },
+			{ "chain", [](size_t n, const core::RectF& scene) { return core::ChainBoard(n, scene, Seed); } },
+			{ "clustered-1", [](size_t n, const core::RectF& scene) { return core::ClusteredBoard(n, std::max<size_t>(2, n / 8), n, scene, Seed); } },
+			{ "clustered-3", [](size_t n, const core::RectF& scene) { return core::ClusteredBoard(n, std::max<size_t>(2, n / 8), 3 * n, scene, Seed); } },
+		};
+	}
+
+	//一回の積分(Layout::step)の速さ
+	double StepsPerSecond(core::Board board, const core::RectF& scene)
+	{
+		core::Layout layout;
+		long long steps = 0;
+		const auto begin = Clock::now();
+		auto now = begin;
+		do
+		{
+			layout.step(board, scene);
+			++steps;
+			now = Clock::now();
+		} while (steps < 3 || now - begin < std::chrono::milliseconds(200));
+
+		return steps / std::chrono::duration<double>(now - begin).count();
+	}
+
+	struct Convergence
+	{
+		bool isSettled = false;
+		long long frames = 0;
+		double wallSeconds = 0.0;
+	};
+
+	//update(dt * subSteps 進める)を落ち着くまで繰り返す、budgetSeconds を超えたら打ち切る
+	Convergence TimeToConverge(core::Board board, const core::RectF& scene, double budgetSeconds)
+	{
+		core::Layout layout;
+		Convergence result;
+		const auto begin = Clock::now();
+		while (!layout.isSettled())
+		{
+			layout.resetInvalidNodes(board, scene);
+			layout.update(board, scene);
+			++result.frames;
+
+			result.wallSeconds = std::chrono::duration<double>(Clock::now() - begin).count();
+			if (budgetSeconds < result.wallSeconds)
+			{
+				return result;
+			}
+		}
+		result.isSettled = true;
+		return result;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	size_t maxNodes = 10000;
+	double budget = 3.0;
+	std::string scenarioFilter;
+	bool verifyOnly = false;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strncmp(argv[i], "--max-nodes=", 12) == 0)
+		{
+			maxNodes = static_cast<size_t>(std::atoll(argv[i] + 12));
+		}
+		else if (std::strncmp(argv[i], "--budget=", 9) == 0)
+		{
+			budget = std::atof(argv[i] + 9);
+		}
+		else if (std::strncmp(argv[i], "--scenario=", 11) == 0)
+		{
+			scenarioFilter = argv[i] + 11;
+		}
+		else if (std::strcmp(argv[i], "--verify") == 0)
+		{
+			verifyOnly = true;
+		}
+		else
+		{
+			std::fprintf(stderr, "usage: %s [--max-nodes=10000] [--budget=3] [--scenario=NAME] [--verify]\n", argv[0]);
+			std::fprintf(stderr, "  --budget: seconds of wall time allowed for each time-to-converge run\n");
+			std::fprintf(stderr, "  --scenario: random-1, random-3, star, chain, clustered-1 or clustered-3 (default all)\n");
+			std::fprintf(stderr, "  --verify: only check that ClampToScene matches FixedPosVel\n");
+			return 1;
+		}
+	}
+
+	if (!VerifyClampToScene())
+	{
+		return 1;
+	}
+	if (verifyOnly)
+	{
+		return 0;
+	}
+	std::printf("\n");
+
+	BenchmarkHelpers();
+
+	const core::LayoutParams params;
+	const double frameSeconds = params.dt * params.subSteps;
+
+	std::printf("\n%-12s %6s %7s %12s %10s %12s %12s\n", "scenario", "N", "links", "steps/s", "frames", "sim [s]", "wall [s]");
+	for (const auto& scenario : Scenarios())
+	{
+		if (!scenarioFilter.empty() && scenario.name != scenarioFilter)
+		{
+			continue;
+		}
+
+		for (const size_t n : { 8, 32, 128, 512, 2048, 10000 })
+		{
+			if (maxNodes < n)
+			{
+				continue;
+			}
+
+			const core::RectF scene = core::SceneForNodeCount(n);
+			const core::Board board = scenario.generate(n, scene);
+
+			const double stepsPerSecond = StepsPerSecond(board, scene);
+			const Convergence convergence = TimeToConverge(board, scene, budget);
+
+			std::printf("%-12s %6zu %7zu %12.1f", scenario.name.c_str(), n, board.adjacents.size(), stepsPerSecond);
+			//打ち切ったときは、そこまでの値に > を付ける
+			const char* mark = convergence.isSettled ? "" : ">";
+			char frames[32];
+			char simulated[32];
+			char wall[32];
+			std::snprintf(frames, sizeof(frames), "%s%lld", mark, convergence.frames);
+			std::snprintf(simulated, sizeof(simulated), "%s%.2f", mark, convergence.frames * frameSeconds);
+			std::snprintf(wall, sizeof(wall), "%s%.3f", mark, convergence.wallSeconds);
+			std::printf(" %10s %12s %12s\n", frames, simulated, wall);
+			std::fflush(stdout);
+		}
+	}
+}
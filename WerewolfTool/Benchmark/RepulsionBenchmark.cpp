@@ -0,0 +1,180 @@
+﻿# include <chrono>
+# include <cmath>
+# include <cstdio>
+# include <cstdlib>
+# include <cstring>
+# include <random>
+# include <vector>
+# include "Core/QuadTree.hpp"
+
+//総当たりとBarnes-Hut近似の斥力計算の速度と誤差を比較する
+//usage: RepulsionBenchmark [--theta=0.5] [--steps=50]
+
+namespace
+{
+	using core::Vec2;
+
+	//Graph::physicsUpdate と同じ定数
+	constexpr double K = 300.0;
+	constexpr double C = 0.2;
+	constexpr double Strength = C * K * K;
+	constexpr double Dt = 0.005;
+	constexpr double Resistance = 0.995;
+
+	//15人村を1280x720に置いたときと同じ密度になるように盤面を広げる
+	std::vector<Vec2> RandomBoard(size_t n, std::mt19937& rng, Vec2& center)
+	{
+		const double scale = std::sqrt(std::max(1.0, n / 15.0));
+		const Vec2 size(1280.0 * scale, 720.0 * scale);
+		center = size * 0.5;
+
+		std::uniform_real_distribution<double> dx(0.0, size.x);
+		std::uniform_real_distribution<double> dy(0.0, size.y);
+
+		std::vector<Vec2> points(n);
+		for (auto& p : points)
+		{
+			p = Vec2(dx(rng), dy(rng));
+		}
+		return points;
+	}
+
+	void BruteForce(const std::vector<Vec2>& points, std::vector<Vec2>& forces)
+	{
+		forces.assign(points.size(), Vec2::Zero());
+		for (size_t me = 0; me < points.size(); ++me)
+		{
+			for (size_t other = 0; other < points.size(); ++other)
+			{
+				if (me == other)
+				{
+					continue;
+				}
+
+				const Vec2 relative = points[other] - points[me];
+				forces[me] += -Strength * relative / relative.dot(relative);
+			}
+		}
+	}
+
+	void BarnesHut(core::QuadTree& tree, const std::vector<Vec2>& points, double theta, std::vector<Vec2>& forces)
+	{
+		tree.build(points);
+		forces.resize(points.size());
+		for (size_t me = 0; me < points.size(); ++me)
+		{
+			forces[me] = tree.repulsion(me, Strength, theta);
+		}
+	}
+
+	//一回あたりの所要時間[ms]を、合計0.2秒以上になるまで繰り返して測る
+	template <class Func>
+	double MeasureMs(Func func)
+	{
+		using Clock = std::chrono::steady_clock;
+		int count = 0;
+		const auto begin = Clock::now();
+		auto now = begin;
+		do
+		{
+			func();
+			++count;
+			now = Clock::now();
+		} while (now - begin < std::chrono::milliseconds(200));
+
+		return std::chrono::duration<double, std::milli>(now - begin).count() / count;
+	}
+
+	//求心力 + 斥力のみで steps 回積分し、最終位置を返す
+	template <class RepulsionFunc>
+	std::vector<Vec2> Simulate(std::vector<Vec2> points, const Vec2& center, int steps, RepulsionFunc repulsion)
+	{
+		std::vector<Vec2> velocities(points.size(), Vec2::Zero());
+		std::vector<Vec2> forces;
+		for (int i = 0; i < steps; ++i)
+		{
+			repulsion(points, forces);
+			for (size_t me = 0; me < points.size(); ++me)
+			{
+				forces[me] += 0.5 * points[me].distanceFrom(center) * (center - points[me]) / K;
+				const Vec2 position = points[me] + velocities[me] * Dt;
+				velocities[me] = (velocities[me] + forces[me] * Dt) * Resistance;
+				points[me] = position;
+			}
+		}
+		return points;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	double theta = 0.5;
+	int steps = 50;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strncmp(argv[i], "--theta=", 8) == 0)
+		{
+			theta = std::atof(argv[i] + 8);
+		}
+		else if (std::strncmp(argv[i], "--steps=", 8) == 0)
+		{
+			steps = std::atoi(argv[i] + 8);
+		}
+		else
+		{
+			std::fprintf(stderr, "usage: %s [--theta=0.5] [--steps=50]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	std::printf("theta = %.3f, layout steps = %d\n", theta, steps);
+	std::printf("%8s %14s %14s %9s %14s %14s %16s\n", "N", "brute[ms]", "barnes-hut[ms]", "speedup", "rms force err", "max force err", "layout dev / K");
+
+	std::mt19937 rng(12345);
+	core::QuadTree tree;
+
+	for (const size_t n : { 16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 10000 })
+	{
+		Vec2 center;
+		const std::vector<Vec2> points = RandomBoard(n, rng, center);
+
+		std::vector<Vec2> exact;
+		std::vector<Vec2> approx;
+		const double bruteMs = MeasureMs([&] { BruteForce(points, exact); });
+		const double barnesHutMs = MeasureMs([&] { BarnesHut(tree, points, theta, approx); });
+
+		double errorSq = 0.0;
+		double normSq = 0.0;
+		double maxError = 0.0;
+		for (size_t i = 0; i < n; ++i)
+		{
+			const double e = (approx[i] - exact[i]).length();
+			errorSq += e * e;
+			normSq += exact[i].lengthSq();
+			maxError = std::max(maxError, e / exact[i].length());
+		}
+
+		//総当たりの積分はNが大きいと時間がかかりすぎるので打ち切る
+		double deviation = -1.0;
+		if (n <= 2048)
+		{
+			const auto a = Simulate(points, center, steps, [&](const std::vector<Vec2>& p, std::vector<Vec2>& f) { BruteForce(p, f); });
+			const auto b = Simulate(points, center, steps, [&](const std::vector<Vec2>& p, std::vector<Vec2>& f) { BarnesHut(tree, p, theta, f); });
+			deviation = 0.0;
+			for (size_t i = 0; i < n; ++i)
+			{
+				deviation = std::max(deviation, (a[i] - b[i]).length() / K);
+			}
+		}
+
+		std::printf("%8zu %14.4f %14.4f %8.2fx %14.2e %14.2e", n, bruteMs, barnesHutMs, bruteMs / barnesHutMs, std::sqrt(errorSq / normSq), maxError);
+		if (0.0 <= deviation)
+		{
+			std::printf(" %16.2e\n", deviation);
+		}
+		else
+		{
+			std::printf(" %16s\n", "-");
+		}
+	}
+}
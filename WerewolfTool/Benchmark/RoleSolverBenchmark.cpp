@@ -0,0 +1,453 @@
+﻿# include <algorithm>
+# include <array>
+# include <chrono>
+# include <cmath>
+# include <cstdio>
+# include <cstdlib>
+# include <cstring>
+# include <random>
+# include <tuple>
+# include <vector>
+# include "Core/RoleEngine.hpp"
+# include "Core/RoleSolver.hpp"
+
+//ランダムに進めた村の盤面で、役職の割り当てを数える時間を測る
+//最初に小さな村で、全ての割り当てを一つずつ調べた結果と一致するかを確かめ、一致しなければ失敗で終わる
+//続けて、リンクを一本足したときと元に戻したときに IncrementalRoleSolver で数え直す時間を測る
+//usage: RoleSolverBenchmark [--boards=50] [--verify]
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+	using core::Role;
+
+	//本当の役職を決めてから、それに沿って CO と占い・霊媒の結果、吊りと噛みを作る
+	//偽物の結果は色をランダムに選ぶ
+	core::Board RandomVillage(size_t players, const core::VillageRules& rules, int days, std::mt19937& rng)
+	{
+		std::vector<Role> roles;
+		for (size_t role = 0; role < core::RoleCount; ++role)
+		{
+			roles.insert(roles.end(), std::max(0, rules.count(static_cast<Role>(role), players)), static_cast<Role>(role));
+		}
+		std::shuffle(roles.begin(), roles.end(), rng);
+
+		std::bernoulli_distribution coin(0.5);
+		core::Board board{ std::vector<core::Node>(players) };
+		for (size_t i = 0; i < players; ++i)
+		{
+			core::Node& node = board.nodes[i];
+			switch (roles[i])
+			{
+			case Role::Seer:
+				node.co = core::Node::Fortuneteller;
+				break;
+			case Role::Medium:
+				node.co = core::Node::Spiritualist;
+				break;
+			case Role::Hunter:
+				node.co = coin(rng) ? core::Node::Hunter : core::Node::None;
+				break;
+			case Role::Madman:
+				node.co = coin(rng) ? core::Node::Fortuneteller : core::Node::Spiritualist;
+				break;
+			case Role::Werewolf:
+				node.co = std::bernoulli_distribution(0.3)(rng) ? core::Node::Fortuneteller : core::Node::None;
+				break;
+			default:
+				break;
+			}
+		}
+
+		std::uniform_int_distribution<size_t> pick(0, players - 1);
+		const auto randomOther = [&](size_t me)
+		{
+			size_t other = pick(rng);
+			while (other == me)
+			{
+				other = pick(rng);
+			}
+			return other;
+		};
+
+		//一日ごとに、一人吊って人狼以外を一人噛み、占い師COは一人ずつ結果を出す
+		for (int day = 0; day < days; ++day)
+		{
+			for (size_t i = 0; i < players; ++i)
+			{
+				if (board.nodes[i].co != core::Node::Fortuneteller || board.nodes[i].state != core::Node::Alive)
+				{
+					continue;
+				}
+				const size_t target = randomOther(i);
+				const bool isBlack = roles[i] == Role::Seer ? roles[target] == Role::Werewolf : std::bernoulli_distribution(0.3)(rng);
+				board.setLink(static_cast<int>(i), static_cast<int>(target), isBlack ? 2 : 1);
+			}
+
+			const size_t hanged = pick(rng);
+			if (board.nodes[hanged].state == core::Node::Alive)
+			{
+				board.nodes[hanged].state = core::Node::Hanged;
+				for (size_t i = 0; i < players; ++i)
+				{
+					if (board.nodes[i].co == core::Node::Spiritualist && board.nodes[i].state == core::Node::Alive)
+					{
+						const bool isBlack = roles[i] == Role::Medium ? roles[hanged] == Role::Werewolf : coin(rng);
+						board.setLink(static_cast<int>(i), static_cast<int>(hanged), isBlack ? 2 : 1);
+					}
+				}
+			}
+
+			const size_t bitten = pick(rng);
+			if (board.nodes[bitten].state == core::Node::Alive && roles[bitten] != Role::Werewolf)
+			{
+				board.nodes[bitten].state = core::Node::Bitten;
+			}
+		}
+		return board;
+	}
+
+	//全ての割り当てを作って、盤面と矛盾しないものを数える
+	class BruteForce
+	{
+	public:
+		BruteForce(const core::Board& board, const core::VillageRules& rules)
+			: board(board)
+			, rules(rules)
+			, roles(board.size())
+		{
+			for (size_t role = 0; role < core::RoleCount; ++role)
+			{
+				rest[role] = rules.count(static_cast<Role>(role), board.size());
+			}
+			result.probabilities.assign(board.size(), {});
+		}
+
+		core::RoleSolution solve()
+		{
+			if (std::all_of(rest.begin(), rest.end(), [](int count) { return 0 <= count; }))
+			{
+				assign(0);
+			}
+			for (auto& probability : result.probabilities)
+			{
+				for (auto& value : probability)
+				{
+					value = 0.0 < result.worlds ? value / result.worlds : 0.0;
+				}
+			}
+			return result;
+		}
+
+	private:
+		void assign(size_t i)
+		{
+			if (i == roles.size())
+			{
+				if (isConsistent())
+				{
+					result.worlds += 1.0;
+					for (size_t p = 0; p < roles.size(); ++p)
+					{
+						result.probabilities[p][static_cast<size_t>(roles[p])] += 1.0;
+					}
+				}
+				return;
+			}
+
+			for (size_t role = 0; role < core::RoleCount; ++role)
+			{
+				if (0 < rest[role])
+				{
+					--rest[role];
+					roles[i] = static_cast<Role>(role);
+					assign(i + 1);
+					++rest[role];
+				}
+			}
+		}
+
+		bool isConsistent()const
+		{
+			int aliveWolves = 0;
+			int alive = 0;
+			for (size_t i = 0; i < roles.size(); ++i)
+			{
+				const core::Node& node = board.nodes[i];
+				const Role role = roles[i];
+				const bool isLiar = role == Role::Werewolf || role == Role::Madman;
+				if ((node.co == core::Node::Fortuneteller && role != Role::Seer && !isLiar)
+					|| (node.co == core::Node::Spiritualist && role != Role::Medium && !isLiar)
+					|| (node.co == core::Node::Hunter && role != Role::Hunter && !isLiar)
+					|| (node.co == core::Node::Madman && !isLiar)
+					|| (node.state == core::Node::Bitten && role == Role::Werewolf))
+				{
+					return false;
+				}
+				alive += node.state == core::Node::Alive ? 1 : 0;
+				aliveWolves += node.state == core::Node::Alive && role == Role::Werewolf ? 1 : 0;
+			}
+
+			if (rules.gameContinues && (aliveWolves < 1 || alive - aliveWolves <= aliveWolves))
+			{
+				return false;
+			}
+
+			for (const auto& edge : board.adjacents.edges())
+			{
+				const Role role = roles[edge.from];
+				const bool isTrue = (role == Role::Seer && board.nodes[edge.from].co == core::Node::Fortuneteller)
+					|| (role == Role::Medium && board.nodes[edge.from].co == core::Node::Spiritualist);
+				if (isTrue && (roles[edge.to] == Role::Werewolf) != (edge.color == 2))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		const core::Board& board;
+		const core::VillageRules& rules;
+		std::vector<Role> roles;
+		std::array<int, core::RoleCount> rest{};
+		core::RoleSolution result;
+	};
+
+	bool VerifySolveRoles()
+	{
+		std::mt19937 rng(1);
+		int mismatches = 0;
+		int boards = 0;
+		for (const size_t players : { 5, 7, 8, 9, 10 })
+		{
+			for (const bool gameContinues : { true, false })
+			{
+				for (int days = 0; days <= 3; ++days)
+				{
+					for (int trial = 0; trial < 10; ++trial)
+					{
+						core::VillageRules rules = core::VillageRules::ForPopulation(players);
+						rules.gameContinues = gameContinues;
+						const core::Board board = RandomVillage(players, rules, days, rng);
+						const auto expected = BruteForce(board, rules).solve();
+						const auto actual = core::SolveRoles(board, rules);
+						++boards;
+
+						bool isSame = expected.worlds == actual.worlds;
+						for (size_t i = 0; i < players && isSame; ++i)
+						{
+							for (size_t role = 0; role < core::RoleCount; ++role)
+							{
+								isSame = isSame && std::abs(expected.probabilities[i][role] - actual.probabilities[i][role]) < 1e-9;
+							}
+						}
+
+						if (!isSame && mismatches++ < 5)
+						{
+							std::printf("mismatch: %zu players, %d days: %.0f worlds expected, %.0f found\n", players, days, expected.worlds, actual.worlds);
+						}
+					}
+				}
+			}
+		}
+
+		std::printf("SolveRoles vs brute force: %d boards, %d mismatches\n", boards, mismatches);
+		return mismatches == 0;
+	}
+
+	bool IsSameSolution(const core::RoleSolution& expected, const core::RoleSolution& actual)
+	{
+		const auto isClose = [](double a, double b)
+		{
+			return std::abs(a - b) <= 1e-9 * std::max(1.0, std::max(std::abs(a), std::abs(b)));
+		};
+
+		if (!isClose(expected.worlds, actual.worlds) || expected.probabilities.size() != actual.probabilities.size())
+		{
+			return false;
+		}
+		for (size_t i = 0; i < expected.probabilities.size(); ++i)
+		{
+			for (size_t role = 0; role < core::RoleCount; ++role)
+			{
+				if (!isClose(expected.probabilities[i][role], actual.probabilities[i][role]))
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	//占い師COしたプレイヤーから、まだ結果を出していないプレイヤーへ白を一本足す、足せなければ false
+	bool AddRandomResult(core::Board& board, std::mt19937& rng, int& from, int& to)
+	{
+		std::vector<std::pair<int, int>> candidates;
+		const int players = static_cast<int>(board.nodes.size());
+		for (int i = 0; i < players; ++i)
+		{
+			if (board.nodes[i].co != core::Node::Fortuneteller)
+			{
+				continue;
+			}
+			for (int j = 0; j < players; ++j)
+			{
+				if (i != j && board.link(i, j) == 0)
+				{
+					candidates.emplace_back(i, j);
+				}
+			}
+		}
+		if (candidates.empty())
+		{
+			return false;
+		}
+
+		std::tie(from, to) = candidates[std::uniform_int_distribution<size_t>(0, candidates.size() - 1)(rng)];
+		board.setLink(from, to, 1);
+		return true;
+	}
+
+	//func を呼んで、かかった時間を ms に足す
+	template <class Func>
+	auto Timed(double& ms, Func func)
+	{
+		const auto begin = Clock::now();
+		auto result = func();
+		ms += std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+		return result;
+	}
+
+	//リンクを足して数え直し、外して数え直した結果が SolveRoles と一致するかを確かめながら時間を測る
+	//時間はどれも盤面から RoleConstraints を作るところから測り、solve はリンクを足した盤面を SolveRoles で数えた時間
+	//人狼の多い大きな村では探索が大きくなり、部分問題に分けて数える
+	bool MeasureIncremental(int boardCount)
+	{
+		struct Village
+		{
+			size_t players;
+			int werewolves;
+			int days;
+		};
+
+		std::printf("\n%8s %6s %8s %12s %12s %12s %12s %10s %10s %10s\n", "players", "wolves", "threads", "solve [ms]", "cold [ms]", "edit [ms]", "undo [ms]", "cached", "solved", "stolen");
+		std::mt19937 rng(3);
+		int mismatches = 0;
+		for (const Village& village : { Village{ 15, 3, 2 }, Village{ 20, 3, 2 }, Village{ 30, 7, 5 }, Village{ 40, 7, 5 } })
+		{
+			core::VillageRules rules = core::VillageRules::ForPopulation(village.players);
+			rules.werewolves = village.werewolves;
+
+			//大きな村は一つ数えるのに数十msかかるので、盤面の数を減らす
+			const int villageBoards = village.werewolves <= 3 ? boardCount : std::min(boardCount, 10);
+			for (const size_t threads : { 1, 4 })
+			{
+				core::RoleEngineParams params;
+				params.threadCount = threads;
+
+				double solveMs = 0.0;
+				double coldMs = 0.0;
+				double editMs = 0.0;
+				double undoMs = 0.0;
+				size_t cached = 0;
+				size_t solved = 0;
+				size_t stolen = 0;
+				for (int b = 0; b < villageBoards; ++b)
+				{
+					//盤面ごとにキャッシュを空にして、一回目は全て数える
+					core::IncrementalRoleSolver solver(params);
+					core::Board board = RandomVillage(village.players, rules, village.days, rng);
+					const auto cold = Timed(coldMs, [&] { return solver.solve(core::RoleConstraints::FromBoard(board, rules)); });
+					mismatches += IsSameSolution(core::SolveRoles(board, rules), cold->solution) ? 0 : 1;
+					stolen += cold->stolenTasks;
+
+					int from = 0;
+					int to = 0;
+					if (!AddRandomResult(board, rng, from, to))
+					{
+						continue;
+					}
+					//比べる結果を先に数えておき、続けて測る二つが同じようにキャッシュに載った状態で始まるようにする
+					const auto expected = core::SolveRoles(board, rules);
+					const auto edit = Timed(editMs, [&] { return solver.solve(core::RoleConstraints::FromBoard(board, rules)); });
+					Timed(solveMs, [&] { return core::SolveRoles(board, rules); });
+					mismatches += IsSameSolution(expected, edit->solution) ? 0 : 1;
+					cached += edit->cachedTasks;
+					solved += edit->solvedTasks;
+
+					board.setLink(from, to, 0);
+					const auto undo = Timed(undoMs, [&] { return solver.solve(core::RoleConstraints::FromBoard(board, rules)); });
+					mismatches += IsSameSolution(cold->solution, undo->solution) ? 0 : 1;
+				}
+
+				const double n = villageBoards;
+				std::printf("%8zu %6d %8zu %12.4f %12.4f %12.4f %12.4f %10.1f %10.1f %10.1f\n", village.players, village.werewolves, threads,
+					solveMs / n, coldMs / n, editMs / n, undoMs / n, cached / n, solved / n, stolen / n);
+			}
+		}
+
+		std::printf("IncrementalRoleSolver vs SolveRoles: %d mismatches\n", mismatches);
+		return mismatches == 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int boardCount = 50;
+	bool verifyOnly = false;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strncmp(argv[i], "--boards=", 9) == 0)
+		{
+			boardCount = std::max(1, std::atoi(argv[i] + 9));
+		}
+		else if (std::strcmp(argv[i], "--verify") == 0)
+		{
+			verifyOnly = true;
+		}
+		else
+		{
+			std::fprintf(stderr, "usage: %s [--boards=50] [--verify]\n", argv[0]);
+			std::fprintf(stderr, "  --boards: random boards for each village size and day\n");
+			std::fprintf(stderr, "  --verify: only check SolveRoles against brute force on small villages\n");
+			return 1;
+		}
+	}
+
+	if (!VerifySolveRoles())
+	{
+		return 1;
+	}
+	if (verifyOnly)
+	{
+		return 0;
+	}
+
+	std::printf("\n%8s %5s %12s %12s %12s %14s\n", "players", "day", "mean [ms]", "max [ms]", "mean worlds", "mean nodes");
+	std::mt19937 rng(2);
+	for (const size_t players : { 9, 12, 15, 18, 20 })
+	{
+		for (const int days : { 0, 1, 2, 3 })
+		{
+			const core::VillageRules rules = core::VillageRules::ForPopulation(players);
+			double totalMs = 0.0;
+			double maxMs = 0.0;
+			double worlds = 0.0;
+			double nodes = 0.0;
+			for (int b = 0; b < boardCount; ++b)
+			{
+				const core::Board board = RandomVillage(players, rules, days, rng);
+				const auto begin = Clock::now();
+				const auto solution = core::SolveRoles(board, rules);
+				const double ms = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+				totalMs += ms;
+				maxMs = std::max(maxMs, ms);
+				worlds += solution.worlds;
+				nodes += static_cast<double>(solution.visitedNodes);
+			}
+			std::printf("%8zu %5d %12.4f %12.4f %12.0f %14.1f\n", players, days, totalMs / boardCount, maxMs, worlds / boardCount, nodes / boardCount);
+		}
+	}
+
+	return MeasureIncremental(boardCount) ? 0 : 1;
+}
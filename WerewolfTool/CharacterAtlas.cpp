@@ -0,0 +1,64 @@
+﻿# include "CharacterAtlas.hpp"
+
+CharacterAtlas::CharacterAtlas(const Size& cellSize, size_t count, const Color& placeholder)
+	: cellSize(cellSize)
+{
+	const Size pitch = cellSize + Size(Padding, Padding);
+	columns = static_cast<int32>(std::clamp<size_t>(count, 1, std::max(1, MaxPageSize / pitch.x)));
+	rowsPerPage = std::max(1, MaxPageSize / pitch.y);
+
+	const size_t perPage = static_cast<size_t>(columns) * rowsPerPage;
+	const size_t pages = std::max<size_t>(1, (count + perPage - 1) / perPage);
+	const Image cell(cellSize, placeholder);
+
+	for (size_t page = 0; page < pages; ++page)
+	{
+		//最後のページは使う行数だけの大きさにする
+		const size_t cellCount = std::min(perPage, count - std::min(count, page * perPage));
+		const int32 rows = static_cast<int32>(std::max<size_t>(1, (cellCount + columns - 1) / columns));
+
+		Image image(Size(columns * pitch.x, rows * pitch.y), Color(0, 0, 0, 0));
+		for (size_t i = 0; i < cellCount; ++i)
+		{
+			cell.overwrite(image, region(page * perPage + i).rect.pos);
+		}
+
+		textures.emplace_back(image);
+		images.push_back(std::move(image));
+		dirty.push_back(false);
+	}
+}
+
+CharacterAtlas::Region CharacterAtlas::region(size_t index)const
+{
+	const size_t perPage = static_cast<size_t>(columns) * rowsPerPage;
+	const int32 slot = static_cast<int32>(index % perPage);
+	const Size pitch = cellSize + Size(Padding, Padding);
+	return{ index / perPage, Rect(Point(slot % columns * pitch.x, slot / columns * pitch.y), cellSize) };
+}
+
+void CharacterAtlas::set(size_t index, const Image& image)
+{
+	const Region target = region(index);
+	if (image.size() == cellSize)
+	{
+		image.overwrite(images[target.page], target.rect.pos);
+	}
+	else
+	{
+		image.scaled(cellSize).overwrite(images[target.page], target.rect.pos);
+	}
+	dirty[target.page] = true;
+}
+
+void CharacterAtlas::upload()
+{
+	for (size_t page = 0; page < textures.size(); ++page)
+	{
+		if (dirty[page])
+		{
+			textures[page].fill(images[page]);
+			dirty[page] = false;
+		}
+	}
+}
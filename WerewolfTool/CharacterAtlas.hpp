@@ -0,0 +1,53 @@
+﻿# pragma once
+# include <Siv3D.hpp>
+
+//同じ大きさのキャラクター画像を数枚の大きなテクスチャ(ページ)に並べてまとめる
+//同じテクスチャを続けて描けば Siv3D が一回の描画にまとめるので、キャラクター毎にテクスチャを切り替えずに済む
+class CharacterAtlas
+{
+public:
+	//アトラスの中の一枚分の場所
+	struct Region
+	{
+		size_t page = 0;
+		Rect rect;
+	};
+
+	CharacterAtlas() = default;
+
+	//cellSize の画像を count 枚並べられるページを作り、全て placeholder の色で塗っておく
+	CharacterAtlas(const Size& cellSize, size_t count, const Color& placeholder);
+
+	Region region(size_t index)const;
+
+	//画像を書き込む、テクスチャへの転送は upload でまとめて行う
+	void set(size_t index, const Image& image);
+
+	//set で書き換えたページをテクスチャに転送する、1フレームに一回呼ぶ
+	void upload();
+
+	TextureRegion operator()(const Region& region)const
+	{
+		return textures[region.page](region.rect);
+	}
+
+	size_t pageCount()const
+	{
+		return textures.size();
+	}
+
+private:
+	//1ページの大きさの上限
+	static constexpr int32 MaxPageSize = 4096;
+
+	//隣の画像が滲まないように空ける幅
+	static constexpr int32 Padding = 1;
+
+	Size cellSize;
+	int32 columns = 0;
+	int32 rowsPerPage = 0;
+
+	Array<Image> images;
+	Array<DynamicTexture> textures;
+	Array<bool> dirty;
+};
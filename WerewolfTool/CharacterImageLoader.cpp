@@ -0,0 +1,83 @@
+﻿# include "CharacterImageLoader.hpp"
+# include <cstring>
+# include "Core/ThreadPool.hpp"
+
+CharacterImageLoader::CharacterImageLoader(const Array<FilePath>& paths, const Size& resolution, const FilePath& cacheDirectory, size_t threadCount)
+	: paths(paths)
+	, resolution(resolution)
+	, cache(Unicode::ToWstring(cacheDirectory))
+	, stopwatch(StartImmediately::Yes)
+{
+	//parallelFor は全て終わるまで戻らないので、メインスレッドを止めないように別のスレッドから呼ぶ
+	thread = std::thread([this, threadCount]
+	{
+		core::ThreadPool pool(threadCount);
+		pool.parallelFor(this->paths.size(), [&](size_t index)
+		{
+			if (canceled)
+			{
+				return;
+			}
+
+			LoadedImage result = load(index);
+			std::lock_guard lock(mutex);
+			loaded.push_back(std::move(result));
+		});
+	});
+}
+
+CharacterImageLoader::~CharacterImageLoader()
+{
+	canceled = true;
+	thread.join();
+}
+
+CharacterImageLoader::LoadedImage CharacterImageLoader::load(size_t index)const
+{
+	const Stopwatch decodeTime(StartImmediately::Yes);
+	const auto key = core::ThumbnailKey::FromFile(Unicode::ToWstring(paths[index]), resolution.x, resolution.y);
+
+	//キャッシュの画素はマップしたファイルから Image に写すだけ
+	if (key)
+	{
+		if (const auto thumbnail = cache.load(*key))
+		{
+			Image image(thumbnail->width, thumbnail->height);
+			std::memcpy(image.data(), thumbnail->pixels, image.size_bytes());
+			return{ index, std::move(image), decodeTime.msF(), true };
+		}
+	}
+
+	Image image(paths[index]);
+	if (image)
+	{
+		image.scale(resolution.x, resolution.y);
+		if (key && image.width() == resolution.x && image.height() == resolution.y)
+		{
+			cache.store(*key, image.dataAsUint8());
+		}
+	}
+	return{ index, std::move(image), decodeTime.msF(), false };
+}
+
+Array<CharacterImageLoader::LoadedImage> CharacterImageLoader::takeLoaded(size_t maxCount)
+{
+	Array<LoadedImage> result;
+	{
+		std::lock_guard lock(mutex);
+		const size_t count = std::min(maxCount, loaded.size());
+		result.assign(std::make_move_iterator(loaded.begin()), std::make_move_iterator(loaded.begin() + count));
+		loaded.erase(loaded.begin(), loaded.begin() + count);
+	}
+
+	taken += result.size();
+	for (const auto& image : result)
+	{
+		cacheHits += image.fromCache ? 1 : 0;
+	}
+	if (isDone())
+	{
+		stopwatch.pause();
+	}
+	return result;
+}
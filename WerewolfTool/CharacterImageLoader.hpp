@@ -0,0 +1,90 @@
+﻿# pragma once
+# include <Siv3D.hpp>
+# include <atomic>
+# include <mutex>
+# include <thread>
+# include "Core/ThumbnailCache.hpp"
+
+//キャラクター画像の読み込みと縮小をワーカースレッドで行う
+//テクスチャはメインスレッドでしか作れないので、読み込み終わった画像を takeLoaded で少しずつ受け取ってテクスチャにする
+//縮小した画像は cacheDirectory に保存しておき、元画像が変わっていなければ次からはPNGを展開しない
+class CharacterImageLoader
+{
+public:
+	struct LoadedImage
+	{
+		//コンストラクタに渡した paths の中の位置
+		size_t index;
+
+		//読み込めなかったときは空
+		Image image;
+
+		//読み込みと縮小にかかった時間
+		double decodeMs;
+
+		//キャッシュから読んだか
+		bool fromCache;
+	};
+
+	//threadCount: 0 ならCPUの論理コア数
+	CharacterImageLoader(const Array<FilePath>& paths, const Size& resolution, const FilePath& cacheDirectory, size_t threadCount = 0);
+
+	~CharacterImageLoader();
+
+	CharacterImageLoader(const CharacterImageLoader&) = delete;
+	CharacterImageLoader& operator=(const CharacterImageLoader&) = delete;
+
+	//読み込み終わった画像を最大 maxCount 枚取り出す
+	Array<LoadedImage> takeLoaded(size_t maxCount);
+
+	size_t totalCount()const
+	{
+		return paths.size();
+	}
+
+	//takeLoaded で取り出した枚数
+	size_t takenCount()const
+	{
+		return taken;
+	}
+
+	bool isDone()const
+	{
+		return taken == paths.size();
+	}
+
+	//キャッシュから読んだ枚数(takeLoaded で取り出したもののうち)
+	size_t cacheHitCount()const
+	{
+		return cacheHits;
+	}
+
+	//読み込み開始から全て取り出すまでの時間(読み込み中は経過時間)
+	double elapsedMs()const
+	{
+		return stopwatch.msF();
+	}
+
+	const FilePath& path(size_t index)const
+	{
+		return paths[index];
+	}
+
+private:
+	//1枚読み込む、ワーカースレッドから呼ぶ
+	LoadedImage load(size_t index)const;
+
+	Array<FilePath> paths;
+	Size resolution;
+	core::ThumbnailCache cache;
+
+	std::mutex mutex;
+	Array<LoadedImage> loaded;
+
+	std::atomic<bool> canceled{ false };
+	std::thread thread;
+
+	size_t taken = 0;
+	size_t cacheHits = 0;
+	Stopwatch stopwatch;
+};
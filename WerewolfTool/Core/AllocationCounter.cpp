@@ -0,0 +1,186 @@
+﻿# include "AllocationCounter.hpp"
+# include <atomic>
+# include <cstdlib>
+# include <new>
+
+//確保の回数を数えるために、全体の operator new / delete を置き換える
+//数えるだけなので、確保そのものは malloc / free に任せる
+namespace
+{
+	std::atomic<std::uint64_t> allocationCount{ 0 };
+
+	void* Allocate(std::size_t size)
+	{
+		allocationCount.fetch_add(1, std::memory_order_relaxed);
+		if (void* p = std::malloc(size == 0 ? 1 : size))
+		{
+			return p;
+		}
+		throw std::bad_alloc();
+	}
+
+	void* AllocateAligned(std::size_t size, std::align_val_t alignment)
+	{
+		allocationCount.fetch_add(1, std::memory_order_relaxed);
+		const std::size_t align = static_cast<std::size_t>(alignment);
+# if defined(_WIN32)
+		void* p = ::_aligned_malloc(size == 0 ? 1 : size, align);
+# else
+		void* p = nullptr;
+		if (::posix_memalign(&p, align < sizeof(void*) ? sizeof(void*) : align, size == 0 ? 1 : size) != 0)
+		{
+			p = nullptr;
+		}
+# endif
+		if (p)
+		{
+			return p;
+		}
+		throw std::bad_alloc();
+	}
+
+	void FreeAligned(void* p)noexcept
+	{
+# if defined(_WIN32)
+		::_aligned_free(p);
+# else
+		std::free(p);
+# endif
+	}
+}
+
+namespace core
+{
+	std::uint64_t AllocationCount()
+	{
+		return allocationCount.load(std::memory_order_relaxed);
+	}
+}
+
+void* operator new(std::size_t size)
+{
+	return Allocate(size);
+}
+
+void* operator new[](std::size_t size)
+{
+	return Allocate(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&)noexcept
+{
+	try
+	{
+		return Allocate(size);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return nullptr;
+	}
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&)noexcept
+{
+	try
+	{
+		return Allocate(size);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return nullptr;
+	}
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	return AllocateAligned(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return AllocateAligned(size, alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&)noexcept
+{
+	try
+	{
+		return AllocateAligned(size, alignment);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return nullptr;
+	}
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&)noexcept
+{
+	try
+	{
+		return AllocateAligned(size, alignment);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return nullptr;
+	}
+}
+
+void operator delete(void* p)noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p)noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t)noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p, std::size_t)noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&)noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&)noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t)noexcept
+{
+	FreeAligned(p);
+}
+
+void operator delete[](void* p, std::align_val_t)noexcept
+{
+	FreeAligned(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t)noexcept
+{
+	FreeAligned(p);
+}
+
+void operator delete[](void* p, std::size_t, std::align_val_t)noexcept
+{
+	FreeAligned(p);
+}
+
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&)noexcept
+{
+	FreeAligned(p);
+}
+
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&)noexcept
+{
+	FreeAligned(p);
+}
@@ -0,0 +1,9 @@
+﻿# pragma once
+# include <cstdint>
+
+namespace core
+{
+	//プログラム開始からの operator new の回数
+	//この関数を呼ぶプログラムでは AllocationCounter.cpp の operator new / delete が標準のものと置き換わる
+	std::uint64_t AllocationCount();
+}
@@ -0,0 +1,111 @@
+﻿# include "ArrowMesh.hpp"
+# include <algorithm>
+
+namespace core
+{
+	void ArrowMesh::BuildArrow(const Line& line, double thickness, double headSize, Vec2* out)
+	{
+		const double length = std::sqrt(line.lengthSq());
+		if (!(0.0 < length))
+		{
+			std::fill(out, out + VerticesPerArrow, line.begin);
+			return;
+		}
+
+		//Siv3D の Line::drawArrow と同じく、先端の三角形は終点から headSize の長さで幅も headSize
+		const Vec2 direction = line.vector() / length;
+		const Vec2 normal(-direction.y, direction.x);
+		const double headLength = std::min(headSize, length);
+		const Vec2 shaftEnd = line.end - direction * headLength;
+		const Vec2 halfThickness = normal * (thickness * 0.5);
+		const Vec2 halfHead = normal * (headSize * 0.5);
+
+		out[0] = line.begin + halfThickness;
+		out[1] = line.begin - halfThickness;
+		out[2] = shaftEnd + halfThickness;
+		out[3] = shaftEnd - halfThickness;
+		out[4] = line.end;
+		out[5] = shaftEnd + halfHead;
+		out[6] = shaftEnd - halfHead;
+	}
+
+	void ArrowMesh::buildArrow(const Board& board, size_t arrow)
+	{
+		const Node& from = board.nodes[arrowList[arrow].from];
+		const Node& to = board.nodes[arrowList[arrow].to];
+		Vec2* out = vertexList.data() + arrow * VerticesPerArrow;
+
+		if (const auto line = CutoffLine(Line(from.position, to.position), from.radius, to.radius))
+		{
+			BuildArrow(line.value(), thickness, headSize, out);
+		}
+		else
+		{
+			//ノードが重なっているときは描かない
+			std::fill(out, out + VerticesPerArrow, from.position);
+		}
+	}
+
+	void ArrowMesh::update(const Board& board)
+	{
+		changed.clear();
+
+		//リンクの並びが同じか調べながら集め直す
+		bool isSame = true;
+		size_t count = 0;
+		board.adjacents.forEach([&](int me, int other, char link)
+		{
+			if (count < arrowList.size())
+			{
+				const Arrow& arrow = arrowList[count];
+				isSame = isSame && arrow.from == me && arrow.to == other && arrow.link == link;
+			}
+			else
+			{
+				isSame = false;
+			}
+
+			if (!isSame)
+			{
+				arrowList.resize(count);
+				arrowList.push_back({ me, other, link });
+			}
+			++count;
+		});
+
+		isSame = isSame && count == arrowList.size() && positions.size() == board.nodes.size();
+		arrowList.resize(count);
+
+		moved.assign(board.nodes.size(), 1);
+		if (isSame)
+		{
+			for (size_t i = 0; i < board.nodes.size(); ++i)
+			{
+				moved[i] = positions[i] != board.nodes[i].position || radii[i] != board.nodes[i].radius;
+			}
+		}
+
+		positions.resize(board.nodes.size());
+		radii.resize(board.nodes.size());
+		for (size_t i = 0; i < board.nodes.size(); ++i)
+		{
+			positions[i] = board.nodes[i].position;
+			radii[i] = board.nodes[i].radius;
+		}
+
+		rebuilt = !isSame;
+		vertexList.resize(arrowList.size() * VerticesPerArrow);
+		for (size_t arrow = 0; arrow < arrowList.size(); ++arrow)
+		{
+			if (rebuilt)
+			{
+				buildArrow(board, arrow);
+			}
+			else if (moved[arrowList[arrow].from] || moved[arrowList[arrow].to])
+			{
+				buildArrow(board, arrow);
+				changed.push_back(arrow);
+			}
+		}
+	}
+}
@@ -0,0 +1,74 @@
+﻿# pragma once
+# include <cstdint>
+# include <vector>
+# include "Board.hpp"
+
+namespace core
+{
+	//リンクの矢印をまとめて一度に描くための三角形の頂点
+	//一本の矢印は軸の四角形(4頂点)と先端の三角形(3頂点)でできていて、arrow 番目の矢印は頂点 [7 * arrow, 7 * arrow + 7) を使う
+	//リンクの並びが前回と同じなら、両端のノードが動いた矢印の頂点だけを作り直す
+	class ArrowMesh
+	{
+	public:
+		static constexpr size_t VerticesPerArrow = 7;
+		static constexpr size_t TrianglesPerArrow = 3;
+
+		//矢印の三角形、頂点番号は矢印の先頭の頂点からの位置
+		static constexpr std::uint16_t Triangles[TrianglesPerArrow][3] = { { 0, 1, 2 }, { 2, 1, 3 }, { 4, 5, 6 } };
+
+		struct Arrow
+		{
+			int from;
+			int to;
+
+			//Board::link と同じ値(1:白出し, 2:黒出し)
+			char link;
+		};
+
+		//軸の太さと先端の三角形の大きさ
+		double thickness = 3.0;
+		double headSize = 20.0;
+
+		//board のリンクに合わせて頂点を更新する
+		void update(const Board& board);
+
+		//直前の update でリンクの並びが変わり、全ての矢印を作り直したか
+		bool isRebuilt()const
+		{
+			return rebuilt;
+		}
+
+		//直前の update で頂点を作り直した矢印(isRebuilt のときは空)
+		const std::vector<size_t>& changedArrows()const
+		{
+			return changed;
+		}
+
+		const std::vector<Arrow>& arrows()const
+		{
+			return arrowList;
+		}
+
+		const std::vector<Vec2>& vertices()const
+		{
+			return vertexList;
+		}
+
+		//line の終点を向く矢印の頂点を out[0, 7) に書く、短すぎる矢印は全ての頂点が一点に潰れる
+		static void BuildArrow(const Line& line, double thickness, double headSize, Vec2* out);
+
+	private:
+		void buildArrow(const Board& board, size_t arrow);
+
+		std::vector<Arrow> arrowList;
+		std::vector<Vec2> vertexList;
+		std::vector<size_t> changed;
+		bool rebuilt = false;
+
+		//前回の update でのノードの位置と半径
+		std::vector<Vec2> positions;
+		std::vector<double> radii;
+		std::vector<char> moved;
+	};
+}
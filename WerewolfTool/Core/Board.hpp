@@ -0,0 +1,63 @@
+﻿# pragma once
+# include <utility>
+# include <vector>
+# include "EdgeStore.hpp"
+# include "Geometry.hpp"
+
+namespace core
+{
+	//盤面上のキャラクター一人分の状態(名前や画像は持たない)
+	struct Node
+	{
+		enum Roal { None, Fortuneteller, Spiritualist, Hunter, Madman };
+		enum State { Alive, Hanged, Bitten, Suddenly };
+
+		Vec2 position;
+		Vec2 velocity;
+		double radius = 0.0;
+		Roal co = None;
+		bool isAutoLayout = true;
+		State state = Alive;
+
+		//ノードの中心が動ける範囲
+		RectF getFieldScope(const RectF& scene)const
+		{
+			return scene.stretched(-radius, -radius);
+		}
+	};
+
+	struct Board
+	{
+		Board() = default;
+		explicit Board(std::vector<Node> nodes)
+			: nodes(std::move(nodes))
+			, adjacents(this->nodes.size())
+		{}
+
+		void setLink(int indexFrom, int indexTo, char isEnabled)
+		{
+			adjacents.set(indexFrom, indexTo, isEnabled);
+		}
+
+		char link(int indexFrom, int indexTo)const
+		{
+			return adjacents.get(indexFrom, indexTo);
+		}
+
+		//向きを考慮せずにリンクがあるか
+		bool isLinked(int a, int b)const
+		{
+			return adjacents.get(a, b) != 0 || adjacents.get(b, a) != 0;
+		}
+
+		size_t size()const
+		{
+			return nodes.size();
+		}
+
+		std::vector<Node> nodes;
+
+		//0: リンクなし, 1:白出し, 2:黒出し
+		EdgeStore adjacents;
+	};
+}
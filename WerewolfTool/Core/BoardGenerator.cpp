@@ -0,0 +1,127 @@
+﻿# include "BoardGenerator.hpp"
+# include <algorithm>
+# include <cmath>
+# include <random>
+
+namespace core
+{
+	RectF SceneForNodeCount(size_t nodeCount)
+	{
+		const double scale = std::sqrt(std::max(1.0, nodeCount / 15.0));
+		return RectF(0, 0, 1280.0 * scale, 720.0 * scale);
+	}
+
+	namespace
+	{
+		//scene 内にランダムに置いたノードだけの盤面
+		Board RandomNodes(size_t nodeCount, const RectF& scene, double radius, std::mt19937& rng)
+		{
+			std::uniform_real_distribution<double> x(scene.pos.x, scene.pos.x + scene.size.x);
+			std::uniform_real_distribution<double> y(scene.pos.y, scene.pos.y + scene.size.y);
+
+			std::vector<Node> nodes(nodeCount);
+			for (auto& node : nodes)
+			{
+				node.radius = radius;
+				node.position = FixedPosVel(Vec2(x(rng), y(rng)), Vec2::Zero(), node.getFieldScope(scene)).first;
+			}
+			return Board(std::move(nodes));
+		}
+	}
+
+	Board RandomBoard(size_t nodeCount, size_t linkCount, const RectF& scene, std::uint32_t seed, double radius)
+	{
+		std::mt19937 rng(seed);
+		Board board = RandomNodes(nodeCount, scene, radius, rng);
+		if (nodeCount < 2)
+		{
+			return board;
+		}
+
+		linkCount = std::min(linkCount, nodeCount * (nodeCount - 1));
+		std::uniform_int_distribution<size_t> index(0, nodeCount - 1);
+		std::bernoulli_distribution isBlack(0.25);
+		for (size_t i = 0; i < linkCount;)
+		{
+			const int from = static_cast<int>(index(rng));
+			const int to = static_cast<int>(index(rng));
+			if (from == to || board.link(from, to) != 0)
+			{
+				continue;
+			}
+
+			board.setLink(from, to, isBlack(rng) ? 2 : 1);
+			++i;
+		}
+		return board;
+	}
+
+	Board StarBoard(size_t nodeCount, const RectF& scene, std::uint32_t seed, double radius)
+	{
+		std::mt19937 rng(seed);
+		Board board = RandomNodes(nodeCount, scene, radius, rng);
+
+		std::bernoulli_distribution isBlack(0.25);
+		for (size_t to = 1; to < nodeCount; ++to)
+		{
+			board.setLink(0, static_cast<int>(to), isBlack(rng) ? 2 : 1);
+		}
+		return board;
+	}
+
+	Board ChainBoard(size_t nodeCount, const RectF& scene, std::uint32_t seed, double radius)
+	{
+		std::mt19937 rng(seed);
+		Board board = RandomNodes(nodeCount, scene, radius, rng);
+
+		std::bernoulli_distribution isBlack(0.25);
+		for (size_t from = 0; from + 1 < nodeCount; ++from)
+		{
+			board.setLink(static_cast<int>(from), static_cast<int>(from + 1), isBlack(rng) ? 2 : 1);
+		}
+		return board;
+	}
+
+	Board ClusteredBoard(size_t nodeCount, size_t clusterCount, size_t linkCount, const RectF& scene, std::uint32_t seed, double radius)
+	{
+		std::mt19937 rng(seed);
+		Board board = RandomNodes(nodeCount, scene, radius, rng);
+		clusterCount = std::clamp<size_t>(clusterCount, 1, std::max<size_t>(1, nodeCount / 2));
+		if (nodeCount < 2)
+		{
+			return board;
+		}
+
+		//組 c はノード [c * nodeCount / clusterCount, (c + 1) * nodeCount / clusterCount)
+		const auto clusterBegin = [&](size_t c) { return c * nodeCount / clusterCount; };
+
+		linkCount = std::min(linkCount, nodeCount * (nodeCount - 1));
+		std::uniform_int_distribution<size_t> index(0, nodeCount - 1);
+		std::bernoulli_distribution isInside(0.9);
+		std::bernoulli_distribution isBlack(0.25);
+
+		//組の中だけでは張りきれない場合に止まらないように、試行回数を制限する
+		size_t attempts = 0;
+		for (size_t i = 0; i < linkCount && attempts < linkCount * 100; ++attempts)
+		{
+			const size_t from = index(rng);
+			size_t to = index(rng);
+			if (isInside(rng))
+			{
+				const size_t c = from * clusterCount / nodeCount;
+				const size_t begin = clusterBegin(c);
+				const size_t size = clusterBegin(c + 1) - begin;
+				to = begin + std::uniform_int_distribution<size_t>(0, size - 1)(rng);
+			}
+
+			if (from == to || board.link(static_cast<int>(from), static_cast<int>(to)) != 0)
+			{
+				continue;
+			}
+
+			board.setLink(static_cast<int>(from), static_cast<int>(to), isBlack(rng) ? 2 : 1);
+			++i;
+		}
+		return board;
+	}
+}
@@ -0,0 +1,24 @@
+﻿# pragma once
+# include <cstdint>
+# include "Board.hpp"
+
+namespace core
+{
+	//100x100の画像で表示したときのノードの半径
+	constexpr double DefaultNodeRadius = 70.71067811865476;
+
+	//15人村を1280x720に置いたときと同じ密度になる盤面の大きさ
+	RectF SceneForNodeCount(size_t nodeCount);
+
+	//scene 内にランダムに配置した nodeCount 人の盤面に、ランダムな白黒のリンクを linkCount 本張る
+	Board RandomBoard(size_t nodeCount, size_t linkCount, const RectF& scene, std::uint32_t seed, double radius = DefaultNodeRadius);
+
+	//0番のノード(占い師)が他の全員にリンクを張る盤面
+	Board StarBoard(size_t nodeCount, const RectF& scene, std::uint32_t seed, double radius = DefaultNodeRadius);
+
+	//i番から i+1番にリンクを張って一列につないだ盤面
+	Board ChainBoard(size_t nodeCount, const RectF& scene, std::uint32_t seed, double radius = DefaultNodeRadius);
+
+	//ノードを clusterCount 組に分け、リンクの多く(9割)を同じ組の中に張る盤面
+	Board ClusteredBoard(size_t nodeCount, size_t clusterCount, size_t linkCount, const RectF& scene, std::uint32_t seed, double radius = DefaultNodeRadius);
+}
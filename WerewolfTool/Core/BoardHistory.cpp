@@ -0,0 +1,154 @@
+﻿# include "BoardHistory.hpp"
+# include <utility>
+
+namespace core
+{
+	BoardEdit BoardEdit::inverted()const
+	{
+		BoardEdit result = *this;
+		std::swap(result.before, result.after);
+		std::swap(result.positionBefore, result.positionAfter);
+		return result;
+	}
+
+	BoardEdit BoardEdit::LinkEdit(int from, int to, char before, char after)
+	{
+		BoardEdit edit;
+		edit.kind = Link;
+		edit.before = static_cast<std::int8_t>(before);
+		edit.after = static_cast<std::int8_t>(after);
+		edit.node = from;
+		edit.other = to;
+		return edit;
+	}
+
+	BoardEdit BoardEdit::CoEdit(int node, Node::Roal before, Node::Roal after)
+	{
+		BoardEdit edit;
+		edit.kind = Co;
+		edit.before = static_cast<std::int8_t>(before);
+		edit.after = static_cast<std::int8_t>(after);
+		edit.node = node;
+		return edit;
+	}
+
+	BoardEdit BoardEdit::StateEdit(int node, Node::State before, Node::State after)
+	{
+		BoardEdit edit;
+		edit.kind = State;
+		edit.before = static_cast<std::int8_t>(before);
+		edit.after = static_cast<std::int8_t>(after);
+		edit.node = node;
+		return edit;
+	}
+
+	BoardEdit BoardEdit::AutoLayoutEdit(int node, bool before, bool after)
+	{
+		BoardEdit edit;
+		edit.kind = AutoLayout;
+		edit.before = before ? 1 : 0;
+		edit.after = after ? 1 : 0;
+		edit.node = node;
+		return edit;
+	}
+
+	BoardEdit BoardEdit::PositionEdit(int node, const Vec2& before, const Vec2& after)
+	{
+		BoardEdit edit;
+		edit.kind = Position;
+		edit.node = node;
+		edit.positionBefore = before;
+		edit.positionAfter = after;
+		return edit;
+	}
+
+	void ApplyEdit(Board& board, const BoardEdit& edit)
+	{
+		Node& node = board.nodes[edit.node];
+		switch (edit.kind)
+		{
+		case BoardEdit::Link:
+			board.setLink(edit.node, edit.other, static_cast<char>(edit.after));
+			break;
+		case BoardEdit::Co:
+			node.co = static_cast<Node::Roal>(edit.after);
+			break;
+		case BoardEdit::State:
+			node.state = static_cast<Node::State>(edit.after);
+			break;
+		case BoardEdit::AutoLayout:
+			node.isAutoLayout = edit.after != 0;
+			break;
+		case BoardEdit::Position:
+			node.position = edit.positionAfter;
+			node.velocity = Vec2::Zero();
+			break;
+		}
+	}
+
+	void BoardHistory::record(const BoardEdit& edit)
+	{
+		if (applied < stepEnds.size())
+		{
+			edits.resize(stepBegin(applied));
+			stepEnds.resize(applied);
+		}
+		edits.push_back(edit);
+	}
+
+	void BoardHistory::commit()
+	{
+		if (stepBegin(applied) < edits.size() && applied == stepEnds.size())
+		{
+			stepEnds.push_back(edits.size());
+			++applied;
+		}
+	}
+
+	std::vector<BoardEdit> BoardHistory::undo()
+	{
+		commit();
+		if (!canUndo())
+		{
+			return{};
+		}
+
+		--applied;
+		std::vector<BoardEdit> result;
+		for (size_t i = stepEnds[applied]; stepBegin(applied) < i; --i)
+		{
+			result.push_back(edits[i - 1].inverted());
+		}
+		return result;
+	}
+
+	std::vector<BoardEdit> BoardHistory::redo()
+	{
+		commit();
+		if (!canRedo())
+		{
+			return{};
+		}
+
+		std::vector<BoardEdit> result(edits.begin() + stepBegin(applied), edits.begin() + stepEnds[applied]);
+		++applied;
+		return result;
+	}
+
+	bool BoardHistory::canUndo()const
+	{
+		return 0 < applied || (applied == stepEnds.size() && stepBegin(applied) < edits.size());
+	}
+
+	bool BoardHistory::canRedo()const
+	{
+		return applied < stepEnds.size();
+	}
+
+	void BoardHistory::clear()
+	{
+		edits.clear();
+		stepEnds.clear();
+		applied = 0;
+	}
+}
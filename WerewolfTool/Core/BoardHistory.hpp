@@ -0,0 +1,98 @@
+﻿# pragma once
+# include <cstdint>
+# include <vector>
+# include "Board.hpp"
+
+namespace core
+{
+	//盤面への一回の変更と、変更前の値
+	struct BoardEdit
+	{
+		enum Kind : std::uint8_t { Link, Co, State, AutoLayout, Position };
+
+		Kind kind = Link;
+
+		//Link: リンクの色(0: なし), Co: Node::Roal, State: Node::State, AutoLayout: 0 か 1
+		std::int8_t before = 0;
+		std::int8_t after = 0;
+
+		//変更したノード(Link では始点)
+		int node = 0;
+
+		//Link の終点
+		int other = 0;
+
+		//Position で動かす前と後の位置
+		Vec2 positionBefore;
+		Vec2 positionAfter;
+
+		//変更を取り消す変更
+		BoardEdit inverted()const;
+
+		//種類ごとに、変更したノードと前後の値から作る
+		static BoardEdit LinkEdit(int from, int to, char before, char after);
+
+		static BoardEdit CoEdit(int node, Node::Roal before, Node::Roal after);
+
+		static BoardEdit StateEdit(int node, Node::State before, Node::State after);
+
+		static BoardEdit AutoLayoutEdit(int node, bool before, bool after);
+
+		static BoardEdit PositionEdit(int node, const Vec2& before, const Vec2& after);
+	};
+
+	//edit の変更後の値を board に書き込む
+	void ApplyEdit(Board& board, const BoardEdit& edit);
+
+	//盤面の編集の履歴(元に戻す・やり直す)
+	//盤面の複製は持たず、変更とその前の値だけを並べるので、使うメモリは変更の数に比例する
+	//一つの操作でまとめて行った変更(消しゴムで消した複数のリンクなど)は、commit までを一段として戻す
+	class BoardHistory
+	{
+	public:
+		//変更を今の段に足す、やり直せる段があれば捨てる
+		void record(const BoardEdit& edit);
+
+		//今の段を閉じる、変更が無ければ何もしない
+		void commit();
+
+		//最後の段を取り消す変更を、適用する順に返す(戻せないときは空)
+		//盤面には書き込まないので、呼んだ側で ApplyEdit する
+		std::vector<BoardEdit> undo();
+
+		//取り消した段をもう一度行う変更を、適用する順に返す(やり直せないときは空)
+		std::vector<BoardEdit> redo();
+
+		bool canUndo()const;
+
+		bool canRedo()const;
+
+		void clear();
+
+		//戻せる段と、やり直せる段を合わせた数
+		size_t stepCount()const
+		{
+			return stepEnds.size();
+		}
+
+		size_t editCount()const
+		{
+			return edits.size();
+		}
+
+	private:
+		size_t stepBegin(size_t step)const
+		{
+			return step == 0 ? 0 : stepEnds[step - 1];
+		}
+
+		//全ての段の変更を古い順に並べたもの
+		std::vector<BoardEdit> edits;
+
+		//stepEnds[i]: i 段目の終わりの edits の位置
+		std::vector<size_t> stepEnds;
+
+		//行われている段の数、これより後ろの段はやり直せる
+		size_t applied = 0;
+	};
+}
@@ -0,0 +1,243 @@
+﻿# include "BoardSnapshot.hpp"
+# include <algorithm>
+# include <cmath>
+# include <cstring>
+# include <fstream>
+# include <ostream>
+# include <system_error>
+# include "BoardText.hpp"
+
+namespace core
+{
+	namespace
+	{
+		constexpr char Magic[8] = { 'W', 'W', 'B', 'O', 'A', 'R', 'D', '\0' };
+		constexpr std::uint32_t Version = 1;
+
+		std::uint64_t AlignUp(std::uint64_t offset, std::uint64_t alignment)
+		{
+			return (offset + alignment - 1) / alignment * alignment;
+		}
+
+		//[offset, offset + count * stride) がファイルに収まり、alignment の境界から始まるか
+		bool IsInside(std::uint64_t offset, std::uint64_t count, std::uint64_t stride, std::uint64_t alignment, std::uint64_t fileSize)
+		{
+			return offset % alignment == 0
+				&& offset <= fileSize
+				&& count <= (fileSize - offset) / stride;
+		}
+
+		//レコードは構造体をそのまま書き読みするので、ビッグエンディアンの環境では保存も読み込みもしない
+		bool IsLittleEndian()
+		{
+			const std::uint16_t value = 1;
+			std::uint8_t first;
+			std::memcpy(&first, &value, 1);
+			return first == 1;
+		}
+
+		bool IsFinite(double x, double y)
+		{
+			return std::isfinite(x) && std::isfinite(y);
+		}
+
+		const std::uint32_t* RosterEnds(const std::uint8_t* data, const SnapshotHeader& header)
+		{
+			return reinterpret_cast<const std::uint32_t*>(data + header.rosterOffset);
+		}
+	}
+
+	bool SaveBoardSnapshot(const std::filesystem::path& path, const Board& board, const std::vector<std::string>& roster)
+	{
+		if (!IsLittleEndian() || (!roster.empty() && roster.size() != board.size()))
+		{
+			return false;
+		}
+
+		auto edges = board.adjacents.edges();
+		std::sort(edges.begin(), edges.end(), [](const EdgeStore::Edge& a, const EdgeStore::Edge& b)
+		{
+			return a.from != b.from ? a.from < b.from : a.to < b.to;
+		});
+
+		std::vector<std::uint32_t> rosterEnds(board.size() + 1, 0);
+		std::string names;
+		for (size_t i = 0; i < roster.size(); ++i)
+		{
+			names += roster[i];
+			rosterEnds[i + 1] = static_cast<std::uint32_t>(names.size());
+		}
+
+		SnapshotHeader header{};
+		std::memcpy(header.magic, Magic, sizeof(Magic));
+		header.version = Version;
+		header.nodeCount = static_cast<std::uint32_t>(board.size());
+		header.edgeCount = static_cast<std::uint32_t>(edges.size());
+		header.rosterBytes = static_cast<std::uint32_t>(names.size());
+		header.nodeOffset = AlignUp(sizeof(SnapshotHeader), alignof(SnapshotNode));
+		header.edgeOffset = AlignUp(header.nodeOffset + board.size() * sizeof(SnapshotNode), alignof(SnapshotEdge));
+		header.rosterOffset = AlignUp(header.edgeOffset + edges.size() * sizeof(SnapshotEdge), alignof(std::uint32_t));
+
+		std::vector<char> bytes(header.rosterOffset + rosterEnds.size() * sizeof(std::uint32_t) + names.size(), 0);
+		std::memcpy(bytes.data(), &header, sizeof(header));
+
+		for (size_t i = 0; i < board.size(); ++i)
+		{
+			const Node& node = board.nodes[i];
+			SnapshotNode record{};
+			record.x = node.position.x;
+			record.y = node.position.y;
+			record.vx = node.velocity.x;
+			record.vy = node.velocity.y;
+			record.radius = node.radius;
+			record.co = static_cast<std::uint8_t>(node.co);
+			record.state = static_cast<std::uint8_t>(node.state);
+			record.isAutoLayout = node.isAutoLayout ? 1 : 0;
+			std::memcpy(bytes.data() + header.nodeOffset + i * sizeof(SnapshotNode), &record, sizeof(record));
+		}
+
+		for (size_t i = 0; i < edges.size(); ++i)
+		{
+			SnapshotEdge record{};
+			record.from = edges[i].from;
+			record.to = edges[i].to;
+			record.color = static_cast<std::uint8_t>(edges[i].color);
+			std::memcpy(bytes.data() + header.edgeOffset + i * sizeof(SnapshotEdge), &record, sizeof(record));
+		}
+
+		std::memcpy(bytes.data() + header.rosterOffset, rosterEnds.data(), rosterEnds.size() * sizeof(std::uint32_t));
+		std::memcpy(bytes.data() + header.rosterOffset + rosterEnds.size() * sizeof(std::uint32_t), names.data(), names.size());
+
+		//書きかけのファイルを読まないように、別名で書いてから置き換える
+		std::error_code error;
+		auto temporary = path;
+		temporary += ".tmp";
+		bool isWritten = false;
+		{
+			std::ofstream ofs(temporary, std::ios::binary | std::ios::trunc);
+			ofs.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+			isWritten = static_cast<bool>(ofs);
+		}
+
+		//書きかけのファイルを残さないように、閉じてから消す
+		if (!isWritten)
+		{
+			std::filesystem::remove(temporary, error);
+			return false;
+		}
+
+		std::filesystem::rename(temporary, path, error);
+		if (error)
+		{
+			std::filesystem::remove(temporary, error);
+			return false;
+		}
+		return true;
+	}
+
+	std::optional<BoardSnapshotView> BoardSnapshotView::Open(const std::filesystem::path& path)
+	{
+		if (!IsLittleEndian())
+		{
+			return std::nullopt;
+		}
+
+		auto file = MappedFile::Open(path);
+		if (!file || file->size() < sizeof(SnapshotHeader))
+		{
+			return std::nullopt;
+		}
+
+		SnapshotHeader header;
+		std::memcpy(&header, file->data(), sizeof(header));
+
+		const std::uint64_t fileSize = file->size();
+		const std::uint64_t rosterEndsBytes = (static_cast<std::uint64_t>(header.nodeCount) + 1) * sizeof(std::uint32_t);
+		if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0
+			|| header.version != Version
+			|| !IsInside(header.nodeOffset, header.nodeCount, sizeof(SnapshotNode), alignof(SnapshotNode), fileSize)
+			|| !IsInside(header.edgeOffset, header.edgeCount, sizeof(SnapshotEdge), alignof(SnapshotEdge), fileSize)
+			|| !IsInside(header.rosterOffset, rosterEndsBytes + header.rosterBytes, 1, alignof(std::uint32_t), fileSize))
+		{
+			return std::nullopt;
+		}
+
+		BoardSnapshotView view;
+		view.file = std::move(*file);
+		view.header = header;
+		return view;
+	}
+
+	std::string_view BoardSnapshotView::rosterName(size_t index)const
+	{
+		if (nodeCount() <= index)
+		{
+			return {};
+		}
+
+		const std::uint32_t* ends = RosterEnds(file.data(), header);
+		const std::uint32_t begin = ends[index];
+		const std::uint32_t end = ends[index + 1];
+		if (end < begin || header.rosterBytes < end)
+		{
+			return {};
+		}
+
+		const char* names = reinterpret_cast<const char*>(ends + header.nodeCount + 1);
+		return std::string_view(names + begin, end - begin);
+	}
+
+	std::optional<Board> BoardSnapshotView::toBoard()const
+	{
+		std::vector<Node> nodes(nodeCount());
+		for (size_t i = 0; i < nodes.size(); ++i)
+		{
+			const SnapshotNode& record = node(i);
+			if (Node::Madman < record.co || Node::Suddenly < record.state || 1 < record.isAutoLayout
+				|| !IsFinite(record.x, record.y) || !IsFinite(record.vx, record.vy) || !std::isfinite(record.radius) || record.radius <= 0.0)
+			{
+				return std::nullopt;
+			}
+
+			nodes[i].position = Vec2(record.x, record.y);
+			nodes[i].velocity = Vec2(record.vx, record.vy);
+			nodes[i].radius = record.radius;
+			nodes[i].co = static_cast<Node::Roal>(record.co);
+			nodes[i].state = static_cast<Node::State>(record.state);
+			nodes[i].isAutoLayout = record.isAutoLayout != 0;
+		}
+
+		const int n = static_cast<int>(nodes.size());
+		std::vector<EdgeStore::Edge> links(edgeCount());
+		for (size_t i = 0; i < links.size(); ++i)
+		{
+			const SnapshotEdge& record = edge(i);
+			if (record.from < 0 || n <= record.from || record.to < 0 || n <= record.to || record.from == record.to
+				|| record.color < 1 || 2 < record.color)
+			{
+				return std::nullopt;
+			}
+			links[i] = { record.from, record.to, static_cast<char>(record.color) };
+		}
+
+		Board board(std::move(nodes));
+		board.adjacents.assign(std::move(links));
+		return board;
+	}
+
+	bool ExportSnapshotText(std::ostream& os, const BoardSnapshotView& snapshot)
+	{
+		const auto board = snapshot.toBoard();
+		if (!board)
+		{
+			return false;
+		}
+
+		for (size_t i = 0; i < snapshot.nodeCount(); ++i)
+		{
+			os << "# roster " << i << ' ' << snapshot.rosterName(i) << '\n';
+		}
+		SaveBoardText(os, *board);
+		return static_cast<bool>(os);
+	}
+}
@@ -0,0 +1,105 @@
+﻿# pragma once
+# include <cstdint>
+# include <filesystem>
+# include <iosfwd>
+# include <optional>
+# include <string>
+# include <string_view>
+# include <vector>
+# include "Board.hpp"
+# include "MappedFile.hpp"
+
+namespace core
+{
+	//盤面を丸ごと保存するバイナリ形式(リトルエンディアン、ビッグエンディアンの環境では保存も読み込みもできない)
+	//
+	//	ヘッダ(SnapshotHeader)
+	//	ノード(SnapshotNode × nodeCount、8バイト境界)
+	//	リンク(SnapshotEdge × edgeCount、from, to の順に並べる)
+	//	キャラクター名の終わりの位置(uint32 × (nodeCount + 1))と、続けて名前(UTF-8)を詰めたもの
+	//
+	//読むときはファイルをメモリにマップして、レコードをコピーせずにそのまま参照する
+	struct SnapshotHeader
+	{
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t nodeCount;
+		std::uint32_t edgeCount;
+		std::uint32_t rosterBytes;
+		std::uint64_t nodeOffset;
+		std::uint64_t edgeOffset;
+		std::uint64_t rosterOffset;
+	};
+
+	struct SnapshotNode
+	{
+		double x;
+		double y;
+		double vx;
+		double vy;
+		double radius;
+		std::uint8_t co;
+		std::uint8_t state;
+		std::uint8_t isAutoLayout;
+		std::uint8_t padding[5];
+	};
+
+	struct SnapshotEdge
+	{
+		std::int32_t from;
+		std::int32_t to;
+		std::uint8_t color;
+		std::uint8_t padding[3];
+	};
+
+	static_assert(sizeof(SnapshotHeader) == 48);
+	static_assert(sizeof(SnapshotNode) == 48);
+	static_assert(sizeof(SnapshotEdge) == 12);
+
+	//roster: ノードと同じ順のキャラクター名、空なら名前なしで保存する
+	//書き込めなかったときは false
+	bool SaveBoardSnapshot(const std::filesystem::path& path, const Board& board, const std::vector<std::string>& roster);
+
+	//マップしたスナップショット
+	//Open ではヘッダと各部分の範囲だけを確かめるので、盤面の大きさによらずすぐに開ける
+	class BoardSnapshotView
+	{
+	public:
+		//開けなかったときや形式が違うときは std::nullopt
+		static std::optional<BoardSnapshotView> Open(const std::filesystem::path& path);
+
+		size_t nodeCount()const
+		{
+			return header.nodeCount;
+		}
+
+		size_t edgeCount()const
+		{
+			return header.edgeCount;
+		}
+
+		const SnapshotNode& node(size_t index)const
+		{
+			return reinterpret_cast<const SnapshotNode*>(file.data() + header.nodeOffset)[index];
+		}
+
+		const SnapshotEdge& edge(size_t index)const
+		{
+			return reinterpret_cast<const SnapshotEdge*>(file.data() + header.edgeOffset)[index];
+		}
+
+		//index が範囲外のときや、名前の範囲が壊れているときは空
+		std::string_view rosterName(size_t index)const;
+
+		//値(CO・死因の範囲、位置・速度が有限か、半径が正か)やリンクの範囲が正しくないときは std::nullopt
+		std::optional<Board> toBoard()const;
+
+	private:
+		MappedFile file;
+		SnapshotHeader header{};
+	};
+
+	//デバッグ用に、キャラクター名をコメントにしてテキスト形式(BoardText.hpp)で書き出す
+	//出力は LoadBoardText でそのまま読める、盤面が壊れているときは false
+	bool ExportSnapshotText(std::ostream& os, const BoardSnapshotView& snapshot);
+}
@@ -0,0 +1,124 @@
+﻿# include "BoardText.hpp"
+# include <algorithm>
+# include <istream>
+# include <ostream>
+# include <sstream>
+# include <string>
+
+namespace core
+{
+	void SaveBoardText(std::ostream& os, const Board& board)
+	{
+		const auto precision = os.precision(17);
+
+		os << "werewolf-board 1\n";
+		for (const auto& node : board.nodes)
+		{
+			os << "node " << node.position.x << ' ' << node.position.y
+				<< ' ' << node.velocity.x << ' ' << node.velocity.y
+				<< ' ' << node.radius
+				<< ' ' << static_cast<int>(node.co)
+				<< ' ' << static_cast<int>(node.state)
+				<< ' ' << (node.isAutoLayout ? 1 : 0) << '\n';
+		}
+
+		auto edges = board.adjacents.edges();
+		std::sort(edges.begin(), edges.end(), [](const EdgeStore::Edge& a, const EdgeStore::Edge& b)
+		{
+			return a.from != b.from ? a.from < b.from : a.to < b.to;
+		});
+
+		for (const auto& edge : edges)
+		{
+			os << "link " << edge.from << ' ' << edge.to << ' ' << static_cast<int>(edge.color) << '\n';
+		}
+
+		os.precision(precision);
+	}
+
+	std::optional<Board> LoadBoardText(std::istream& is)
+	{
+		std::vector<Node> nodes;
+		std::vector<EdgeStore::Edge> links;
+		bool hasHeader = false;
+
+		std::string line;
+		while (std::getline(is, line))
+		{
+			if (const auto comment = line.find('#'); comment != std::string::npos)
+			{
+				line.erase(comment);
+			}
+
+			std::istringstream ls(line);
+			std::string tag;
+			if (!(ls >> tag))
+			{
+				continue;
+			}
+
+			if (tag == "werewolf-board")
+			{
+				int version = 0;
+				if (!(ls >> version) || version != 1)
+				{
+					return std::nullopt;
+				}
+				hasHeader = true;
+			}
+			else if (tag == "node")
+			{
+				Node node;
+				int co = 0;
+				int state = 0;
+				int isAutoLayout = 1;
+				if (!(ls >> node.position.x >> node.position.y >> node.velocity.x >> node.velocity.y >> node.radius >> co >> state >> isAutoLayout))
+				{
+					return std::nullopt;
+				}
+				if (co < Node::None || Node::Madman < co || state < Node::Alive || Node::Suddenly < state)
+				{
+					return std::nullopt;
+				}
+
+				node.co = static_cast<Node::Roal>(co);
+				node.state = static_cast<Node::State>(state);
+				node.isAutoLayout = isAutoLayout != 0;
+				nodes.push_back(node);
+			}
+			else if (tag == "link")
+			{
+				int from = 0;
+				int to = 0;
+				int color = 0;
+				if (!(ls >> from >> to >> color) || color < 1 || 2 < color)
+				{
+					return std::nullopt;
+				}
+				links.push_back({ from, to, static_cast<char>(color) });
+			}
+			else
+			{
+				return std::nullopt;
+			}
+		}
+
+		if (!hasHeader)
+		{
+			return std::nullopt;
+		}
+
+		const int n = static_cast<int>(nodes.size());
+		for (const auto& link : links)
+		{
+			if (link.from < 0 || n <= link.from || link.to < 0 || n <= link.to || link.from == link.to)
+			{
+				return std::nullopt;
+			}
+		}
+
+		Board board(std::move(nodes));
+		board.adjacents.assign(std::move(links));
+		return board;
+	}
+}
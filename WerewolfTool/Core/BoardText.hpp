@@ -0,0 +1,18 @@
+﻿# pragma once
+# include <iosfwd>
+# include <optional>
+# include "Board.hpp"
+
+namespace core
+{
+	//デバッグやベンチマーク用の盤面のテキスト形式
+	//
+	//	werewolf-board 1
+	//	node <x> <y> <vx> <vy> <radius> <co> <state> <isAutoLayout>
+	//	link <from> <to> <1:白出し|2:黒出し>
+	//
+	//'#' から行末まではコメント
+	void SaveBoardText(std::ostream& os, const Board& board);
+
+	std::optional<Board> LoadBoardText(std::istream& is);
+}
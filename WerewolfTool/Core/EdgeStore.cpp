@@ -0,0 +1,178 @@
+﻿# include "EdgeStore.hpp"
+# include <algorithm>
+
+namespace core
+{
+	namespace
+	{
+		bool EdgeLess(const EdgeStore::Edge& a, const EdgeStore::Edge& b)
+		{
+			return a.from != b.from ? a.from < b.from : a.to < b.to;
+		}
+
+		//差分バッファがこれより大きくなったらCSRに統合する
+		size_t DeltaCapacity(size_t liveCount)
+		{
+			return std::max<size_t>(64, liveCount / 8);
+		}
+	}
+
+	void EdgeStore::reset(size_t nodeCount)
+	{
+		offsets.assign(nodeCount + 1, 0);
+		targets.clear();
+		colors.clear();
+		delta.clear();
+		liveCount = 0;
+		tombstoneCount = 0;
+	}
+
+	void EdgeStore::assign(std::vector<Edge> newEdges)
+	{
+		//同じ向きのリンクは後のものを残す
+		std::stable_sort(newEdges.begin(), newEdges.end(), EdgeLess);
+		std::vector<Edge> unique;
+		unique.reserve(newEdges.size());
+		for (const auto& edge : newEdges)
+		{
+			if (!unique.empty() && unique.back().from == edge.from && unique.back().to == edge.to)
+			{
+				unique.back() = edge;
+			}
+			else
+			{
+				unique.push_back(edge);
+			}
+		}
+
+		const size_t n = nodeCount();
+		offsets.assign(n + 1, 0);
+		targets.clear();
+		colors.clear();
+		delta.clear();
+		tombstoneCount = 0;
+		liveCount = 0;
+
+		for (const auto& edge : unique)
+		{
+			if (edge.color == 0)
+			{
+				continue;
+			}
+
+			++offsets[edge.from + 1];
+			targets.push_back(edge.to);
+			colors.push_back(edge.color);
+			++liveCount;
+		}
+
+		for (size_t i = 0; i < n; ++i)
+		{
+			offsets[i + 1] += offsets[i];
+		}
+	}
+
+	char EdgeStore::get(int from, int to)const
+	{
+		if (const int k = findInCSR(from, to); 0 <= k)
+		{
+			return colors[k];
+		}
+
+		const auto it = findInDelta(from, to);
+		return it != delta.end() ? it->color : 0;
+	}
+
+	void EdgeStore::set(int from, int to, char color)
+	{
+		if (const int k = findInCSR(from, to); 0 <= k)
+		{
+			if (colors[k] == 0 && color != 0)
+			{
+				--tombstoneCount;
+				++liveCount;
+			}
+			else if (colors[k] != 0 && color == 0)
+			{
+				++tombstoneCount;
+				--liveCount;
+			}
+			colors[k] = color;
+
+			if (DeltaCapacity(liveCount) < tombstoneCount)
+			{
+				compact();
+			}
+			return;
+		}
+
+		const Edge edge{ from, to, color };
+		const auto it = std::lower_bound(delta.begin(), delta.end(), edge, EdgeLess);
+		const bool exists = it != delta.end() && it->from == from && it->to == to;
+
+		if (color == 0)
+		{
+			if (exists)
+			{
+				delta.erase(it);
+				--liveCount;
+			}
+			return;
+		}
+
+		if (exists)
+		{
+			it->color = color;
+			return;
+		}
+
+		delta.insert(it, edge);
+		++liveCount;
+
+		if (DeltaCapacity(liveCount) < delta.size())
+		{
+			compact();
+		}
+	}
+
+	std::vector<EdgeStore::Edge> EdgeStore::edges()const
+	{
+		std::vector<Edge> result;
+		result.reserve(liveCount);
+		forEach([&](int from, int to, char color) { result.push_back({ from, to, color }); });
+		return result;
+	}
+
+	void EdgeStore::compact()
+	{
+		if (delta.empty() && tombstoneCount == 0)
+		{
+			return;
+		}
+
+		assign(edges());
+	}
+
+	int EdgeStore::findInCSR(int from, int to)const
+	{
+		const auto first = targets.begin() + offsets[from];
+		const auto last = targets.begin() + offsets[from + 1];
+		const auto it = std::lower_bound(first, last, to);
+		if (it != last && *it == to)
+		{
+			return static_cast<int>(it - targets.begin());
+		}
+		return -1;
+	}
+
+	std::vector<EdgeStore::Edge>::const_iterator EdgeStore::findInDelta(int from, int to)const
+	{
+		const Edge key{ from, to, 0 };
+		const auto it = std::lower_bound(delta.begin(), delta.end(), key, EdgeLess);
+		if (it != delta.end() && it->from == from && it->to == to)
+		{
+			return it;
+		}
+		return delta.end();
+	}
+}
@@ -0,0 +1,96 @@
+﻿# pragma once
+# include <cstddef>
+# include <vector>
+
+namespace core
+{
+	//白出し・黒出しの有向リンクを保持する疎な隣接リスト
+	//
+	//本体は始点ごとに終点をソートしたCSR形式で持ち、
+	//CSRに無いリンクの追加はソート済みの差分バッファに積んで、ある程度たまったらCSRに統合する
+	//CSRにあるリンクの削除や色の変更はその場で書き換える(削除は墓標として残し、統合時に取り除く)
+	class EdgeStore
+	{
+	public:
+		struct Edge
+		{
+			int from;
+			int to;
+
+			//1:白出し, 2:黒出し
+			char color;
+		};
+
+		EdgeStore() = default;
+
+		explicit EdgeStore(size_t nodeCount)
+		{
+			reset(nodeCount);
+		}
+
+		//全てのリンクを消して頂点数を nodeCount にする
+		void reset(size_t nodeCount);
+
+		//全てのリンクを edges で置き換える(同じ向きのリンクが重複した場合は後のものを使う)
+		void assign(std::vector<Edge> edges);
+
+		//0: リンクなし, 1:白出し, 2:黒出し
+		char get(int from, int to)const;
+
+		//color = 0 のときリンクを削除する
+		void set(int from, int to, char color);
+
+		size_t nodeCount()const
+		{
+			return offsets.empty() ? 0 : offsets.size() - 1;
+		}
+
+		//有効なリンクの本数
+		size_t size()const
+		{
+			return liveCount;
+		}
+
+		//全ての有効なリンクについて func(from, to, color) を呼ぶ
+		template <class Func>
+		void forEach(Func func)const
+		{
+			for (size_t from = 0; from + 1 < offsets.size(); ++from)
+			{
+				for (int k = offsets[from]; k < offsets[from + 1]; ++k)
+				{
+					if (colors[k] != 0)
+					{
+						func(static_cast<int>(from), targets[k], colors[k]);
+					}
+				}
+			}
+
+			for (const auto& edge : delta)
+			{
+				func(edge.from, edge.to, edge.color);
+			}
+		}
+
+		std::vector<Edge> edges()const;
+
+		//差分バッファと墓標をCSRに統合する
+		void compact();
+
+	private:
+		//CSR内の位置、無ければ -1
+		int findInCSR(int from, int to)const;
+
+		std::vector<Edge>::const_iterator findInDelta(int from, int to)const;
+
+		std::vector<int> offsets;
+		std::vector<int> targets;
+		std::vector<char> colors;
+
+		//(from, to) の順にソートされている
+		std::vector<Edge> delta;
+
+		size_t liveCount = 0;
+		size_t tombstoneCount = 0;
+	};
+}
@@ -0,0 +1,218 @@
+﻿# include "ForceKernel.hpp"
+
+# if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#	define CORE_FORCE_KERNEL_X86
+#	include <immintrin.h>
+#	if defined(_MSC_VER)
+#		include <intrin.h>
+#	endif
+# endif
+
+//GCCとClangではAVX2の命令を使う関数だけAVX2向けにコンパイルする
+//MSVCは指定しなくても組み込み関数を使える
+# if defined(CORE_FORCE_KERNEL_X86) && (defined(__GNUC__) || defined(__clang__))
+#	define CORE_TARGET_AVX2 __attribute__((target("avx2")))
+# else
+#	define CORE_TARGET_AVX2
+# endif
+
+namespace core
+{
+	namespace
+	{
+		//j ∈ [begin, end) からの r / |r|^2 の和
+		void SumScalar(const double* x, const double* y, double xi, double yi, size_t begin, size_t end, double& sx, double& sy)
+		{
+			for (size_t j = begin; j < end; ++j)
+			{
+				const double dx = x[j] - xi;
+				const double dy = y[j] - yi;
+				const double inv = 1.0 / (dx * dx + dy * dy);
+				sx += dx * inv;
+				sy += dy * inv;
+			}
+		}
+
+# if defined(CORE_FORCE_KERNEL_X86)
+		void SumSSE2(const double* x, const double* y, double xi, double yi, size_t begin, size_t end, double& sx, double& sy)
+		{
+			const __m128d vxi = _mm_set1_pd(xi);
+			const __m128d vyi = _mm_set1_pd(yi);
+			const __m128d one = _mm_set1_pd(1.0);
+			__m128d accX = _mm_setzero_pd();
+			__m128d accY = _mm_setzero_pd();
+
+			size_t j = begin;
+			for (; j + 2 <= end; j += 2)
+			{
+				const __m128d dx = _mm_sub_pd(_mm_loadu_pd(x + j), vxi);
+				const __m128d dy = _mm_sub_pd(_mm_loadu_pd(y + j), vyi);
+				const __m128d inv = _mm_div_pd(one, _mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)));
+				accX = _mm_add_pd(accX, _mm_mul_pd(dx, inv));
+				accY = _mm_add_pd(accY, _mm_mul_pd(dy, inv));
+			}
+
+			alignas(16) double lanes[2];
+			_mm_store_pd(lanes, accX);
+			sx += lanes[0] + lanes[1];
+			_mm_store_pd(lanes, accY);
+			sy += lanes[0] + lanes[1];
+
+			SumScalar(x, y, xi, yi, j, end, sx, sy);
+		}
+
+		CORE_TARGET_AVX2
+		void SumAVX2(const double* x, const double* y, double xi, double yi, size_t begin, size_t end, double& sx, double& sy)
+		{
+			const __m256d vxi = _mm256_set1_pd(xi);
+			const __m256d vyi = _mm256_set1_pd(yi);
+			const __m256d one = _mm256_set1_pd(1.0);
+			__m256d accX = _mm256_setzero_pd();
+			__m256d accY = _mm256_setzero_pd();
+
+			size_t j = begin;
+			for (; j + 4 <= end; j += 4)
+			{
+				const __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(x + j), vxi);
+				const __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(y + j), vyi);
+				const __m256d inv = _mm256_div_pd(one, _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)));
+				accX = _mm256_add_pd(accX, _mm256_mul_pd(dx, inv));
+				accY = _mm256_add_pd(accY, _mm256_mul_pd(dy, inv));
+			}
+
+			alignas(32) double lanes[4];
+			_mm256_store_pd(lanes, accX);
+			sx += (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+			_mm256_store_pd(lanes, accY);
+			sy += (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+
+			for (; j < end; ++j)
+			{
+				const double dx = x[j] - xi;
+				const double dy = y[j] - yi;
+				const double inv = 1.0 / (dx * dx + dy * dy);
+				sx += dx * inv;
+				sy += dy * inv;
+			}
+		}
+
+		bool CpuSupportsAVX2()
+		{
+#	if defined(__GNUC__) || defined(__clang__)
+			__builtin_cpu_init();
+			return __builtin_cpu_supports("avx2");
+#	elif defined(_MSC_VER)
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7)
+			{
+				return false;
+			}
+
+			//OSがYMMレジスタを保存するか
+			__cpuid(info, 1);
+			const bool osxsave = (info[2] & (1 << 27)) != 0;
+			const bool avx = (info[2] & (1 << 28)) != 0;
+			if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+			{
+				return false;
+			}
+
+			__cpuidex(info, 7, 0);
+			return (info[1] & (1 << 5)) != 0;
+#	else
+			return false;
+#	endif
+		}
+# endif
+
+		using SumFunc = void(*)(const double*, const double*, double, double, size_t, size_t, double&, double&);
+
+		SumFunc SelectSum(ForceKernel kernel)
+		{
+			switch (ResolveForceKernel(kernel))
+			{
+# if defined(CORE_FORCE_KERNEL_X86)
+			case ForceKernel::SSE2:
+				return SumSSE2;
+			case ForceKernel::AVX2:
+				return SumAVX2;
+# endif
+			default:
+				return SumScalar;
+			}
+		}
+	}
+
+	ForceKernel DetectForceKernel()
+	{
+# if defined(CORE_FORCE_KERNEL_X86)
+		static const ForceKernel detected = CpuSupportsAVX2() ? ForceKernel::AVX2 : ForceKernel::SSE2;
+		return detected;
+# else
+		return ForceKernel::Scalar;
+# endif
+	}
+
+	ForceKernel ResolveForceKernel(ForceKernel kernel)
+	{
+		const ForceKernel best = DetectForceKernel();
+		if (kernel == ForceKernel::Auto || static_cast<int>(best) < static_cast<int>(kernel))
+		{
+			return best;
+		}
+		return kernel;
+	}
+
+	const char* ToString(ForceKernel kernel)
+	{
+		switch (kernel)
+		{
+		case ForceKernel::Auto:
+			return "auto";
+		case ForceKernel::Scalar:
+			return "scalar";
+		case ForceKernel::SSE2:
+			return "sse2";
+		case ForceKernel::AVX2:
+			return "avx2";
+		default:
+			return "unknown";
+		}
+	}
+
+	std::optional<ForceKernel> ParseForceKernel(std::string_view name)
+	{
+		for (const auto kernel : { ForceKernel::Auto, ForceKernel::Scalar, ForceKernel::SSE2, ForceKernel::AVX2 })
+		{
+			if (name == ToString(kernel))
+			{
+				return kernel;
+			}
+		}
+		return std::nullopt;
+	}
+
+	void AccumulateRepulsion(ForceKernel kernel, const double* x, const double* y, const std::uint8_t* fixed, size_t n,
+		double strength, size_t first, size_t last, double* fx, double* fy)
+	{
+		const SumFunc sum = SelectSum(kernel);
+
+		for (size_t i = first; i < last; ++i)
+		{
+			if (fixed[i])
+			{
+				continue;
+			}
+
+			//自分自身との組は0除算になるので、自分の前後で区間を分ける
+			double sx = 0.0;
+			double sy = 0.0;
+			sum(x, y, x[i], y[i], 0, i, sx, sy);
+			sum(x, y, x[i], y[i], i + 1, n, sx, sy);
+
+			fx[i] += -strength * sx;
+			fy[i] += -strength * sy;
+		}
+	}
+}
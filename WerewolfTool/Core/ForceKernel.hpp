@@ -0,0 +1,34 @@
+﻿# pragma once
+# include <cstddef>
+# include <cstdint>
+# include <optional>
+# include <string_view>
+
+namespace core
+{
+	//全頂点間の斥力を計算する実装
+	enum class ForceKernel
+	{
+		//実行中のCPUで使える最も速いもの
+		Auto,
+		Scalar,
+		SSE2,
+		AVX2,
+	};
+
+	//実行中のCPUで使える最も速いカーネル
+	ForceKernel DetectForceKernel();
+
+	//Auto と、CPUが対応していないカーネルを DetectForceKernel の結果に置き換える
+	//(AVX2 を指定しても SSE2 までのCPUなら SSE2 になる)
+	ForceKernel ResolveForceKernel(ForceKernel kernel);
+
+	const char* ToString(ForceKernel kernel);
+
+	std::optional<ForceKernel> ParseForceKernel(std::string_view name);
+
+	//i ∈ [first, last) かつ fixed[i] == 0 の頂点について
+	//斥力 Σ -strength * r / |r|^2 (r = (x[j] - x[i], y[j] - y[i]), j ≠ i) を fx[i], fy[i] に加える
+	void AccumulateRepulsion(ForceKernel kernel, const double* x, const double* y, const std::uint8_t* fixed, size_t n,
+		double strength, size_t first, size_t last, double* fx, double* fy);
+}
@@ -0,0 +1,137 @@
+﻿# include "FrameProfiler.hpp"
+# include <algorithm>
+# include <cmath>
+# include "AllocationCounter.hpp"
+
+namespace core
+{
+	FrameProfiler::FrameProfiler(std::vector<std::string> phaseNames, std::vector<std::string> counterNames, size_t historySize)
+		: phases(std::move(phaseNames))
+		, counters(std::move(counterNames))
+		, history(std::max<size_t>(historySize, 1))
+	{
+		//記録中にメモリを確保しないように先に用意しておく
+		for (auto& frame : history)
+		{
+			frame.phaseMs.assign(phases.size(), 0.0);
+			frame.counts.assign(counters.size(), 0.0);
+		}
+		scratch.reserve(history.size());
+		frameBegin = Clock::now();
+	}
+
+	void FrameProfiler::beginFrame()
+	{
+		Frame& frame = current();
+		frame.index = frameIndex;
+		std::fill(frame.phaseMs.begin(), frame.phaseMs.end(), 0.0);
+		std::fill(frame.counts.begin(), frame.counts.end(), 0.0);
+
+		frameBegin = Clock::now();
+		allocationsAtBegin = AllocationCount();
+	}
+
+	void FrameProfiler::endFrame()
+	{
+		Frame& frame = current();
+		frame.frameMs = std::chrono::duration<double, std::milli>(Clock::now() - frameBegin).count();
+		frame.allocations = static_cast<double>(AllocationCount() - allocationsAtBegin);
+
+		head = (head + 1) % history.size();
+		count = std::min(count + 1, history.size());
+		++frameIndex;
+	}
+
+	void FrameProfiler::addTime(size_t phase, double ms)
+	{
+		current().phaseMs[phase] += ms;
+	}
+
+	void FrameProfiler::setCount(size_t counter, double value)
+	{
+		current().counts[counter] = value;
+	}
+
+	const FrameProfiler::Frame& FrameProfiler::recent(size_t i)const
+	{
+		return history[(head + history.size() - 1 - i) % history.size()];
+	}
+
+	template <class Get>
+	double FrameProfiler::percentile(double p, size_t window, Get get)const
+	{
+		const size_t n = std::min(window, count);
+		if (n == 0)
+		{
+			return 0.0;
+		}
+
+		scratch.clear();
+		for (size_t i = 0; i < n; ++i)
+		{
+			scratch.push_back(get(recent(i)));
+		}
+
+		//最も近い順位の値を使う(補間しない)
+		const double clamped = std::clamp(p, 0.0, 1.0);
+		const size_t rank = clamped <= 0.0 ? 0 : std::min(n - 1, static_cast<size_t>(std::ceil(clamped * n)) - 1);
+		std::nth_element(scratch.begin(), scratch.begin() + rank, scratch.end());
+		return scratch[rank];
+	}
+
+	double FrameProfiler::phasePercentile(size_t phase, double p, size_t window)const
+	{
+		return percentile(p, window, [&](const Frame& frame) { return frame.phaseMs[phase]; });
+	}
+
+	double FrameProfiler::counterPercentile(size_t counter, double p, size_t window)const
+	{
+		return percentile(p, window, [&](const Frame& frame) { return frame.counts[counter]; });
+	}
+
+	double FrameProfiler::framePercentile(double p, size_t window)const
+	{
+		return percentile(p, window, [](const Frame& frame) { return frame.frameMs; });
+	}
+
+	double FrameProfiler::allocationPercentile(double p, size_t window)const
+	{
+		return percentile(p, window, [](const Frame& frame) { return frame.allocations; });
+	}
+
+	void FrameProfiler::writeCsv(std::ostream& os)const
+	{
+		os << "frame,frame_ms,allocations";
+		for (const auto& name : phases)
+		{
+			os << ',' << name << "_ms";
+		}
+		for (const auto& name : counters)
+		{
+			os << ',' << name;
+		}
+		os << '\n';
+
+		for (size_t i = count; 0 < i; --i)
+		{
+			const Frame& frame = recent(i - 1);
+			os << frame.index << ',' << frame.frameMs << ',' << frame.allocations;
+			for (const double ms : frame.phaseMs)
+			{
+				os << ',' << ms;
+			}
+			for (const double value : frame.counts)
+			{
+				os << ',' << value;
+			}
+			os << '\n';
+		}
+	}
+
+	void FrameProfiler::clear()
+	{
+		head = 0;
+		count = 0;
+		frameIndex = 0;
+	}
+}
@@ -0,0 +1,118 @@
+﻿# pragma once
+# include <chrono>
+# include <cstdint>
+# include <ostream>
+# include <string>
+# include <vector>
+
+namespace core
+{
+	//フレーム毎に、処理の区間ごとの時間と数(ノード数や描画回数など)を記録する
+	//区間と数は番号で指定する、番号は構築時に渡した名前の位置
+	//直近 historySize フレームを残しておき、パーセンタイルの計算と CSV の書き出しに使う
+	class FrameProfiler
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		FrameProfiler(std::vector<std::string> phaseNames, std::vector<std::string> counterNames, size_t historySize = 36000);
+
+		//フレームの始まりと終わり、間の時間とメモリ確保の回数もフレーム毎に記録する
+		void beginFrame();
+		void endFrame();
+
+		//今のフレームの区間 phase に時間を足す(同じ区間を何度測ってもよい)
+		void addTime(size_t phase, double ms);
+
+		void setCount(size_t counter, double value);
+
+		//直近 window フレームの区間の時間(ms)の p 分位点(p は 0 から 1)
+		double phasePercentile(size_t phase, double p, size_t window)const;
+
+		double counterPercentile(size_t counter, double p, size_t window)const;
+
+		//beginFrame から endFrame までの時間(ms)と、その間のメモリ確保の回数
+		double framePercentile(double p, size_t window)const;
+		double allocationPercentile(double p, size_t window)const;
+
+		const std::vector<std::string>& phaseNames()const
+		{
+			return phases;
+		}
+
+		const std::vector<std::string>& counterNames()const
+		{
+			return counters;
+		}
+
+		//残っているフレームの数
+		size_t recordedFrames()const
+		{
+			return count;
+		}
+
+		//残っているフレームを古い順に一行ずつ書き出す
+		void writeCsv(std::ostream& os)const;
+
+		void clear();
+
+	private:
+		struct Frame
+		{
+			std::uint64_t index = 0;
+			double frameMs = 0.0;
+			double allocations = 0.0;
+			std::vector<double> phaseMs;
+			std::vector<double> counts;
+		};
+
+		Frame& current()
+		{
+			return history[head];
+		}
+
+		//i 番目に新しいフレーム(0 が最新の記録済みのもの)
+		const Frame& recent(size_t i)const;
+
+		template <class Get>
+		double percentile(double p, size_t window, Get get)const;
+
+		std::vector<std::string> phases;
+		std::vector<std::string> counters;
+
+		//リングバッファ、history[head] が記録中のフレーム
+		std::vector<Frame> history;
+		size_t head = 0;
+		size_t count = 0;
+		std::uint64_t frameIndex = 0;
+
+		Clock::time_point frameBegin;
+		std::uint64_t allocationsAtBegin = 0;
+
+		mutable std::vector<double> scratch;
+	};
+
+	//スコープを抜けるまでの時間を区間 phase に足す
+	class ScopedPhase
+	{
+	public:
+		ScopedPhase(FrameProfiler& profiler, size_t phase)
+			: profiler(profiler)
+			, phase(phase)
+			, begin(FrameProfiler::Clock::now())
+		{}
+
+		~ScopedPhase()
+		{
+			profiler.addTime(phase, std::chrono::duration<double, std::milli>(FrameProfiler::Clock::now() - begin).count());
+		}
+
+		ScopedPhase(const ScopedPhase&) = delete;
+		ScopedPhase& operator=(const ScopedPhase&) = delete;
+
+	private:
+		FrameProfiler& profiler;
+		size_t phase;
+		FrameProfiler::Clock::time_point begin;
+	};
+}
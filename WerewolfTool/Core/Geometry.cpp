@@ -0,0 +1,155 @@
+﻿# include "Geometry.hpp"
+# include <cmath>
+
+namespace core
+{
+	Vec2 Line::closest(const Vec2& p)const
+	{
+		const Vec2 v = vector();
+		const double length = std::sqrt(v.lengthSq());
+		if (length == 0.0)
+		{
+			return begin;
+		}
+
+		const Vec2 direction = v / length;
+		const double t = direction.dot(p - begin);
+		if (t <= 0.0)
+		{
+			return begin;
+		}
+		if (length <= t)
+		{
+			return end;
+		}
+		return begin + direction * t;
+	}
+
+	bool Line::intersects(const Line& other)const
+	{
+		constexpr double Epsilon = 1e-10;
+
+		const Vec2 r = vector();
+		const Vec2 s = other.vector();
+		const Vec2 qp = other.begin - begin;
+		const double rxs = r.cross(s);
+		const double qpxr = qp.cross(r);
+
+		if (std::abs(rxs) < Epsilon)
+		{
+			if (Epsilon <= std::abs(qpxr))
+			{
+				//平行で同一直線上にない
+				return false;
+			}
+
+			//同一直線上: r 方向に射影した区間が重なるか
+			const double rr = r.dot(r);
+			if (rr < Epsilon)
+			{
+				return (begin - other.begin).lengthSq() < Epsilon || (begin - other.end).lengthSq() < Epsilon;
+			}
+
+			const double t0 = qp.dot(r) / rr;
+			const double t1 = t0 + s.dot(r) / rr;
+			return std::fmin(t0, t1) <= 1.0 && 0.0 <= std::fmax(t0, t1);
+		}
+
+		const double t = qp.cross(s) / rxs;
+		const double u = qpxr / rxs;
+		return 0.0 <= t && t <= 1.0 && 0.0 <= u && u <= 1.0;
+	}
+
+	std::pair<Vec2, Vec2> FixedPosVel(const Vec2& pos, const Vec2& vel, const RectF& rect)
+	{
+		if (rect.intersects(pos))
+		{
+			return { pos, vel };
+		}
+
+		const auto isOuter = [&](const Line& line)
+		{
+			return line.vector().cross(pos - line.begin) < 0.0;
+		};
+
+		const Line topLine(rect.tl(), rect.tr());
+		const Line rightLine(rect.tr(), rect.br());
+		const Line bottomLine(rect.br(), rect.bl());
+		const Line leftLine(rect.bl(), rect.tl());
+
+		const Line realTopLine(rect.tl(), rect.tr() + Vec2(1, 0));
+		const Line realRightLine(rect.tr() + Vec2(1, 0), rect.br() + Vec2(1, 1));
+		const Line realBottomLine(rect.br() + Vec2(1, 1), rect.bl() + Vec2(0, 1));
+		const Line realLeftLine(rect.bl() + Vec2(0, 1), rect.tl());
+
+		/*
+		0 | 1 | 2
+		---------
+		6 |   | 7
+		---------
+		5 | 4 | 3
+		*/
+
+		if (isOuter(topLine))
+		{
+			//case 0
+			if (isOuter(leftLine))return { rect.tl(), Vec2::Zero() };
+			//case 2
+			if (isOuter(rightLine))return { rect.tr(), Vec2::Zero() };
+			//case 1
+			return { realTopLine.closest(pos), Vec2(vel.x,0) };
+		}
+
+		if (isOuter(bottomLine))
+		{
+			//case 3
+			if (isOuter(rightLine))return { rect.br(), Vec2::Zero() };
+			//case 5
+			if (isOuter(leftLine))return { rect.bl(), Vec2::Zero() };
+			//case 4
+			return { realBottomLine.closest(pos), Vec2(vel.x,0) };
+		}
+
+		//case 6
+		if (isOuter(leftLine))return { realLeftLine.closest(pos), Vec2(0,vel.y) };
+		//case 7
+		return { realRightLine.closest(pos), Vec2(0,vel.y) };
+	}
+
+	Vec2 FixedRectPos(const RectF& rect, const RectF& scope)
+	{
+		if (scope.contains(rect))
+		{
+			return rect.pos;
+		}
+
+		const Vec2 fixVecBL = FixedPosVel(rect.bl(), Vec2::Zero(), scope).first - rect.bl();
+		const auto blFixedRect = rect.movedBy(fixVecBL);
+		if (scope.contains(blFixedRect))
+		{
+			return blFixedRect.pos;
+		}
+
+		const Vec2 fixVecTR = FixedPosVel(rect.tr(), Vec2::Zero(), scope).first - rect.tr();
+		const auto trFixedRect = rect.movedBy(fixVecTR);
+		if (scope.contains(trFixedRect))
+		{
+			return trFixedRect.pos;
+		}
+
+		const Vec2 fixVecBR = FixedPosVel(rect.br(), Vec2::Zero(), scope).first - rect.br();
+		return rect.movedBy(fixVecBR).pos;
+	}
+
+	std::optional<Line> CutoffLine(const Line& original, double lengthBegin, double lengthEnd)
+	{
+		const double l = lengthBegin + lengthEnd;
+		if (original.lengthSq() < l * l)
+		{
+			return std::nullopt;
+		}
+
+		const Vec2 v = original.vector() / std::sqrt(original.lengthSq());
+		return Line(original.begin + v * lengthBegin, original.end - v * lengthEnd);
+	}
+}
@@ -0,0 +1,83 @@
+﻿# pragma once
+# include <optional>
+# include <utility>
+# include "Vec2.hpp"
+
+namespace core
+{
+	struct RectF
+	{
+		Vec2 pos;
+		Vec2 size;
+
+		constexpr RectF() = default;
+		constexpr RectF(double x, double y, double w, double h)
+			: pos(x, y)
+			, size(w, h)
+		{}
+		constexpr RectF(const Vec2& pos, const Vec2& size)
+			: pos(pos)
+			, size(size)
+		{}
+
+		constexpr Vec2 tl()const { return pos; }
+		constexpr Vec2 tr()const { return pos + Vec2(size.x, 0); }
+		constexpr Vec2 br()const { return pos + size; }
+		constexpr Vec2 bl()const { return pos + Vec2(0, size.y); }
+		constexpr Vec2 center()const { return pos + size * 0.5; }
+
+		//Siv3DのRectF::intersects(Vec2)と同じく右端と下端は含まない
+		constexpr bool intersects(const Vec2& p)const
+		{
+			return pos.x <= p.x && p.x < pos.x + size.x && pos.y <= p.y && p.y < pos.y + size.y;
+		}
+
+		constexpr bool contains(const RectF& rect)const
+		{
+			return pos.x <= rect.pos.x && pos.y <= rect.pos.y
+				&& rect.pos.x + rect.size.x <= pos.x + size.x
+				&& rect.pos.y + rect.size.y <= pos.y + size.y;
+		}
+
+		constexpr RectF stretched(double x, double y)const
+		{
+			return RectF(pos - Vec2(x, y), size + Vec2(x, y) * 2.0);
+		}
+
+		constexpr RectF movedBy(const Vec2& v)const
+		{
+			return RectF(pos + v, size);
+		}
+	};
+
+	struct Line
+	{
+		Vec2 begin;
+		Vec2 end;
+
+		constexpr Line() = default;
+		constexpr Line(const Vec2& begin, const Vec2& end)
+			: begin(begin)
+			, end(end)
+		{}
+
+		constexpr Vec2 vector()const { return end - begin; }
+		constexpr double lengthSq()const { return vector().lengthSq(); }
+
+		//線分上で p に最も近い点
+		Vec2 closest(const Vec2& p)const;
+
+		//線分同士の交差判定(端点での接触と同一直線上の重なりも交差とみなす)
+		bool intersects(const Line& other)const;
+	};
+
+	//pos が rect の外に出ていたら rect の境界上に戻し、外向きの速度成分を打ち消す
+	//四隅の領域では速度を0に、辺の領域では辺に沿った成分だけを残す
+	std::pair<Vec2, Vec2> FixedPosVel(const Vec2& pos, const Vec2& vel, const RectF& rect);
+
+	//rect が scope からはみ出さないように平行移動した位置を返す
+	Vec2 FixedRectPos(const RectF& rect, const RectF& scope);
+
+	//始点側を lengthBegin, 終点側を lengthEnd だけ縮めた線分、縮めきれない場合は nullopt
+	std::optional<Line> CutoffLine(const Line& original, double lengthBegin, double lengthEnd);
+}
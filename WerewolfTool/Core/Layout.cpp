@@ -0,0 +1,769 @@
+﻿# include "Layout.hpp"
+# include <algorithm>
+# include <cmath>
+# include <limits>
+# include "SceneClamp.hpp"
+
+namespace core
+{
+	namespace
+	{
+		//一つのタスクが受け持つノード数
+		constexpr size_t RowsPerTask = 64;
+
+		//引力を足し込む区間の数はリンク数だけで決める
+		constexpr size_t LinksPerSlice = 2048;
+		constexpr size_t MaxSliceCount = 16;
+
+		size_t RowTaskCount(size_t n)
+		{
+			return (n + RowsPerTask - 1) / RowsPerTask;
+		}
+
+		//Adaptive の刻み幅を一度に変える倍率の範囲
+		constexpr double MinStepScale = 0.2;
+		constexpr double MaxStepScale = 2.0;
+
+		//relax で移動量を狭めるときの倍率と、広げるまでにエネルギーが下がり続ける回数(参考資料の値)
+		constexpr double RelaxCooling = 0.9;
+		constexpr int RelaxProgressSteps = 5;
+	}
+
+	const char* ToString(SimulationState state)
+	{
+		switch (state)
+		{
+		case SimulationState::Running:
+			return "running";
+		case SimulationState::Settled:
+			return "settled";
+		case SimulationState::Paused:
+			return "paused";
+		default:
+			return "unknown";
+		}
+	}
+
+	const char* ToString(Integrator integrator)
+	{
+		switch (integrator)
+		{
+		case Integrator::Euler:
+			return "euler";
+		case Integrator::SemiImplicitEuler:
+			return "semi-implicit-euler";
+		case Integrator::VelocityVerlet:
+			return "verlet";
+		case Integrator::Adaptive:
+			return "adaptive";
+		default:
+			return "unknown";
+		}
+	}
+
+	std::optional<Integrator> ParseIntegrator(std::string_view name)
+	{
+		for (const auto integrator : { Integrator::Euler, Integrator::SemiImplicitEuler, Integrator::VelocityVerlet, Integrator::Adaptive })
+		{
+			if (name == ToString(integrator))
+			{
+				return integrator;
+			}
+		}
+		return std::nullopt;
+	}
+
+	void Layout::update(Board& board, const RectF& scene)
+	{
+		if (isLocal())
+		{
+			relaxLocalRange(board, scene);
+			return;
+		}
+
+		begin(board);
+		if (params.integrator == Integrator::Adaptive)
+		{
+			adaptiveSteps(scene, params.dt * params.subSteps);
+		}
+		else
+		{
+			for (int i = 0; i < params.subSteps; ++i)
+			{
+				fixedStep(scene);
+			}
+		}
+		hot.store(board.nodes);
+	}
+
+	void Layout::advance(Board& board, const RectF& scene, double seconds)
+	{
+		if (isLocal())
+		{
+			relaxLocalRange(board, scene);
+			return;
+		}
+
+		accumulator = std::min(accumulator + seconds * params.simulationSpeed, params.dt * params.maxStepsPerAdvance);
+
+		if (params.integrator == Integrator::Adaptive)
+		{
+			if (accumulator <= 0.0)
+			{
+				return;
+			}
+
+			begin(board);
+			adaptiveSteps(scene, accumulator);
+			accumulator = 0.0;
+			hot.store(board.nodes);
+			return;
+		}
+
+		if (accumulator < params.dt)
+		{
+			return;
+		}
+
+		begin(board);
+		while (params.dt <= accumulator)
+		{
+			fixedStep(scene);
+			accumulator -= params.dt;
+		}
+		hot.store(board.nodes);
+	}
+
+	void Layout::step(Board& board, const RectF& scene)
+	{
+		begin(board);
+		if (params.integrator == Integrator::Adaptive)
+		{
+			adaptiveSteps(scene, params.dt);
+		}
+		else
+		{
+			fixedStep(scene);
+		}
+		hot.store(board.nodes);
+	}
+
+	int Layout::relax(Board& board, const RectF& scene, double stepLength, double tolerance, int maxIterations)
+	{
+		begin(board);
+
+		RelaxState state{ stepLength };
+		int iteration = 0;
+		relaxIterations(scene, state, tolerance, maxIterations, iteration);
+
+		std::fill(hot.vx.begin(), hot.vx.end(), 0.0);
+		std::fill(hot.vy.begin(), hot.vy.end(), 0.0);
+		hot.store(board.nodes);
+		forcesValid = false;
+
+		return iteration;
+	}
+
+	bool Layout::relaxIterations(const RectF& scene, RelaxState& state, double tolerance, int maxIterations, int& iteration)
+	{
+		const size_t n = hot.size();
+		const size_t rowTasks = RowTaskCount(n);
+		while (iteration < maxIterations)
+		{
+			++iteration;
+			accumulateForces(scene);
+
+			parallelFor(rowTasks, [&](size_t task)
+			{
+				const size_t first = task * RowsPerTask;
+				const size_t last = std::min(n, first + RowsPerTask);
+				double energy = 0.0;
+				double displacementSq = 0.0;
+				for (size_t me = first; me < last; ++me)
+				{
+					const double forceSq = fx[me] * fx[me] + fy[me] * fy[me];
+					if (hot.fixed[me] || !(0.0 < forceSq))
+					{
+						continue;
+					}
+
+					const Vec2 position(hot.x[me], hot.y[me]);
+					const Vec2 moved = position + Vec2(fx[me], fy[me]) * (state.stepLength / std::sqrt(forceSq));
+					const RectF scope = scene.stretched(-hot.radius[me], -hot.radius[me]);
+					const Vec2 next = FixedPosVel(moved, Vec2::Zero(), scope).first;
+					hot.x[me] = next.x;
+					hot.y[me] = next.y;
+
+					energy += forceSq;
+					displacementSq = std::max(displacementSq, (next - position).lengthSq());
+				}
+				taskEnergy[task] = energy;
+				taskDisplacement[task] = std::sqrt(displacementSq);
+			});
+
+			double energy = 0.0;
+			double displacement = 0.0;
+			for (size_t task = 0; task < rowTasks; ++task)
+			{
+				energy += taskEnergy[task];
+				displacement = std::max(displacement, taskDisplacement[task]);
+			}
+
+			if (energy < state.previousEnergy)
+			{
+				if (RelaxProgressSteps <= ++state.progress)
+				{
+					state.progress = 0;
+					state.stepLength /= RelaxCooling;
+				}
+			}
+			else
+			{
+				state.progress = 0;
+				state.stepLength *= RelaxCooling;
+			}
+			state.previousEnergy = energy;
+
+			if (displacement < tolerance)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void Layout::begin(const Board& board)
+	{
+		hot.load(board.nodes);
+		collectLinks(board.adjacents);
+		freezeOutsideLocalRange();
+
+		//前回から board が書き換えられているかもしれないので、力は計算し直す
+		forcesValid = false;
+
+		const size_t rowTasks = RowTaskCount(hot.size());
+		taskEnergy.resize(rowTasks);
+		taskDisplacement.resize(rowTasks);
+		taskError.resize(rowTasks);
+		startX.resize(hot.size());
+		startY.resize(hot.size());
+
+		if (adaptiveDt <= 0.0)
+		{
+			adaptiveDt = params.dt;
+		}
+	}
+
+	void Layout::fixedStep(const RectF& scene)
+	{
+		switch (params.integrator)
+		{
+		case Integrator::SemiImplicitEuler:
+			stepEuler(scene, params.dt, true);
+			break;
+		case Integrator::VelocityVerlet:
+			stepVerlet(scene, params.dt);
+			break;
+		default:
+			stepEuler(scene, params.dt, false);
+			break;
+		}
+		finishStep(params.dt);
+	}
+
+	void Layout::adaptiveSteps(const RectF& scene, double duration)
+	{
+		const double tolerance = params.adaptiveTolerance;
+		adaptiveDt = std::clamp(adaptiveDt, params.adaptiveMinDt, params.adaptiveMaxDt);
+
+		double remaining = duration;
+		while (0.0 < remaining)
+		{
+			const double h = std::min(adaptiveDt, remaining);
+			saved = hot;
+
+			const double error = stepVerlet(scene, h);
+
+			//誤差は h^3 に比例するとして次の刻み幅を決める
+			double scale = MaxStepScale;
+			if (error != error)
+			{
+				scale = MinStepScale;
+			}
+			else if (0.0 < error)
+			{
+				scale = std::clamp(0.9 * std::cbrt(tolerance / error), MinStepScale, MaxStepScale);
+			}
+
+			if (error <= tolerance || h <= params.adaptiveMinDt)
+			{
+				finishStep(h);
+				remaining -= h;
+
+				//残り時間に合わせて縮めたステップでは刻み幅を広げない
+				if (h == adaptiveDt || scale < 1.0)
+				{
+					adaptiveDt = std::clamp(h * scale, params.adaptiveMinDt, params.adaptiveMaxDt);
+				}
+			}
+			else
+			{
+				//位置と速度を戻す、力は戻した位置で計算したものが prevFx に残っている
+				hot = saved;
+				std::swap(fx, prevFx);
+				std::swap(fy, prevFy);
+				forcesValid = true;
+				adaptiveDt = std::max(params.adaptiveMinDt, h * scale);
+			}
+		}
+	}
+
+	void Layout::stepEuler(const RectF& scene, double h, bool semiImplicit)
+	{
+		if (!forcesValid)
+		{
+			accumulateForces(scene);
+		}
+
+		const size_t n = hot.size();
+		const double damping = h == params.dt ? params.resistance : std::pow(params.resistance, h / params.dt);
+		parallelFor(RowTaskCount(n), [&](size_t task)
+		{
+			const size_t first = task * RowsPerTask;
+			const size_t last = std::min(n, first + RowsPerTask);
+			for (size_t me = first; me < last; ++me)
+			{
+				if (hot.fixed[me])
+				{
+					hot.vx[me] = 0.0;
+					hot.vy[me] = 0.0;
+					continue;
+				}
+
+				const Vec2 position(hot.x[me], hot.y[me]);
+				const Vec2 velocity(hot.vx[me], hot.vy[me]);
+				const Vec2 nextVelocity = velocity + Vec2(fx[me], fy[me]) * h;
+				const Vec2 next = position + (semiImplicit ? nextVelocity : velocity) * h;
+				startX[me] = position.x;
+				startY[me] = position.y;
+				hot.x[me] = next.x;
+				hot.y[me] = next.y;
+				hot.vx[me] = nextVelocity.x;
+				hot.vy[me] = nextVelocity.y;
+			}
+
+			//壁の処理はタスクの区間ごとにまとめて行う
+			ClampToScene(params.forceKernel, scene, hot.radius.data(), hot.fixed.data(), first, last, hot.x.data(), hot.y.data(), hot.vx.data(), hot.vy.data());
+
+			double energy = 0.0;
+			double displacementSq = 0.0;
+			for (size_t me = first; me < last; ++me)
+			{
+				if (hot.fixed[me])
+				{
+					continue;
+				}
+
+				hot.vx[me] *= damping;
+				hot.vy[me] *= damping;
+
+				energy += 0.5 * (hot.vx[me] * hot.vx[me] + hot.vy[me] * hot.vy[me]);
+				displacementSq = std::max(displacementSq, (Vec2(hot.x[me], hot.y[me]) - Vec2(startX[me], startY[me])).lengthSq());
+			}
+			taskEnergy[task] = energy;
+			taskDisplacement[task] = std::sqrt(displacementSq);
+		});
+
+		forcesValid = false;
+	}
+
+	double Layout::stepVerlet(const RectF& scene, double h)
+	{
+		if (!forcesValid)
+		{
+			accumulateForces(scene);
+		}
+
+		const size_t n = hot.size();
+		const size_t rowTasks = RowTaskCount(n);
+		const double damping = h == params.dt ? params.resistance : std::pow(params.resistance, h / params.dt);
+
+		//半ステップぶん速度を進めて、その速度で位置を進める
+		//運動エネルギーは実際に位置を進めた速度で測る
+		parallelFor(rowTasks, [&](size_t task)
+		{
+			const size_t first = task * RowsPerTask;
+			const size_t last = std::min(n, first + RowsPerTask);
+			for (size_t me = first; me < last; ++me)
+			{
+				if (hot.fixed[me])
+				{
+					hot.vx[me] = 0.0;
+					hot.vy[me] = 0.0;
+					continue;
+				}
+
+				const Vec2 position(hot.x[me], hot.y[me]);
+				const Vec2 halfVelocity = Vec2(hot.vx[me], hot.vy[me]) + Vec2(fx[me], fy[me]) * (0.5 * h);
+				const Vec2 next = position + halfVelocity * h;
+				startX[me] = position.x;
+				startY[me] = position.y;
+				hot.x[me] = next.x;
+				hot.y[me] = next.y;
+				hot.vx[me] = halfVelocity.x;
+				hot.vy[me] = halfVelocity.y;
+			}
+
+			ClampToScene(params.forceKernel, scene, hot.radius.data(), hot.fixed.data(), first, last, hot.x.data(), hot.y.data(), hot.vx.data(), hot.vy.data());
+
+			double energy = 0.0;
+			double displacementSq = 0.0;
+			for (size_t me = first; me < last; ++me)
+			{
+				if (hot.fixed[me])
+				{
+					continue;
+				}
+
+				energy += 0.5 * Vec2(hot.vx[me], hot.vy[me]).lengthSq();
+				displacementSq = std::max(displacementSq, (Vec2(hot.x[me], hot.y[me]) - Vec2(startX[me], startY[me])).lengthSq());
+			}
+			taskEnergy[task] = energy;
+			taskDisplacement[task] = std::sqrt(displacementSq);
+		});
+
+		//新しい位置での力、前の力は prevFx に残す
+		std::swap(fx, prevFx);
+		std::swap(fy, prevFy);
+		accumulateForces(scene);
+
+		//新しい位置での力で残りの半ステップぶん速度を進める
+		//オイラー法との位置の差 |F' - F| h^2 / 2 を誤差とみなす
+		parallelFor(rowTasks, [&](size_t task)
+		{
+			const size_t first = task * RowsPerTask;
+			const size_t last = std::min(n, first + RowsPerTask);
+			double errorSq = 0.0;
+			for (size_t me = first; me < last; ++me)
+			{
+				if (hot.fixed[me])
+				{
+					continue;
+				}
+
+				const double dfx = fx[me] - prevFx[me];
+				const double dfy = fy[me] - prevFy[me];
+				errorSq = std::max(errorSq, dfx * dfx + dfy * dfy);
+
+				double vx = (hot.vx[me] + fx[me] * (0.5 * h)) * damping;
+				double vy = (hot.vy[me] + fy[me] * (0.5 * h)) * damping;
+
+				//FixedPosVel と同じく、壁に接しているノードは壁に向かう速度を持たない
+				const RectF scope = scene.stretched(-hot.radius[me], -hot.radius[me]);
+				if ((hot.x[me] <= scope.pos.x && vx < 0.0) || (scope.pos.x + scope.size.x <= hot.x[me] && 0.0 < vx))
+				{
+					vx = 0.0;
+				}
+				if ((hot.y[me] <= scope.pos.y && vy < 0.0) || (scope.pos.y + scope.size.y <= hot.y[me] && 0.0 < vy))
+				{
+					vy = 0.0;
+				}
+
+				hot.vx[me] = vx;
+				hot.vy[me] = vy;
+			}
+			taskError[task] = 0.5 * std::sqrt(errorSq) * h * h;
+		});
+
+		double error = 0.0;
+		for (size_t task = 0; task < rowTasks; ++task)
+		{
+			//NaN を取りこぼさないように比較する
+			if (!(taskError[task] <= error))
+			{
+				error = taskError[task];
+			}
+		}
+		return error;
+	}
+
+	void Layout::finishStep(double h)
+	{
+		lastKineticEnergy = 0.0;
+		lastMaxDisplacement = 0.0;
+		for (size_t task = 0; task < taskEnergy.size(); ++task)
+		{
+			lastKineticEnergy += taskEnergy[task];
+			lastMaxDisplacement = std::max(lastMaxDisplacement, taskDisplacement[task]);
+		}
+		lastMaxDisplacement *= params.dt / h;
+
+		const double energyThreshold = params.settleEnergyPerNode * static_cast<double>(hot.size());
+		if (lastKineticEnergy < energyThreshold && lastMaxDisplacement < params.settleDisplacement)
+		{
+			settledTime += h;
+		}
+		else
+		{
+			settledTime = 0.0;
+		}
+	}
+
+	void Layout::wakeAround(const std::vector<int>& seeds)
+	{
+		if (!isSettled() && !isLocal())
+		{
+			return;
+		}
+
+		//落ち着いた後の操作なら範囲を作り直し、範囲を動かしている途中なら起点を足す
+		if (isSettled())
+		{
+			localSeeds.clear();
+		}
+		localSeeds.insert(localSeeds.end(), seeds.begin(), seeds.end());
+		localRelax = RelaxState{ params.localStep * params.naturalDistance };
+		localIterations = 0;
+		settledTime = 0.0;
+	}
+
+	void Layout::relaxLocalRange(Board& board, const RectF& scene)
+	{
+		begin(board);
+
+		int iterations = 0;
+		const bool isConverged = relaxIterations(scene, localRelax, params.localTolerance * params.naturalDistance, params.localIterationsPerUpdate, iterations);
+		localIterations += iterations;
+
+		std::fill(hot.vx.begin(), hot.vx.end(), 0.0);
+		std::fill(hot.vy.begin(), hot.vy.end(), 0.0);
+		hot.store(board.nodes);
+		forcesValid = false;
+		lastKineticEnergy = 0.0;
+		lastMaxDisplacement = 0.0;
+
+		if (isConverged)
+		{
+			settledTime = params.settleTime;
+		}
+		else if (params.localMaxIterations <= localIterations)
+		{
+			//範囲の中だけでは整わないので、次から盤面全体を動かす
+			wake();
+		}
+	}
+
+	void Layout::freezeOutsideLocalRange()
+	{
+		const size_t n = hot.size();
+		if (!isLocal())
+		{
+			activeNodes = n;
+			return;
+		}
+
+		hopCounts.assign(n, -1);
+		for (const int seed : localSeeds)
+		{
+			if (0 <= seed && static_cast<size_t>(seed) < n)
+			{
+				hopCounts[seed] = 0;
+			}
+		}
+
+		//localHops は小さいので、隣接リストを作らずにリンクの一覧を localHops 回なめる
+		for (int hop = 0; hop < params.localHops; ++hop)
+		{
+			for (const auto& [a, b] : links)
+			{
+				if (hopCounts[a] == hop && hopCounts[b] < 0)
+				{
+					hopCounts[b] = hop + 1;
+				}
+				else if (hopCounts[b] == hop && hopCounts[a] < 0)
+				{
+					hopCounts[a] = hop + 1;
+				}
+			}
+		}
+
+		activeNodes = 0;
+		for (size_t i = 0; i < n; ++i)
+		{
+			if (hopCounts[i] < 0)
+			{
+				hot.fixed[i] = 1;
+			}
+			else if (!hot.fixed[i])
+			{
+				++activeNodes;
+			}
+		}
+	}
+
+	void Layout::collectLinks(const EdgeStore& adjacents)
+	{
+		links.clear();
+
+		//運動方程式を解く時はリンクの向きは考慮しない
+		adjacents.forEach([&](int from, int to, char)
+		{
+			//両方向にリンクがある場合は一度だけ数える
+			if (from == to || (to < from && adjacents.get(to, from) != 0))
+			{
+				return;
+			}
+			links.emplace_back(from, to);
+		});
+
+		sliceCount = std::min(MaxSliceCount, (links.size() + LinksPerSlice - 1) / LinksPerSlice);
+		sliceFx.resize(sliceCount * hot.size());
+		sliceFy.resize(sliceCount * hot.size());
+	}
+
+	void Layout::parallelFor(size_t taskCount, const std::function<void(size_t)>& func)
+	{
+		const size_t threadCount = params.threadCount == 0 ? ThreadPool::HardwareThreadCount() : params.threadCount;
+		if (threadCount <= 1 || hot.size() < params.parallelThreshold)
+		{
+			for (size_t i = 0; i < taskCount; ++i)
+			{
+				func(i);
+			}
+			return;
+		}
+
+		//スレッドは作り直さずに使い回す
+		if (!threadPool || threadPool->threadCount() != threadCount)
+		{
+			threadPool = std::make_unique<ThreadPool>(threadCount);
+		}
+		threadPool->parallelFor(taskCount, func);
+	}
+
+	void Layout::accumulateForces(const RectF& scene)
+	{
+		const size_t n = hot.size();
+
+		const double K = params.naturalDistance;
+		const double K2 = K * K;
+		const double C = params.relativeStrength;
+		const Vec2 center = scene.center();
+
+		fx.resize(n);
+		fy.resize(n);
+
+		//ノード数が多いときは四分木で近似してO(n log n)にする
+		const bool useBarnesHut = params.barnesHutThreshold <= n;
+		if (useBarnesHut)
+		{
+			quadTree.build(hot.x, hot.y);
+		}
+
+		//前半のタスクはノードごとの求心力と斥力、後半のタスクは区間ごとの引力
+		//どちらも書き込み先がタスクごとに分かれているのでロックは要らない
+		const size_t rowTasks = RowTaskCount(n);
+		parallelFor(rowTasks + sliceCount, [&](size_t task)
+		{
+			if (task < rowTasks)
+			{
+				const size_t first = task * RowsPerTask;
+				const size_t last = std::min(n, first + RowsPerTask);
+
+				//散らばりすぎないように求心力も少し加える
+				for (size_t me = first; me < last; ++me)
+				{
+					fx[me] = 0.0;
+					fy[me] = 0.0;
+					if (hot.fixed[me])
+					{
+						continue;
+					}
+
+					const Vec2 toCenter = center - Vec2(hot.x[me], hot.y[me]);
+					const double scale = params.centripetal * toCenter.length() / K;
+					fx[me] += scale * toCenter.x;
+					fy[me] += scale * toCenter.y;
+				}
+
+				//全ての頂点間の斥力
+				if (useBarnesHut)
+				{
+					for (size_t me = first; me < last; ++me)
+					{
+						if (hot.fixed[me])
+						{
+							continue;
+						}
+
+						const Vec2 repulsion = quadTree.repulsion(me, C * K2, params.barnesHutTheta);
+						fx[me] += repulsion.x;
+						fy[me] += repulsion.y;
+					}
+				}
+				else
+				{
+					AccumulateRepulsion(params.forceKernel, hot.x.data(), hot.y.data(), hot.fixed.data(), n, C * K2, first, last, fx.data(), fy.data());
+				}
+				return;
+			}
+
+			//リンク間の引力
+			const size_t slice = task - rowTasks;
+			double* sfx = sliceFx.data() + slice * n;
+			double* sfy = sliceFy.data() + slice * n;
+			std::fill(sfx, sfx + n, 0.0);
+			std::fill(sfy, sfy + n, 0.0);
+
+			const size_t begin = links.size() * slice / sliceCount;
+			const size_t end = links.size() * (slice + 1) / sliceCount;
+			for (size_t k = begin; k < end; ++k)
+			{
+				const auto [from, to] = links[k];
+				const double dx = hot.x[to] - hot.x[from];
+				const double dy = hot.y[to] - hot.y[from];
+				const double scale = params.attraction * std::sqrt(dx * dx + dy * dy) / K;
+				sfx[from] += scale * dx;
+				sfy[from] += scale * dy;
+				sfx[to] -= scale * dx;
+				sfy[to] -= scale * dy;
+			}
+		});
+
+		//区間ごとの引力を決まった順番で合計する
+		if (0 < sliceCount)
+		{
+			parallelFor(rowTasks, [&](size_t task)
+			{
+				const size_t first = task * RowsPerTask;
+				const size_t last = std::min(n, first + RowsPerTask);
+				for (size_t slice = 0; slice < sliceCount; ++slice)
+				{
+					for (size_t me = first; me < last; ++me)
+					{
+						fx[me] += sliceFx[slice * n + me];
+						fy[me] += sliceFy[slice * n + me];
+					}
+				}
+			});
+		}
+
+		forcesValid = true;
+		++forceEvaluationCount;
+	}
+
+	void Layout::resetInvalidNodes(Board& board, const RectF& scene)
+	{
+		std::uniform_real_distribution<double> x(scene.pos.x, scene.pos.x + scene.size.x);
+		std::uniform_real_distribution<double> y(scene.pos.y, scene.pos.y + scene.size.y);
+
+		for (auto& node : board.nodes)
+		{
+			if (node.position != node.position || node.velocity != node.velocity)
+			{
+				node.position = FixedPosVel(Vec2(x(rng), y(rng)), Vec2::Zero(), scene).first;
+				node.velocity = Vec2::Zero();
+			}
+		}
+	}
+}
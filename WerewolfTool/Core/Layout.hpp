@@ -0,0 +1,297 @@
+﻿# pragma once
+# include <cstdint>
+# include <limits>
+# include <memory>
+# include <optional>
+# include <random>
+# include <string_view>
+# include <utility>
+# include <vector>
+# include "Board.hpp"
+# include "ForceKernel.hpp"
+# include "NodeArrays.hpp"
+# include "QuadTree.hpp"
+# include "ThreadPool.hpp"
+
+namespace core
+{
+	//積分の方法
+	enum class Integrator
+	{
+		//位置を古い速度で進める陽的オイラー法(以前からの方法)
+		Euler,
+
+		//速度を先に更新して、新しい速度で位置を進める
+		SemiImplicitEuler,
+
+		//速度ベルレ法、前のステップの力を使い回すので1ステップあたりの力の計算は1回
+		VelocityVerlet,
+
+		//速度ベルレ法の刻み幅を、オイラー法との差から見積もった誤差が adaptiveTolerance に収まるように変える
+		Adaptive,
+	};
+
+	const char* ToString(Integrator integrator);
+
+	std::optional<Integrator> ParseIntegrator(std::string_view name);
+
+	struct LayoutParams
+	{
+		//バネの自然長
+		double naturalDistance = 300.0;
+
+		//斥力の強さ
+		double relativeStrength = 0.2;
+
+		//リンク間の引力の強さ
+		double attraction = 0.175;
+
+		//散らばりすぎないようにする求心力の強さ
+		double centripetal = 0.5;
+
+		//1ステップで進める時間と、1ステップあたりの速度の減衰
+		//刻み幅が変わるときは dt あたり resistance になるように換算する
+		double dt = 0.005;
+		double resistance = 0.995;
+
+		//update 一回で進める時間(dt * subSteps)
+		int subSteps = 10;
+
+		Integrator integrator = Integrator::Euler;
+
+		//advance で実時間1秒あたりに進めるシミュレーション上の時間
+		//60fpsで毎フレーム subSteps 回積分していたときと同じ速さ
+		double simulationSpeed = 3.0;
+
+		//advance 一回で進める時間の上限(dt の何倍か)、処理が追いつかないときは残りを捨てる
+		int maxStepsPerAdvance = 60;
+
+		//Adaptive で1ステップに許す位置の誤差[px]と、刻み幅の範囲
+		double adaptiveTolerance = 0.05;
+		double adaptiveMinDt = 0.001;
+		double adaptiveMaxDt = 0.1;
+
+		//Barnes-Hut近似の精度(0で総当たりと一致)と、近似に切り替えるノード数
+		//RepulsionBenchmark で 256 ノード付近から近似の方が速くなる
+		double barnesHutTheta = 0.5;
+		size_t barnesHutThreshold = 256;
+
+		//総当たりの斥力計算と壁の処理(ClampToScene)に使う実装
+		ForceKernel forceKernel = ForceKernel::Auto;
+
+		//力の計算と積分の並列数(呼び出し元のスレッドを含む)、0 ならCPUの論理コア数、1 なら単一スレッド
+		//作業の分け方はスレッド数によらないので、結果はスレッド数を変えてもビット単位で一致する
+		size_t threadCount = 0;
+
+		//これより少ないノード数では並列化しない(スレッドを起こす方が遅い)
+		size_t parallelThreshold = 512;
+
+		//1ステップの運動エネルギーの合計(1ノードあたり)と dt あたりの最大移動量[px]がどちらも閾値を下回る状態が
+		//シミュレーション上の時間で settleTime 続いたら、盤面が落ち着いたとみなして計算を止める
+		double settleEnergyPerNode = 0.5;
+		double settleDisplacement = 0.01;
+		double settleTime = 1.5;
+
+		//wakeAround で動かすのは、操作したノードからリンクを localHops 本までたどって届くノード
+		int localHops = 2;
+
+		//wakeAround の範囲は積分せずに relax と同じ反復で整える
+		//最初に動かす距離と、止める移動量(naturalDistance に対する割合)
+		double localStep = 0.1;
+		double localTolerance = 0.0001;
+
+		//update 一回で行う反復の回数と、整うまでに許す反復の回数(超えたら盤面全体を動かす)
+		int localIterationsPerUpdate = 50;
+		int localMaxIterations = 1000;
+	};
+
+	//画面に表示するための、レイアウト計算の状態
+	enum class SimulationState
+	{
+		//計算中
+		Running,
+
+		//盤面が落ち着いたので止めている
+		Settled,
+
+		//ユーザーが止めている
+		Paused,
+	};
+
+	const char* ToString(SimulationState state);
+
+	//参考資料: http://asus.myds.me:6543/paper/nw/Efficient,%20High-QualityForce-Directed%20GraphDrawing.pdf
+	class Layout
+	{
+	public:
+		Layout() = default;
+		explicit Layout(const LayoutParams& params)
+			: params(params)
+		{}
+
+		//dt * subSteps だけ時間を進める
+		//盤面が落ち着いたかどうかも判定するが、落ち着いた後も呼ばれれば積分する
+		void update(Board& board, const RectF& scene);
+
+		//実時間で seconds 秒経ったぶんだけ時間を進める
+		//固定の刻み幅で進めきれなかった時間は次の呼び出しに持ち越すので、描画のフレームレートによらず同じ速さで動く
+		void advance(Board& board, const RectF& scene, double seconds);
+
+		//一回だけ積分する
+		void step(Board& board, const RectF& scene);
+
+		//速度を使わずに、各ノードを力の向きに stepLength だけ動かすことを繰り返す(参考資料の反復)
+		//全体のエネルギー(力の大きさの二乗和)が5回続けて下がったら stepLength を広げ、上がったら狭める
+		//最大移動量が tolerance を下回るか maxIterations 回反復したら止めて、反復した回数を返す
+		//止めたときは全ての速度を0にする
+		int relax(Board& board, const RectF& scene, double stepLength, double tolerance, int maxIterations);
+
+		//NaN対策：二つのノードが完全に重なったとき反発力がNaNになる
+		//二つのノードが完全に重なることは基本無いがFixedPosVelで位置が四隅に補正された場合はあり得る
+		void resetInvalidNodes(Board& board, const RectF& scene);
+
+		//盤面が落ち着いていて update を呼ぶ必要が無いか
+		bool isSettled()const
+		{
+			return params.settleTime <= settledTime;
+		}
+
+		//リンクの追加や削除、ノードの移動など、レイアウトが変わる操作をしたときに呼ぶ
+		//盤面全体を動かす
+		void wake()
+		{
+			settledTime = 0.0;
+			localSeeds.clear();
+		}
+
+		//リンク一本の追加や削除、ノードの固定の切り替えなど、一部だけが変わる操作をしたときに呼ぶ
+		//seeds からリンクを params.localHops 本までたどった範囲のノードだけを、update のたびに relax の反復で少しずつ整える
+		//それ以外のノードは止めておき、整った時点で落ち着いたとみなす
+		//localMaxIterations 回反復しても整わなければ盤面全体を動かす、盤面全体が動いている間はそのまま
+		void wakeAround(const std::vector<int>& seeds);
+
+		//wakeAround の範囲だけを動かしているか
+		bool isLocal()const
+		{
+			return !localSeeds.empty();
+		}
+
+		//最後に begin したときに動かしたノードの数(位置を固定したノードは除く)
+		size_t activeNodeCount()const
+		{
+			return activeNodes;
+		}
+
+		//最後に積分したステップの運動エネルギーの合計
+		double kineticEnergy()const
+		{
+			return lastKineticEnergy;
+		}
+
+		//最後に積分したステップで最も大きく動いたノードの移動量(dt あたりに換算)
+		double maxDisplacement()const
+		{
+			return lastMaxDisplacement;
+		}
+
+		//これまでに力を計算した回数
+		std::uint64_t forceEvaluations()const
+		{
+			return forceEvaluationCount;
+		}
+
+		LayoutParams params;
+
+	private:
+		//board を読み込んで積分の準備をする
+		void begin(const Board& board);
+
+		//params.integrator で dt だけ進める(Adaptive は除く)
+		void fixedStep(const RectF& scene);
+
+		//duration だけ Adaptive で進める
+		void adaptiveSteps(const RectF& scene, double duration);
+
+		void stepEuler(const RectF& scene, double h, bool semiImplicit);
+
+		//見積もった誤差を返す
+		double stepVerlet(const RectF& scene, double h);
+
+		//タスクごとの運動エネルギーと移動量を集計して、落ち着いたかを判定する
+		void finishStep(double h);
+
+		//現在の位置での力を fx, fy に求める
+		void accumulateForces(const RectF& scene);
+
+		//両方向のリンクを一本にまとめた、引力を計算するリンクの一覧を作る
+		void collectLinks(const EdgeStore& adjacents);
+
+		//wakeAround の範囲外のノードを、この begin の間だけ位置を固定したものとして扱う
+		void freezeOutsideLocalRange();
+
+		//relax の反復の途中の状態、update をまたいで続けるときに持っておく
+		struct RelaxState
+		{
+			double stepLength = 0.0;
+			double previousEnergy = std::numeric_limits<double>::infinity();
+			int progress = 0;
+		};
+
+		//iteration が maxIterations になるまで反復する、最大移動量が tolerance を下回ったら true を返す
+		bool relaxIterations(const RectF& scene, RelaxState& state, double tolerance, int maxIterations, int& iteration);
+
+		//wakeAround の範囲を localIterationsPerUpdate 回だけ反復して整える
+		void relaxLocalRange(Board& board, const RectF& scene);
+
+		//タスクをスレッドプールに配る、並列化しないときはこのスレッドで順に実行する
+		void parallelFor(size_t taskCount, const std::function<void(size_t)>& func);
+
+		//積分中の位置と速度、update の最初に board から読み込んで最後に書き戻す
+		NodeArrays hot;
+		std::vector<double> fx;
+		std::vector<double> fy;
+
+		//fx, fy が今の位置での力か(速度ベルレ法で前のステップの力を使い回す)
+		bool forcesValid = false;
+		std::vector<double> prevFx;
+		std::vector<double> prevFy;
+
+		//Adaptive で誤差が大きかったときにステップをやり直すための位置と速度
+		NodeArrays saved;
+		double adaptiveDt = 0.0;
+
+		//advance で進めきれなかった時間
+		double accumulator = 0.0;
+
+		//引力はリンクの両端に書き込むので、リンクを固定の数の区間に分けて区間ごとに別の配列に足し込み
+		//力の計算の最後に区間の順に合計する
+		std::vector<std::pair<int, int>> links;
+		size_t sliceCount = 0;
+		std::vector<double> sliceFx;
+		std::vector<double> sliceFy;
+
+		//積分のタスクごとの運動エネルギーと最大移動量と誤差、タスクの順に集計する
+		std::vector<double> taskEnergy;
+		std::vector<double> taskDisplacement;
+		std::vector<double> taskError;
+
+		//wakeAround の起点、空なら盤面全体を動かす
+		std::vector<int> localSeeds;
+		std::vector<int> hopCounts;
+		size_t activeNodes = 0;
+		RelaxState localRelax;
+		int localIterations = 0;
+
+		//積分のステップで動かす前の位置、ClampToScene の後で移動量を測るのに使う
+		std::vector<double> startX;
+		std::vector<double> startY;
+		double lastKineticEnergy = 0.0;
+		double lastMaxDisplacement = 0.0;
+		double settledTime = 0.0;
+		std::uint64_t forceEvaluationCount = 0;
+
+		QuadTree quadTree;
+		std::unique_ptr<ThreadPool> threadPool;
+		std::mt19937 rng;
+	};
+}
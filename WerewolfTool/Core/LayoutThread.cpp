@@ -0,0 +1,208 @@
+﻿# include "LayoutThread.hpp"
+# include <chrono>
+# include <type_traits>
+# include "Multilevel.hpp"
+
+namespace core
+{
+	namespace
+	{
+		//盤面が動いている間、自分で進めるときの周期
+		//落ち着いているときや止めているときは、コマンドが届くまで眠る
+		constexpr std::chrono::microseconds TickInterval(1000000 / 120);
+
+		constexpr size_t CommandCapacity = 1024;
+	}
+
+	LayoutThread::LayoutThread(const LayoutParams& params, bool isLockstep)
+		: isLockstep(isLockstep)
+		, layout(params)
+		, commands(CommandCapacity)
+	{
+		thread = std::thread([this] { run(); });
+	}
+
+	LayoutThread::~LayoutThread()
+	{
+		{
+			std::lock_guard lock(wakeMutex);
+			stopping = true;
+		}
+		wakeCondition.notify_one();
+		thread.join();
+	}
+
+	std::uint64_t LayoutThread::send(Command command)
+	{
+		pending.emplace_back(++serial, std::move(command));
+		flush();
+		return serial;
+	}
+
+	void LayoutThread::flush()
+	{
+		bool isPushed = false;
+		while (!pending.empty() && commands.push(std::move(pending.front())))
+		{
+			pending.pop_front();
+			isPushed = true;
+		}
+
+		if (isPushed)
+		{
+			//スレッドが空のキューを見てから眠るまでの間に積んだ場合も起こせるように、ロックを取ってから知らせる
+			{
+				std::lock_guard lock(wakeMutex);
+			}
+			wakeCondition.notify_one();
+		}
+	}
+
+	void LayoutThread::waitForCommand()
+	{
+		std::unique_lock lock(wakeMutex);
+		wakeCondition.wait(lock, [&] { return stopping || !commands.empty(); });
+	}
+
+	void LayoutThread::run()
+	{
+		using Clock = std::chrono::steady_clock;
+		auto previous = Clock::now();
+		std::pair<std::uint64_t, Command> command;
+		while (!stopping)
+		{
+			bool isChanged = false;
+			while (commands.pop(command))
+			{
+				appliedSerial = command.first;
+				apply(command.second);
+				isChanged = true;
+			}
+
+			if (isLockstep)
+			{
+				if (!isChanged)
+				{
+					waitForCommand();
+				}
+				continue;
+			}
+
+			const auto now = Clock::now();
+			const double seconds = std::chrono::duration<double>(now - previous).count();
+			previous = now;
+
+			const bool isActive = isRunning && !layout.isSettled() && !board.nodes.empty();
+			if (isActive)
+			{
+				layout.resetInvalidNodes(board, scene);
+				layout.advance(board, scene, seconds);
+			}
+			if (isActive || isChanged)
+			{
+				publish();
+			}
+
+			if (isActive)
+			{
+				std::this_thread::sleep_until(now + std::chrono::duration_cast<Clock::duration>(TickInterval));
+			}
+			else
+			{
+				waitForCommand();
+
+				//眠っていた時間は進めない
+				previous = Clock::now();
+			}
+		}
+	}
+
+	void LayoutThread::apply(Command& command)
+	{
+		std::visit([&](auto& c)
+		{
+			using T = std::decay_t<decltype(c)>;
+			if constexpr (std::is_same_v<T, Reset>)
+			{
+				board = std::move(c.board);
+				scene = c.scene;
+				isRunning = true;
+				layout.wake();
+			}
+			else if constexpr (std::is_same_v<T, SetLink>)
+			{
+				if (board.link(c.from, c.to) != c.color)
+				{
+					board.setLink(c.from, c.to, c.color);
+					layout.wakeAround({ c.from, c.to });
+				}
+			}
+			else if constexpr (std::is_same_v<T, MoveNode>)
+			{
+				board.nodes[c.index].position = c.position;
+				layout.wake();
+			}
+			else if constexpr (std::is_same_v<T, SetAutoLayout>)
+			{
+				board.nodes[c.index].isAutoLayout = c.isAutoLayout;
+				layout.wakeAround({ c.index });
+			}
+			else if constexpr (std::is_same_v<T, SetScene>)
+			{
+				scene = c.scene;
+			}
+			else if constexpr (std::is_same_v<T, SetRunning>)
+			{
+				isRunning = c.isRunning;
+				layout.wake();
+			}
+			else if constexpr (std::is_same_v<T, Relayout>)
+			{
+				MultilevelLayout(board, scene, layout.params);
+				layout.wake();
+			}
+			else if constexpr (std::is_same_v<T, Advance>)
+			{
+				//LayoutRunner と同じ順に、壊れたノードを戻してから進める
+				layout.resetInvalidNodes(board, scene);
+				if (isRunning)
+				{
+					if (0.0 < c.seconds)
+					{
+						layout.advance(board, scene, c.seconds);
+					}
+					else
+					{
+						layout.update(board, scene);
+					}
+				}
+				publish();
+			}
+		}, command);
+	}
+
+	void LayoutThread::publish()
+	{
+		//書き込み先は前に使った領域なので、要素数が変わらなければ確保し直さない
+		LayoutFrame& frame = frames.back();
+		frame.positions.resize(board.nodes.size());
+		frame.velocities.resize(board.nodes.size());
+		for (size_t i = 0; i < board.nodes.size(); ++i)
+		{
+			frame.positions[i] = board.nodes[i].position;
+			frame.velocities[i] = board.nodes[i].velocity;
+		}
+
+		if (!isRunning)
+		{
+			frame.state = SimulationState::Paused;
+		}
+		else
+		{
+			frame.state = layout.isSettled() ? SimulationState::Settled : SimulationState::Running;
+		}
+		frame.commandSerial = appliedSerial;
+		frame.forceEvaluations = layout.forceEvaluations();
+		frames.publish();
+	}
+}
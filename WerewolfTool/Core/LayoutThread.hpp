@@ -0,0 +1,163 @@
+﻿# pragma once
+# include <atomic>
+# include <condition_variable>
+# include <cstdint>
+# include <deque>
+# include <mutex>
+# include <thread>
+# include <variant>
+# include <vector>
+# include "Board.hpp"
+# include "Layout.hpp"
+# include "SpscQueue.hpp"
+# include "TripleBuffer.hpp"
+
+namespace core
+{
+	//LayoutThread が公開するレイアウトの結果
+	struct LayoutFrame
+	{
+		//盤面のノードと同じ順番
+		std::vector<Vec2> positions;
+		std::vector<Vec2> velocities;
+
+		//計算を止めているか、盤面が落ち着いたか
+		SimulationState state = SimulationState::Running;
+
+		//この番号までに送ったコマンドを反映している(LayoutThread::send が返す番号)
+		std::uint64_t commandSerial = 0;
+
+		//Layout::forceEvaluations
+		std::uint64_t forceEvaluations = 0;
+	};
+
+	//レイアウト計算を専用のスレッドで行う
+	//盤面の編集はコマンドのキューで送り、結果は三重バッファで受け取るので、呼び出し側はスレッドを待たない
+	//スレッドは盤面の複製を持ち、リンクや位置の固定などレイアウトに関わる値だけをコマンドで合わせる
+	class LayoutThread
+	{
+	public:
+		//盤面を置き換える
+		struct Reset
+		{
+			Board board;
+			RectF scene;
+		};
+
+		//Board::setLink と同じ、変わったときは両端の周りを Layout::wakeAround で整える
+		struct SetLink
+		{
+			int from;
+			int to;
+			char color;
+		};
+
+		//ドラッグ中のノードを動かす
+		struct MoveNode
+		{
+			int index;
+			Vec2 position;
+		};
+
+		//Node::isAutoLayout の切り替え
+		struct SetAutoLayout
+		{
+			int index;
+			bool isAutoLayout;
+		};
+
+		struct SetScene
+		{
+			RectF scene;
+		};
+
+		//計算を止める、再開する
+		struct SetRunning
+		{
+			bool isRunning;
+		};
+
+		//多段階法で盤面全体を配置し直す
+		struct Relayout
+		{};
+
+		//isLockstep のときだけ使う、seconds だけ Layout::advance で進める(0 なら Layout::update を一回)
+		struct Advance
+		{
+			double seconds;
+		};
+
+		using Command = std::variant<Reset, SetLink, MoveNode, SetAutoLayout, SetScene, SetRunning, Relayout, Advance>;
+
+		//isLockstep: false なら経過時間に合わせて自分で進める
+		//true なら Advance を受け取ったときだけ進めて、その度に結果を公開する(一つのスレッドで計算した結果と比べるため)
+		explicit LayoutThread(const LayoutParams& params, bool isLockstep = false);
+
+		~LayoutThread();
+
+		LayoutThread(const LayoutThread&) = delete;
+		LayoutThread& operator=(const LayoutThread&) = delete;
+
+		//コマンドを送り、その番号を返す
+		//キューが一杯のときは手元に溜めておき、次の send か flush で送る
+		std::uint64_t send(Command command);
+
+		//溜めておいたコマンドを送れるだけ送る
+		void flush();
+
+		//新しい結果が公開されていれば frame に取り出して true を返す
+		bool receive()
+		{
+			return frames.update();
+		}
+
+		//最後に receive で取り出した結果
+		const LayoutFrame& frame()const
+		{
+			return frames.front();
+		}
+
+		//最後に送ったコマンドの番号
+		std::uint64_t sentSerial()const
+		{
+			return serial;
+		}
+
+	private:
+		//以下はスレッドの中だけで使う
+
+		void run();
+
+		void apply(Command& command);
+
+		void publish();
+
+		//コマンドが届くか止めるまで待つ
+		void waitForCommand();
+
+		const bool isLockstep;
+
+		Board board;
+		Layout layout;
+		RectF scene;
+		bool isRunning = true;
+		std::uint64_t appliedSerial = 0;
+
+		//以下はスレッドの間の受け渡し
+
+		//番号とコマンドの組
+		SpscQueue<std::pair<std::uint64_t, Command>> commands;
+		TripleBuffer<LayoutFrame> frames;
+		std::atomic<bool> stopping{ false };
+
+		//動いていないときはスレッドを眠らせ、コマンドを送ったときと止めるときに起こす
+		std::mutex wakeMutex;
+		std::condition_variable wakeCondition;
+
+		//以下は呼び出し側だけが使う
+		std::uint64_t serial = 0;
+		std::deque<std::pair<std::uint64_t, Command>> pending;
+
+		std::thread thread;
+	};
+}
@@ -0,0 +1,128 @@
+﻿# include "MappedFile.hpp"
+
+# if defined(_WIN32)
+#	define NOMINMAX
+#	define WIN32_LEAN_AND_MEAN
+#	include <Windows.h>
+# else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+# endif
+
+namespace core
+{
+	MappedFile::~MappedFile()
+	{
+		close();
+	}
+
+	MappedFile::MappedFile(MappedFile&& other)noexcept
+	{
+		*this = std::move(other);
+	}
+
+	MappedFile& MappedFile::operator=(MappedFile&& other)noexcept
+	{
+		if (this != &other)
+		{
+			close();
+			bytes = other.bytes;
+			length = other.length;
+			other.bytes = nullptr;
+			other.length = 0;
+# if defined(_WIN32)
+			fileHandle = other.fileHandle;
+			mappingHandle = other.mappingHandle;
+			other.fileHandle = nullptr;
+			other.mappingHandle = nullptr;
+# endif
+		}
+		return *this;
+	}
+
+	std::optional<MappedFile> MappedFile::Open(const std::filesystem::path& path)
+	{
+		MappedFile file;
+# if defined(_WIN32)
+		file.fileHandle = ::CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file.fileHandle == INVALID_HANDLE_VALUE)
+		{
+			file.fileHandle = nullptr;
+			return std::nullopt;
+		}
+
+		LARGE_INTEGER size;
+		if (!::GetFileSizeEx(file.fileHandle, &size) || size.QuadPart == 0)
+		{
+			return std::nullopt;
+		}
+
+		file.mappingHandle = ::CreateFileMappingW(file.fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!file.mappingHandle)
+		{
+			return std::nullopt;
+		}
+
+		file.bytes = static_cast<const std::uint8_t*>(::MapViewOfFile(file.mappingHandle, FILE_MAP_READ, 0, 0, 0));
+		if (!file.bytes)
+		{
+			return std::nullopt;
+		}
+		file.length = static_cast<size_t>(size.QuadPart);
+# else
+		const int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+		{
+			return std::nullopt;
+		}
+
+		struct stat status;
+		if (::fstat(fd, &status) != 0 || status.st_size == 0)
+		{
+			::close(fd);
+			return std::nullopt;
+		}
+
+		//マップした後はファイルを閉じてよい
+		void* mapped = ::mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if (mapped == MAP_FAILED)
+		{
+			return std::nullopt;
+		}
+
+		file.bytes = static_cast<const std::uint8_t*>(mapped);
+		file.length = static_cast<size_t>(status.st_size);
+# endif
+		return file;
+	}
+
+	void MappedFile::close()
+	{
+# if defined(_WIN32)
+		if (bytes)
+		{
+			::UnmapViewOfFile(bytes);
+		}
+		if (mappingHandle)
+		{
+			::CloseHandle(mappingHandle);
+		}
+		if (fileHandle)
+		{
+			::CloseHandle(fileHandle);
+		}
+		mappingHandle = nullptr;
+		fileHandle = nullptr;
+# else
+		if (bytes)
+		{
+			::munmap(const_cast<std::uint8_t*>(bytes), length);
+		}
+# endif
+		bytes = nullptr;
+		length = 0;
+	}
+}
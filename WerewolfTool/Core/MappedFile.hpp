@@ -0,0 +1,47 @@
+﻿# pragma once
+# include <cstddef>
+# include <cstdint>
+# include <filesystem>
+# include <optional>
+
+namespace core
+{
+	//読み込み専用でメモリにマップしたファイル
+	class MappedFile
+	{
+	public:
+		MappedFile() = default;
+
+		~MappedFile();
+
+		MappedFile(MappedFile&& other)noexcept;
+		MappedFile& operator=(MappedFile&& other)noexcept;
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		//開けなかったときは std::nullopt
+		static std::optional<MappedFile> Open(const std::filesystem::path& path);
+
+		const std::uint8_t* data()const
+		{
+			return bytes;
+		}
+
+		size_t size()const
+		{
+			return length;
+		}
+
+	private:
+		void close();
+
+		const std::uint8_t* bytes = nullptr;
+		size_t length = 0;
+
+# if defined(_WIN32)
+		void* fileHandle = nullptr;
+		void* mappingHandle = nullptr;
+# endif
+	};
+}
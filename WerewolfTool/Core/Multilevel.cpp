@@ -0,0 +1,316 @@
+﻿# include "Multilevel.hpp"
+# include <algorithm>
+# include <cmath>
+# include <cstdint>
+# include <numeric>
+# include <random>
+# include <unordered_map>
+
+namespace core
+{
+	namespace
+	{
+		struct Level
+		{
+			Board board;
+
+			//各ノードにまとめた元のノード数
+			std::vector<double> weight;
+
+			//一段細かい盤面の各ノードをまとめた、この盤面のノード
+			std::vector<int> parentOf;
+		};
+
+		//向きを考慮しない隣接リスト
+		std::vector<std::vector<int>> Neighbors(const Board& board)
+		{
+			std::vector<std::vector<int>> neighbors(board.size());
+			board.adjacents.forEach([&](int from, int to, char)
+			{
+				if (from != to)
+				{
+					neighbors[from].push_back(to);
+					neighbors[to].push_back(from);
+				}
+			});
+
+			for (auto& list : neighbors)
+			{
+				std::sort(list.begin(), list.end());
+				list.erase(std::unique(list.begin(), list.end()), list.end());
+			}
+			return neighbors;
+		}
+
+		//リンクで組にできなかったノードを、近くにある同じく組にできなかったノードと組にする
+		//リンクの少ない盤面(始めたばかりの盤面はリンクが無い)でも粗くできるようにするため
+		//組にできなかったノードの平均の間隔を一辺とする格子に分け、周りの9マスで一番近いものを選ぶ
+		void MatchByProximity(const Board& fine, const std::vector<int>& order, std::vector<int>& partnerOf)
+		{
+			std::vector<int> candidates;
+			Vec2 minPos;
+			Vec2 maxPos;
+			for (const int me : order)
+			{
+				if (partnerOf[me] != -1 || !fine.nodes[me].isAutoLayout)
+				{
+					continue;
+				}
+
+				const Vec2 p = fine.nodes[me].position;
+				minPos = candidates.empty() ? p : Vec2(std::min(minPos.x, p.x), std::min(minPos.y, p.y));
+				maxPos = candidates.empty() ? p : Vec2(std::max(maxPos.x, p.x), std::max(maxPos.y, p.y));
+				candidates.push_back(me);
+			}
+			if (candidates.size() < 2)
+			{
+				return;
+			}
+
+			const double area = std::max(maxPos.x - minPos.x, 1.0) * std::max(maxPos.y - minPos.y, 1.0);
+			const double cellSize = std::sqrt(area / static_cast<double>(candidates.size()));
+			const auto cellOf = [&](const Vec2& p)
+			{
+				return std::pair<std::int32_t, std::int32_t>(
+					static_cast<std::int32_t>(std::floor((p.x - minPos.x) / cellSize)),
+					static_cast<std::int32_t>(std::floor((p.y - minPos.y) / cellSize)));
+			};
+			const auto key = [](std::int32_t x, std::int32_t y)
+			{
+				return (static_cast<std::int64_t>(x) << 32) ^ static_cast<std::uint32_t>(y);
+			};
+
+			std::unordered_map<std::int64_t, std::vector<int>> cells;
+			for (const int me : candidates)
+			{
+				const auto [x, y] = cellOf(fine.nodes[me].position);
+				cells[key(x, y)].push_back(me);
+			}
+
+			for (const int me : candidates)
+			{
+				if (partnerOf[me] != -1)
+				{
+					continue;
+				}
+
+				const Vec2 p = fine.nodes[me].position;
+				const auto [x, y] = cellOf(p);
+				int partner = -1;
+				double nearest = 0.0;
+				for (std::int32_t dy = -1; dy <= 1; ++dy)
+				{
+					for (std::int32_t dx = -1; dx <= 1; ++dx)
+					{
+						const auto it = cells.find(key(x + dx, y + dy));
+						if (it == cells.end())
+						{
+							continue;
+						}
+						for (const int other : it->second)
+						{
+							if (other == me || partnerOf[other] != -1)
+							{
+								continue;
+							}
+							const Vec2 relative = fine.nodes[other].position - p;
+							const double distance = relative.dot(relative);
+							if (partner == -1 || distance < nearest)
+							{
+								partner = other;
+								nearest = distance;
+							}
+						}
+					}
+				}
+
+				if (partner != -1)
+				{
+					partnerOf[me] = partner;
+					partnerOf[partner] = me;
+				}
+			}
+		}
+
+		//リンクでつながった二つのノードを一つにまとめて、一段粗い盤面を作る
+		//リンクで組にできなかったノードは MatchByProximity で近くのノードと組にする
+		Level Coarsen(const Board& fine, const std::vector<double>& fineWeight)
+		{
+			const size_t n = fine.size();
+			const auto neighbors = Neighbors(fine);
+
+			//次数の小さいノードから順に、まだまとめていない隣のうち最も軽いものと組にする
+			std::vector<int> order(n);
+			std::iota(order.begin(), order.end(), 0);
+			std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return neighbors[a].size() < neighbors[b].size(); });
+
+			std::vector<int> partnerOf(n, -1);
+			for (const int me : order)
+			{
+				if (partnerOf[me] != -1 || !fine.nodes[me].isAutoLayout)
+				{
+					continue;
+				}
+
+				int partner = -1;
+				for (const int other : neighbors[me])
+				{
+					if (partnerOf[other] != -1 || !fine.nodes[other].isAutoLayout)
+					{
+						continue;
+					}
+					if (partner == -1 || fineWeight[other] < fineWeight[partner])
+					{
+						partner = other;
+					}
+				}
+
+				if (partner != -1)
+				{
+					partnerOf[me] = partner;
+					partnerOf[partner] = me;
+				}
+			}
+			MatchByProximity(fine, order, partnerOf);
+
+			Level coarse;
+			coarse.parentOf.assign(n, -1);
+
+			std::vector<Node> coarseNodes;
+			for (const int me : order)
+			{
+				if (coarse.parentOf[me] != -1)
+				{
+					continue;
+				}
+
+				const int partner = partnerOf[me];
+				Node node = fine.nodes[me];
+				node.velocity = Vec2::Zero();
+				double weight = fineWeight[me];
+				coarse.parentOf[me] = static_cast<int>(coarseNodes.size());
+
+				//まとめたノードは重み付きの重心に置く
+				if (partner != -1)
+				{
+					const double partnerWeight = fineWeight[partner];
+					node.position = (node.position * weight + fine.nodes[partner].position * partnerWeight) / (weight + partnerWeight);
+					node.radius = std::max(node.radius, fine.nodes[partner].radius);
+					weight += partnerWeight;
+					coarse.parentOf[partner] = coarse.parentOf[me];
+				}
+
+				coarseNodes.push_back(node);
+				coarse.weight.push_back(weight);
+			}
+
+			coarse.board = Board(std::move(coarseNodes));
+
+			std::vector<EdgeStore::Edge> edges;
+			for (size_t me = 0; me < n; ++me)
+			{
+				for (const int other : neighbors[me])
+				{
+					const int from = coarse.parentOf[me];
+					const int to = coarse.parentOf[other];
+					if (static_cast<int>(me) < other && from != to)
+					{
+						edges.push_back({ std::min(from, to), std::max(from, to), 1 });
+					}
+				}
+			}
+			coarse.board.adjacents.assign(std::move(edges));
+
+			return coarse;
+		}
+
+		//粗い盤面の位置を一段細かい盤面に戻す
+		//同じノードにまとめていた二つは重ならないように少しだけ離す
+		void Prolong(const Level& coarse, Board& fine, const RectF& scene, double spread, std::mt19937& rng)
+		{
+			std::uniform_real_distribution<double> angle(0.0, 2.0 * 3.14159265358979323846);
+			std::vector<Vec2> offsets(coarse.board.size());
+			for (auto& offset : offsets)
+			{
+				const double theta = angle(rng);
+				offset = Vec2(std::cos(theta), std::sin(theta)) * spread;
+			}
+
+			std::vector<int> placed(coarse.board.size(), 0);
+			for (size_t me = 0; me < fine.size(); ++me)
+			{
+				Node& node = fine.nodes[me];
+				node.velocity = Vec2::Zero();
+				if (!node.isAutoLayout)
+				{
+					continue;
+				}
+
+				const int parent = coarse.parentOf[me];
+				const double side = placed[parent]++ == 0 ? 1.0 : -1.0;
+				const Vec2 position = coarse.board.nodes[parent].position + offsets[parent] * side;
+				node.position = FixedPosVel(position, Vec2::Zero(), node.getFieldScope(scene)).first;
+			}
+		}
+
+		//力が釣り合うまで反復して、力を計算した回数を返す
+		std::uint64_t Refine(Board& board, const RectF& scene, const LayoutParams& params, const MultilevelParams& multilevel, double step)
+		{
+			const double K = params.naturalDistance;
+			Layout layout(params);
+			layout.relax(board, scene, step * K, multilevel.tolerance * K, multilevel.maxIterations);
+			layout.resetInvalidNodes(board, scene);
+			return layout.forceEvaluations();
+		}
+	}
+
+	MultilevelResult MultilevelLayout(Board& board, const RectF& scene, const LayoutParams& params, const MultilevelParams& multilevel)
+	{
+		MultilevelResult result;
+		result.nodeCounts.push_back(board.size());
+
+		//粗い盤面を順に作る
+		std::vector<Level> levels;
+		std::vector<double> weight(board.size(), 1.0);
+		for (;;)
+		{
+			const Board& fine = levels.empty() ? board : levels.back().board;
+			const std::vector<double>& fineWeight = levels.empty() ? weight : levels.back().weight;
+			if (fine.size() <= multilevel.coarsestSize)
+			{
+				break;
+			}
+
+			Level coarse = Coarsen(fine, fineWeight);
+			if (multilevel.maxCoarseningRatio * fine.size() < coarse.board.size())
+			{
+				break;
+			}
+
+			result.nodeCounts.push_back(coarse.board.size());
+			levels.push_back(std::move(coarse));
+		}
+
+		//最も粗い盤面から順に、力が釣り合うまで動かしては一段細かい盤面に戻す
+		std::mt19937 rng(multilevel.seed);
+		const double spread = multilevel.prolongationSpread * params.naturalDistance;
+		result.forceEvaluations.assign(result.nodeCounts.size(), 0);
+		for (size_t level = levels.size(); 0 < level; --level)
+		{
+			Board& coarse = levels[level - 1].board;
+			const double step = level == levels.size() ? multilevel.coarsestStep : multilevel.refineStep;
+			result.forceEvaluations[level] = Refine(coarse, scene, params, multilevel, step);
+
+			Board& fine = level == 1 ? board : levels[level - 2].board;
+			Prolong(levels[level - 1], fine, scene, spread, rng);
+		}
+		result.forceEvaluations[0] = Refine(board, scene, params, multilevel, levels.empty() ? multilevel.coarsestStep : multilevel.refineStep);
+
+		for (size_t level = 0; level < result.nodeCounts.size(); ++level)
+		{
+			result.equivalentEvaluations += static_cast<double>(result.forceEvaluations[level]) * result.nodeCounts[level] / std::max<size_t>(1, board.size());
+		}
+
+		return result;
+	}
+}
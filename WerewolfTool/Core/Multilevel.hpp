@@ -0,0 +1,49 @@
+﻿# pragma once
+# include <cstdint>
+# include <vector>
+# include "Board.hpp"
+# include "Layout.hpp"
+
+namespace core
+{
+	struct MultilevelParams
+	{
+		//これ以下のノード数になったら粗くするのをやめる
+		size_t coarsestSize = 8;
+
+		//一段粗くしてもノード数がこの割合までしか減らなければやめる(論文では0.75)
+		double maxCoarseningRatio = 0.75;
+
+		//各段の反復(Layout::relax)の最大回数と、止める移動量(naturalDistance に対する割合)
+		int maxIterations = 1000;
+		double tolerance = 0.0001;
+
+		//最も粗い段とそれ以外の段で最初に動かす距離(naturalDistance に対する割合)
+		double coarsestStep = 0.5;
+		double refineStep = 0.1;
+
+		//細かい段に戻すとき、同じノードにまとめていた二つのノードを離す距離(naturalDistance に対する割合)
+		double prolongationSpread = 0.1;
+
+		std::uint32_t seed = 0;
+	};
+
+	struct MultilevelResult
+	{
+		//各段のノード数、最初が元の盤面
+		std::vector<size_t> nodeCounts;
+
+		//各段で力を計算した回数(最初が元の盤面)
+		std::vector<std::uint64_t> forceEvaluations;
+
+		//元の盤面で力を計算した回数に換算した合計(ノード数の比で重み付けする)
+		double equivalentEvaluations = 0.0;
+	};
+
+	//参考資料の多段階法で盤面全体を配置し直す
+	//リンクの両端を一つのノードにまとめて(edge collapsing)粗い盤面を作ることを繰り返し
+	//リンクで組にできなかったノードは、近くにある同じく組にできなかったノードとまとめる(リンクの少ない盤面でも粗くできるように)
+	//最も粗い盤面から順に配置を求めては、一段細かい盤面に位置を戻して整える
+	//位置を固定しているノードはまとめず、位置も変えない
+	MultilevelResult MultilevelLayout(Board& board, const RectF& scene, const LayoutParams& params, const MultilevelParams& multilevel = {});
+}
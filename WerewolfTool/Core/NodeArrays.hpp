@@ -0,0 +1,57 @@
+﻿# pragma once
+# include <cstdint>
+# include <vector>
+# include "Board.hpp"
+
+namespace core
+{
+	//レイアウト計算中に毎ステップ読み書きする値だけを配列ごとに分けて持つ(structure of arrays)
+	//core::Node から役職や死因などを除いたもの
+	struct NodeArrays
+	{
+		std::vector<double> x;
+		std::vector<double> y;
+		std::vector<double> vx;
+		std::vector<double> vy;
+		std::vector<double> radius;
+
+		//1: 位置を固定している(isAutoLayout == false)
+		std::vector<std::uint8_t> fixed;
+
+		size_t size()const
+		{
+			return x.size();
+		}
+
+		void load(const std::vector<Node>& nodes)
+		{
+			const size_t n = nodes.size();
+			x.resize(n);
+			y.resize(n);
+			vx.resize(n);
+			vy.resize(n);
+			radius.resize(n);
+			fixed.resize(n);
+
+			for (size_t i = 0; i < n; ++i)
+			{
+				x[i] = nodes[i].position.x;
+				y[i] = nodes[i].position.y;
+				vx[i] = nodes[i].velocity.x;
+				vy[i] = nodes[i].velocity.y;
+				radius[i] = nodes[i].radius;
+				fixed[i] = nodes[i].isAutoLayout ? 0 : 1;
+			}
+		}
+
+		//位置と速度だけを書き戻す
+		void store(std::vector<Node>& nodes)const
+		{
+			for (size_t i = 0; i < nodes.size(); ++i)
+			{
+				nodes[i].position = Vec2(x[i], y[i]);
+				nodes[i].velocity = Vec2(vx[i], vy[i]);
+			}
+		}
+	};
+}
@@ -0,0 +1,174 @@
+﻿# include "QuadTree.hpp"
+# include <algorithm>
+# include <array>
+# include <numeric>
+
+namespace core
+{
+	void QuadTree::build(const std::vector<Vec2>& newPoints)
+	{
+		points = newPoints;
+		cells.clear();
+		order.resize(points.size());
+		std::iota(order.begin(), order.end(), 0);
+
+		if (points.empty())
+		{
+			return;
+		}
+
+		Vec2 minPos = points.front();
+		Vec2 maxPos = points.front();
+		for (const auto& p : points)
+		{
+			minPos = Vec2(std::min(minPos.x, p.x), std::min(minPos.y, p.y));
+			maxPos = Vec2(std::max(maxPos.x, p.x), std::max(maxPos.y, p.y));
+		}
+
+		Cell root;
+		root.origin = minPos;
+		root.size = std::max({ maxPos.x - minPos.x, maxPos.y - minPos.y, 1.0 });
+		root.begin = 0;
+		root.end = static_cast<int>(points.size());
+		cells.push_back(root);
+
+		subdivide(0, 0);
+	}
+
+	void QuadTree::build(const std::vector<double>& x, const std::vector<double>& y)
+	{
+		std::vector<Vec2> newPoints(x.size());
+		for (size_t i = 0; i < x.size(); ++i)
+		{
+			newPoints[i] = Vec2(x[i], y[i]);
+		}
+		build(newPoints);
+	}
+
+	void QuadTree::subdivide(int cellIndex, int depth)
+	{
+		const int begin = cells[cellIndex].begin;
+		const int end = cells[cellIndex].end;
+
+		if (end - begin <= LeafCapacity || MaxDepth <= depth)
+		{
+			Vec2 sum = Vec2::Zero();
+			for (int k = begin; k < end; ++k)
+			{
+				sum += points[order[k]];
+			}
+
+			cells[cellIndex].mass = end - begin;
+			if (begin < end)
+			{
+				cells[cellIndex].centerOfMass = sum / (end - begin);
+			}
+			return;
+		}
+
+		const Vec2 origin = cells[cellIndex].origin;
+		const double half = cells[cellIndex].size * 0.5;
+		const Vec2 mid = origin + Vec2(half, half);
+
+		//order[begin, end) を 左上, 右上, 左下, 右下 の順に並べ替える
+		const auto first = order.begin() + begin;
+		const auto last = order.begin() + end;
+		const auto splitY = std::partition(first, last, [&](int i) { return points[i].y < mid.y; });
+		const auto splitX0 = std::partition(first, splitY, [&](int i) { return points[i].x < mid.x; });
+		const auto splitX1 = std::partition(splitY, last, [&](int i) { return points[i].x < mid.x; });
+
+		const std::array<int, 5> bounds = {
+			begin,
+			static_cast<int>(splitX0 - order.begin()),
+			static_cast<int>(splitY - order.begin()),
+			static_cast<int>(splitX1 - order.begin()),
+			end
+		};
+
+		const int firstChild = static_cast<int>(cells.size());
+		cells[cellIndex].firstChild = firstChild;
+
+		for (int c = 0; c < 4; ++c)
+		{
+			Cell child;
+			child.origin = origin + Vec2((c % 2) * half, (c / 2) * half);
+			child.size = half;
+			child.begin = bounds[c];
+			child.end = bounds[c + 1];
+			cells.push_back(child);
+		}
+
+		Vec2 sum = Vec2::Zero();
+		double mass = 0.0;
+		for (int c = 0; c < 4; ++c)
+		{
+			subdivide(firstChild + c, depth + 1);
+
+			const Cell& child = cells[firstChild + c];
+			sum += child.centerOfMass * child.mass;
+			mass += child.mass;
+		}
+
+		cells[cellIndex].mass = mass;
+		cells[cellIndex].centerOfMass = sum / mass;
+	}
+
+	Vec2 QuadTree::repulsion(size_t index, double strength, double theta)const
+	{
+		Vec2 force = Vec2::Zero();
+		if (cells.empty())
+		{
+			return force;
+		}
+
+		const Vec2 p = points[index];
+		const double theta2 = theta * theta;
+
+		//各セルは子を四つ積むので、深さ MaxDepth までたどっても溢れない大きさにしておく
+		std::array<int, 4 * MaxDepth + 4> stack;
+		int stackSize = 0;
+		stack[stackSize++] = 0;
+
+		while (0 < stackSize)
+		{
+			const Cell& cell = cells[stack[--stackSize]];
+			if (cell.mass == 0.0)
+			{
+				continue;
+			}
+
+			if (cell.firstChild < 0)
+			{
+				for (int k = cell.begin; k < cell.end; ++k)
+				{
+					const int other = order[k];
+					if (other == static_cast<int>(index))
+					{
+						continue;
+					}
+
+					const Vec2 relative = points[other] - p;
+					force += -strength * relative / relative.dot(relative);
+				}
+				continue;
+			}
+
+			const Vec2 relative = cell.centerOfMass - p;
+			const double distance2 = relative.dot(relative);
+
+			//自分自身を含むセルは必ず開く
+			if (!cell.contains(p) && cell.size * cell.size < theta2 * distance2)
+			{
+				force += -strength * cell.mass * relative / distance2;
+				continue;
+			}
+
+			for (int c = 0; c < 4; ++c)
+			{
+				stack[stackSize++] = cell.firstChild + c;
+			}
+		}
+
+		return force;
+	}
+}
@@ -0,0 +1,62 @@
+﻿# pragma once
+# include <vector>
+# include "Vec2.hpp"
+
+namespace core
+{
+	//Barnes-Hut法で斥力を近似計算するための四分木
+	//参考資料: J. Barnes, P. Hut, "A hierarchical O(N log N) force-calculation algorithm"
+	class QuadTree
+	{
+	public:
+		//これ以下の点数のセルは分割せず葉にする
+		static constexpr int LeafCapacity = 8;
+
+		//同じ座標の点が大量にある場合でも分割が止まるように深さを制限する
+		static constexpr int MaxDepth = 24;
+
+		void build(const std::vector<Vec2>& points);
+
+		void build(const std::vector<double>& x, const std::vector<double>& y);
+
+		//points[index]に働く斥力 Σ -strength * r / |r|^2 (r = points[other] - points[index]) を近似計算する
+		//セルの一辺 / セルの重心までの距離 < theta のとき、そのセルを一つの点とみなす
+		//theta = 0 のときは総当たりと同じ結果になる
+		Vec2 repulsion(size_t index, double strength, double theta)const;
+
+		size_t cellCount()const
+		{
+			return cells.size();
+		}
+
+	private:
+		struct Cell
+		{
+			//重心と点数(質量)
+			Vec2 centerOfMass;
+			double mass = 0.0;
+
+			//セルの左上と一辺の長さ
+			Vec2 origin;
+			double size = 0.0;
+
+			//子セルは四つ連続して確保する、葉の場合は -1
+			int firstChild = -1;
+
+			//order[begin, end) がこのセルに含まれる点
+			int begin = 0;
+			int end = 0;
+
+			bool contains(const Vec2& p)const
+			{
+				return origin.x <= p.x && p.x <= origin.x + size && origin.y <= p.y && p.y <= origin.y + size;
+			}
+		};
+
+		void subdivide(int cellIndex, int depth);
+
+		std::vector<Cell> cells;
+		std::vector<int> order;
+		std::vector<Vec2> points;
+	};
+}
@@ -0,0 +1,231 @@
+﻿# include "RoleEngine.hpp"
+# include <algorithm>
+# include <chrono>
+# include "WorkStealingQueues.hpp"
+
+namespace core
+{
+	IncrementalRoleSolver::IncrementalRoleSolver(const RoleEngineParams& params)
+		: params(params)
+		, pool(params.threadCount != 0 ? params.threadCount : std::max<size_t>(1, ThreadPool::HardwareThreadCount() / 2))
+	{}
+
+	std::optional<RoleFrame> IncrementalRoleSolver::solve(const RoleConstraints& constraints, const std::atomic<bool>* cancel)
+	{
+		using Clock = std::chrono::steady_clock;
+		const auto begin = Clock::now();
+
+		const auto isCanceled = [&]
+		{
+			return cancel && cancel->load(std::memory_order_relaxed);
+		};
+
+		//元に戻したときなど、盤面全体が前と同じならスレッドを起こさずに返す
+		std::string rootKey = constraints.key();
+		if (const auto cached = findCache(rootKey))
+		{
+			RoleFrame frame;
+			frame.solution = cached->normalized();
+			frame.elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+			frame.cachedTasks = 1;
+			return frame;
+		}
+
+		//探索が小さいときは、分けたりキャッシュを引いたりする手間の方が大きいので、そのまま数える
+		if (EstimateSearchSize(constraints) < params.splitThreshold)
+		{
+			auto counts = std::make_shared<RoleCounts>(CountRoles(constraints, cancel));
+			if (isCanceled())
+			{
+				return std::nullopt;
+			}
+
+			RoleFrame frame;
+			frame.solution = counts->normalized();
+			frame.elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+			frame.solvedTasks = 1;
+			storeCache(std::move(rootKey), std::move(counts));
+			return frame;
+		}
+
+		//部分問題の結果はスレッドごとに足しておき、最後にまとめる
+		const size_t threadCount = pool.threadCount();
+		std::vector<RoleCounts> totals(threadCount);
+		std::atomic<size_t> cachedTasks{ 0 };
+		std::atomic<size_t> solvedTasks{ 0 };
+
+		WorkStealingQueues<Task> queues(threadCount);
+		queues.push(0, Task{ constraints, 0 });
+
+		pool.parallelFor(threadCount, [&](size_t thread)
+		{
+			Task task;
+			while (queues.waitPop(thread, task))
+			{
+				//やめるときも、残りのタスクを取り出して終わらせる
+				if (!isCanceled())
+				{
+					std::string key = task.constraints.key();
+					std::vector<RoleConstraints> children;
+					if (const auto cached = findCache(key))
+					{
+						totals[thread].add(*cached);
+						++cachedTasks;
+					}
+					else if (task.depth < params.splitDepth && !(children = SplitRoles(task.constraints)).empty())
+					{
+						for (auto& child : children)
+						{
+							queues.push(thread, Task{ std::move(child), task.depth + 1 });
+						}
+					}
+					else
+					{
+						auto counts = std::make_shared<RoleCounts>(CountRoles(task.constraints, cancel));
+						if (!isCanceled())
+						{
+							totals[thread].add(*counts);
+							storeCache(std::move(key), std::move(counts));
+							++solvedTasks;
+						}
+					}
+				}
+				queues.done();
+			}
+		});
+
+		if (isCanceled())
+		{
+			return std::nullopt;
+		}
+
+		RoleCounts total;
+		total.weights.assign(constraints.size(), {});
+		for (const auto& counts : totals)
+		{
+			total.add(counts);
+		}
+
+		//盤面全体の結果も残しておくと、元に戻したときにすぐ返せる
+		storeCache(std::move(rootKey), std::make_shared<RoleCounts>(total));
+
+		RoleFrame frame;
+		frame.solution = total.normalized();
+		frame.elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+		frame.cachedTasks = cachedTasks;
+		frame.solvedTasks = solvedTasks;
+		frame.stolenTasks = queues.stolenCount();
+		return frame;
+	}
+
+	void IncrementalRoleSolver::clearCache()
+	{
+		std::lock_guard lock(cacheMutex);
+		cacheEntries.clear();
+		cacheIndex.clear();
+	}
+
+	size_t IncrementalRoleSolver::cacheSize()const
+	{
+		std::lock_guard lock(cacheMutex);
+		return cacheEntries.size();
+	}
+
+	std::shared_ptr<const RoleCounts> IncrementalRoleSolver::findCache(const std::string& key)
+	{
+		std::lock_guard lock(cacheMutex);
+		const auto it = cacheIndex.find(key);
+		if (it == cacheIndex.end())
+		{
+			return nullptr;
+		}
+
+		cacheEntries.splice(cacheEntries.begin(), cacheEntries, it->second);
+		return it->second->second;
+	}
+
+	void IncrementalRoleSolver::storeCache(std::string key, std::shared_ptr<const RoleCounts> counts)
+	{
+		std::lock_guard lock(cacheMutex);
+		if (const auto it = cacheIndex.find(key); it != cacheIndex.end())
+		{
+			it->second->second = std::move(counts);
+			cacheEntries.splice(cacheEntries.begin(), cacheEntries, it->second);
+			return;
+		}
+
+		cacheEntries.emplace_front(std::move(key), std::move(counts));
+		cacheIndex.emplace(cacheEntries.front().first, cacheEntries.begin());
+		while (params.cacheCapacity < cacheEntries.size())
+		{
+			cacheIndex.erase(cacheEntries.back().first);
+			cacheEntries.pop_back();
+		}
+	}
+
+	RoleEngine::RoleEngine(const RoleEngineParams& params)
+		: solver(params)
+	{
+		thread = std::thread([this] { run(); });
+	}
+
+	RoleEngine::~RoleEngine()
+	{
+		{
+			std::lock_guard lock(mutex);
+			stopping = true;
+			cancel = true;
+		}
+		wakeCondition.notify_one();
+		thread.join();
+	}
+
+	std::uint64_t RoleEngine::submit(const Board& board, const VillageRules& rules)
+	{
+		RoleConstraints constraints = RoleConstraints::FromBoard(board, rules);
+
+		std::uint64_t serial;
+		{
+			std::lock_guard lock(mutex);
+			request = std::move(constraints);
+			serial = ++requestSerial;
+			cancel = true;
+		}
+		wakeCondition.notify_one();
+		return serial;
+	}
+
+	bool RoleEngine::receive()
+	{
+		return published.update();
+	}
+
+	void RoleEngine::run()
+	{
+		for (;;)
+		{
+			RoleConstraints constraints;
+			std::uint64_t serial;
+			{
+				std::unique_lock lock(mutex);
+				wakeCondition.wait(lock, [&] { return stopping || request; });
+				if (stopping)
+				{
+					return;
+				}
+
+				constraints = std::move(*request);
+				request.reset();
+				serial = requestSerial;
+				cancel = false;
+			}
+
+			if (auto frame = solver.solve(constraints, &cancel))
+			{
+				frame->serial = serial;
+				published.back() = std::move(*frame);
+				published.publish();
+			}
+		}
+	}
+}
@@ -0,0 +1,133 @@
+﻿# pragma once
+# include <atomic>
+# include <condition_variable>
+# include <cstdint>
+# include <list>
+# include <memory>
+# include <mutex>
+# include <optional>
+# include <string>
+# include <thread>
+# include <unordered_map>
+# include "Board.hpp"
+# include "RoleSolver.hpp"
+# include "ThreadPool.hpp"
+# include "TripleBuffer.hpp"
+
+namespace core
+{
+	struct RoleEngineParams
+	{
+		//呼び出し元のスレッドを含めた並列数、0 なら論理コア数の半分
+		//レイアウト計算のスレッドも全てのコアを使うので、同時に動いても取り合いすぎないようにする
+		size_t threadCount = 0;
+
+		//EstimateSearchSize がこれより小さい盤面は分けずに一つのスレッドで数える
+		//15〜20人の村ではほとんどがこれより小さく、CountRoles は0.1ms程度で終わる
+		double splitThreshold = 100000.0;
+
+		//SplitRoles で分ける深さ、深いほど変更に関わらない部分問題を使い回せるが、キャッシュの項目が増える
+		int splitDepth = 4;
+
+		//キャッシュに残す部分問題の数、超えたら最も長く使っていないものから捨てる
+		size_t cacheCapacity = 4096;
+	};
+
+	//数え上げ一回分の結果
+	struct RoleFrame
+	{
+		RoleSolution solution;
+
+		//RoleEngine::submit が返した番号、この番号の盤面の結果
+		std::uint64_t serial = 0;
+
+		double elapsedMs = 0.0;
+
+		//キャッシュの結果を使った部分問題と、数え直した部分問題の数
+		size_t cachedTasks = 0;
+		size_t solvedTasks = 0;
+
+		//他のスレッドから盗んだ部分問題の数
+		size_t stolenTasks = 0;
+	};
+
+	//部分問題の結果をキャッシュしながら、役職の割り当てを複数のスレッドで数える
+	//探索が大きい(EstimateSearchSize が splitThreshold 以上の)盤面は SplitRoles で splitDepth 段まで分け、部分問題ごとに条件をキーにして結果を残しておく
+	//リンク一本の変更では、そのリンクを出したプレイヤーが本物でない部分問題のキーは変わらないので、数え直すのは残りだけになる
+	//小さい盤面は分けずに数え、盤面全体の結果だけを残す
+	//部分問題は WorkStealingQueues に積み、空いたスレッドが他のスレッドから盗んで数える
+	class IncrementalRoleSolver
+	{
+	public:
+		explicit IncrementalRoleSolver(const RoleEngineParams& params = {});
+
+		//cancel が true になったら途中でやめて std::nullopt を返す(それまでに数え終わった部分問題はキャッシュに残る)
+		std::optional<RoleFrame> solve(const RoleConstraints& constraints, const std::atomic<bool>* cancel = nullptr);
+
+		void clearCache();
+
+		size_t cacheSize()const;
+
+	private:
+		struct Task
+		{
+			RoleConstraints constraints;
+			int depth = 0;
+		};
+
+		std::shared_ptr<const RoleCounts> findCache(const std::string& key);
+
+		void storeCache(std::string key, std::shared_ptr<const RoleCounts> counts);
+
+		RoleEngineParams params;
+		ThreadPool pool;
+
+		//最近使った順(前ほど新しい)に並べた部分問題の結果
+		mutable std::mutex cacheMutex;
+		std::list<std::pair<std::string, std::shared_ptr<const RoleCounts>>> cacheEntries;
+		std::unordered_map<std::string, decltype(cacheEntries)::iterator> cacheIndex;
+	};
+
+	//役職の割り当ての数え上げを専用のスレッドで行う
+	//盤面が変わるたびに submit し、結果は三重バッファで受け取るので、呼び出し側は数え終わるのを待たない
+	//数えている途中で新しい盤面が来たら、途中のものはやめて新しい方を数える(受け取れるのは最後に数え終わった結果)
+	class RoleEngine
+	{
+	public:
+		explicit RoleEngine(const RoleEngineParams& params = {});
+
+		~RoleEngine();
+
+		RoleEngine(const RoleEngine&) = delete;
+		RoleEngine& operator=(const RoleEngine&) = delete;
+
+		//盤面の条件を渡して数え直させる、結果の RoleFrame::serial と比べる番号を返す
+		std::uint64_t submit(const Board& board, const VillageRules& rules);
+
+		//新しい結果が公開されていれば frame に取り出して true を返す
+		bool receive();
+
+		//最後に receive で取り出した結果
+		const RoleFrame& frame()const
+		{
+			return published.front();
+		}
+
+	private:
+		void run();
+
+		IncrementalRoleSolver solver;
+
+		std::mutex mutex;
+		std::condition_variable wakeCondition;
+		std::optional<RoleConstraints> request;
+		std::uint64_t requestSerial = 0;
+		bool stopping = false;
+
+		//新しい盤面が来たら、数えている途中のものをやめさせる
+		std::atomic<bool> cancel{ false };
+
+		TripleBuffer<RoleFrame> published;
+		std::thread thread;
+	};
+}
@@ -0,0 +1,661 @@
+﻿# include "RoleSolver.hpp"
+# include <algorithm>
+
+namespace core
+{
+	namespace
+	{
+		constexpr RoleMask AllRoles = (1u << RoleCount) - 1;
+		constexpr RoleMask WolfBit = RoleBit(Role::Werewolf);
+		constexpr RoleMask LiarBits = RoleBit(Role::Werewolf) | RoleBit(Role::Madman);
+
+		//COした役職の本物か、騙っている人狼か狂人
+		RoleMask ClaimMask(Node::Roal co)
+		{
+			switch (co)
+			{
+			case Node::Fortuneteller:
+				return RoleBit(Role::Seer) | LiarBits;
+			case Node::Spiritualist:
+				return RoleBit(Role::Medium) | LiarBits;
+			case Node::Hunter:
+				return RoleBit(Role::Hunter) | LiarBits;
+			case Node::Madman:
+				return LiarBits;
+			default:
+				return AllRoles;
+			}
+		}
+
+		int PopCount(RoleMask mask)
+		{
+			int count = 0;
+			for (; mask; mask &= mask - 1)
+			{
+				++count;
+			}
+			return count;
+		}
+
+		Role SingleRole(RoleMask mask)
+		{
+			int index = 0;
+			while (!(mask & (1u << index)))
+			{
+				++index;
+			}
+			return static_cast<Role>(index);
+		}
+
+		using Claim = RoleConstraints::Claim;
+
+		//CO したプレイヤーは役職が一つに、それ以外は人狼かどうかが決まったら決定
+		bool IsDecided(bool isClaimant, RoleMask mask)
+		{
+			return isClaimant ? PopCount(mask) == 1 : (mask == WolfBit || !(mask & WolfBit));
+		}
+
+		//占い・霊媒の結果から候補を絞り込む、候補が無くなったプレイヤーがいれば false
+		bool Propagate(const std::vector<Claim>& claims, std::vector<RoleMask>& masks)
+		{
+			for (bool isChanged = true; isChanged;)
+			{
+				isChanged = false;
+				for (const auto& claim : claims)
+				{
+					RoleMask& claimant = masks[claim.claimant];
+					RoleMask& target = masks[claim.target];
+					const RoleMask trueBit = RoleBit(claim.trueRole);
+
+					//結果と食い違う相手なら、本物ではない
+					const bool canMatch = claim.isBlack ? (target & WolfBit) : (target & ~WolfBit);
+					if ((claimant & trueBit) && !canMatch)
+					{
+						claimant &= ~trueBit;
+						isChanged = true;
+					}
+
+					//本物と決まったら、相手は結果の通り
+					if (claimant == trueBit)
+					{
+						const RoleMask narrowed = claim.isBlack ? (target & WolfBit) : (target & ~WolfBit);
+						if (narrowed != target)
+						{
+							target = narrowed;
+							isChanged = true;
+						}
+					}
+
+					if (!claimant || !target)
+					{
+						return false;
+					}
+				}
+			}
+			return true;
+		}
+
+		//探索するプレイヤー(CO したか結果に関わるプレイヤー)の順番
+		//CO したプレイヤーから先に決めると、結果による絞り込みが早く効く
+		std::vector<int> SearchOrder(const RoleConstraints& constraints)
+		{
+			std::vector<bool> isConstrained(constraints.size(), false);
+			for (size_t i = 0; i < constraints.size(); ++i)
+			{
+				isConstrained[i] = constraints.isClaimant[i] || constraints.masks[i] != AllRoles;
+			}
+			for (const auto& claim : constraints.claims)
+			{
+				isConstrained[claim.target] = true;
+			}
+
+			std::vector<int> order;
+			for (int pass = 0; pass < 2; ++pass)
+			{
+				for (size_t i = 0; i < constraints.size(); ++i)
+				{
+					if (isConstrained[i] && (constraints.isClaimant[i] != 0) == (pass == 0))
+					{
+						order.push_back(static_cast<int>(i));
+					}
+				}
+			}
+			return order;
+		}
+
+		class Solver
+		{
+		public:
+			Solver(const RoleConstraints& constraints, const std::atomic<bool>* cancel)
+				: constraints(constraints)
+				, players(constraints.size())
+				, counts(constraints.counts)
+				, claims(constraints.claims)
+				, order(SearchOrder(constraints))
+				, cancel(cancel)
+			{
+				std::vector<bool> isConstrained(players, false);
+				for (const int i : order)
+				{
+					isConstrained[i] = true;
+				}
+
+				for (size_t i = 0; i < players; ++i)
+				{
+					aliveCount += constraints.isAlive[i] ? 1 : 0;
+					if (!isConstrained[i])
+					{
+						(constraints.isAlive[i] ? freeAlive : freeDead).push_back(static_cast<int>(i));
+					}
+				}
+			}
+
+			RoleCounts solve()
+			{
+				solution.weights.assign(players, {});
+
+				int specials = 0;
+				for (size_t role = 0; role < RoleCount; ++role)
+				{
+					if (counts[role] < 0)
+					{
+						return solution;
+					}
+					specials += role == static_cast<size_t>(Role::Villager) ? 0 : counts[role];
+				}
+				if (static_cast<int>(players) < specials)
+				{
+					return solution;
+				}
+
+				std::vector<RoleMask> masks = constraints.masks;
+				if (Propagate(claims, masks))
+				{
+					search(0, masks);
+				}
+
+				//関わりの無いプレイヤーは生死ごとに同じ割合になる
+				for (const auto& [pool, sums] : { std::make_pair(&freeAlive, &aliveSums), std::make_pair(&freeDead, &deadSums) })
+				{
+					for (const int i : *pool)
+					{
+						for (size_t role = 0; role < RoleCount; ++role)
+						{
+							solution.weights[i][role] = (*sums)[role] / pool->size();
+						}
+					}
+				}
+				return solution;
+			}
+
+		private:
+			//決まった役職の人数が配役を超えず、人狼を全員置く場所が残っているか
+			bool isFeasible(const std::vector<RoleMask>& current)const
+			{
+				std::array<int, RoleCount> decided{};
+				int wolfCapacity = static_cast<int>(freeAlive.size() + freeDead.size());
+				for (const int i : order)
+				{
+					const RoleMask mask = current[i];
+					wolfCapacity += (mask & WolfBit) ? 1 : 0;
+					if (mask == WolfBit || (constraints.isClaimant[i] && PopCount(mask) == 1))
+					{
+						++decided[static_cast<size_t>(SingleRole(mask))];
+					}
+				}
+
+				for (size_t role = 0; role < RoleCount; ++role)
+				{
+					if (counts[role] < decided[role])
+					{
+						return false;
+					}
+				}
+				return counts[static_cast<size_t>(Role::Werewolf)] <= wolfCapacity;
+			}
+
+			void search(size_t depth, const std::vector<RoleMask>& current)
+			{
+				++solution.visitedNodes;
+				if (cancel && cancel->load(std::memory_order_relaxed))
+				{
+					return;
+				}
+
+				while (depth < order.size() && IsDecided(constraints.isClaimant[order[depth]], current[order[depth]]))
+				{
+					++depth;
+				}
+
+				if (!isFeasible(current))
+				{
+					return;
+				}
+
+				if (depth == order.size())
+				{
+					count(current);
+					return;
+				}
+
+				const int i = order[depth];
+				const RoleMask mask = current[i];
+
+				//CO したプレイヤーは役職ごとに、それ以外は人狼かどうかで分ける
+				std::array<RoleMask, RoleCount> choices{};
+				size_t choiceCount = 0;
+				if (constraints.isClaimant[i])
+				{
+					for (RoleMask rest = mask; rest; rest &= rest - 1)
+					{
+						choices[choiceCount++] = rest & ~(rest - 1);
+					}
+				}
+				else
+				{
+					choices[choiceCount++] = mask & WolfBit;
+					choices[choiceCount++] = mask & ~WolfBit;
+				}
+
+				for (size_t c = 0; c < choiceCount; ++c)
+				{
+					std::vector<RoleMask> next = current;
+					next[i] = choices[c];
+					if (Propagate(claims, next))
+					{
+						search(depth + 1, next);
+					}
+				}
+			}
+
+			static double Binomial(int n, int k)
+			{
+				double result = 1.0;
+				for (int i = 1; i <= k; ++i)
+				{
+					result = result * (n - k + i) / i;
+				}
+				return result;
+			}
+
+			//CO したプレイヤーの役職と、結果に関わるプレイヤーが人狼かどうかが全て決まった状態の割り当ての数を数える
+			//残りの人狼は関わりの無いプレイヤーに、人狼以外の残りの役職は人狼でないプレイヤー全体に配る
+			void count(const std::vector<RoleMask>& current)
+			{
+				std::array<int, RoleCount> rest = counts;
+				int nonWolfSlots = static_cast<int>(freeAlive.size() + freeDead.size());
+				int decidedAliveWolves = 0;
+				for (const int i : order)
+				{
+					const RoleMask mask = current[i];
+					if (mask == WolfBit)
+					{
+						--rest[static_cast<size_t>(Role::Werewolf)];
+						decidedAliveWolves += constraints.isAlive[i] ? 1 : 0;
+					}
+					else if (constraints.isClaimant[i])
+					{
+						--rest[static_cast<size_t>(SingleRole(mask))];
+					}
+					else
+					{
+						++nonWolfSlots;
+					}
+				}
+
+				const int restWolves = rest[static_cast<size_t>(Role::Werewolf)];
+				nonWolfSlots -= restWolves;
+				if (restWolves < 0 || nonWolfSlots < 0)
+				{
+					return;
+				}
+
+				//人狼以外の残りの役職を人狼でない席に並べる数(多項係数)
+				double nonWolfWays = 1.0;
+				int placed = 0;
+				for (size_t role = 0; role < RoleCount; ++role)
+				{
+					if (role == static_cast<size_t>(Role::Werewolf))
+					{
+						continue;
+					}
+					if (rest[role] < 0)
+					{
+						return;
+					}
+					placed += rest[role];
+					nonWolfWays *= Binomial(placed, rest[role]);
+				}
+				if (placed != nonWolfSlots)
+				{
+					return;
+				}
+
+				//残りの人狼のうち生きているプレイヤーに割り当てる人数ごとに数える
+				const int aliveFree = static_cast<int>(freeAlive.size());
+				const int deadFree = static_cast<int>(freeDead.size());
+				double ways = 0.0;
+				for (int aliveWolves = std::max(0, restWolves - deadFree); aliveWolves <= std::min(restWolves, aliveFree); ++aliveWolves)
+				{
+					const int deadWolves = restWolves - aliveWolves;
+					const int totalAliveWolves = decidedAliveWolves + aliveWolves;
+					if (constraints.gameContinues && (totalAliveWolves < 1 || aliveCount - totalAliveWolves <= totalAliveWolves))
+					{
+						continue;
+					}
+
+					const double w = Binomial(aliveFree, aliveWolves) * Binomial(deadFree, deadWolves) * nonWolfWays;
+					ways += w;
+					accumulatePool(aliveSums, w, aliveFree, aliveWolves, rest, nonWolfSlots);
+					accumulatePool(deadSums, w, deadFree, deadWolves, rest, nonWolfSlots);
+				}
+
+				if (ways <= 0.0)
+				{
+					return;
+				}
+
+				solution.worlds += ways;
+				for (const int i : order)
+				{
+					auto& probability = solution.weights[i];
+					const RoleMask mask = current[i];
+					if (mask == WolfBit || constraints.isClaimant[i])
+					{
+						probability[static_cast<size_t>(SingleRole(mask))] += ways;
+						continue;
+					}
+
+					//人狼でないと決まったプレイヤーは、人狼以外の残りの役職のどれかになる
+					for (size_t role = 0; role < RoleCount; ++role)
+					{
+						if (role != static_cast<size_t>(Role::Werewolf))
+						{
+							probability[role] += ways * rest[role] / nonWolfSlots;
+						}
+					}
+				}
+			}
+
+			//関わりの無いプレイヤー poolSize 人のうち wolves 人が人狼である割り当ての重み weight を、役職ごとの人数の期待値として足す
+			static void accumulatePool(std::array<double, RoleCount>& sums, double weight, int poolSize, int wolves, const std::array<int, RoleCount>& rest, int nonWolfSlots)
+			{
+				sums[static_cast<size_t>(Role::Werewolf)] += weight * wolves;
+				if (nonWolfSlots <= 0)
+				{
+					return;
+				}
+
+				for (size_t role = 0; role < RoleCount; ++role)
+				{
+					if (role != static_cast<size_t>(Role::Werewolf))
+					{
+						sums[role] += weight * (poolSize - wolves) * rest[role] / nonWolfSlots;
+					}
+				}
+			}
+
+			const RoleConstraints& constraints;
+			size_t players;
+			std::array<int, RoleCount> counts{};
+			const std::vector<Claim>& claims;
+
+			//探索するプレイヤーの順番
+			std::vector<int> order;
+
+			//CO しておらず結果にも関わらないプレイヤー(生きている・死んでいる)
+			std::vector<int> freeAlive;
+			std::vector<int> freeDead;
+			int aliveCount = 0;
+
+			//freeAlive, freeDead の役職ごとの人数の期待値に割り当ての数を掛けたものの合計
+			std::array<double, RoleCount> aliveSums{};
+			std::array<double, RoleCount> deadSums{};
+
+			const std::atomic<bool>* cancel;
+
+			RoleCounts solution;
+		};
+	}
+
+	const char* ToString(Role role)
+	{
+		switch (role)
+		{
+		case Role::Villager:
+			return "villager";
+		case Role::Werewolf:
+			return "werewolf";
+		case Role::Seer:
+			return "seer";
+		case Role::Medium:
+			return "medium";
+		case Role::Hunter:
+			return "hunter";
+		case Role::Madman:
+			return "madman";
+		default:
+			return "unknown";
+		}
+	}
+
+	VillageRules VillageRules::ForPopulation(size_t players)
+	{
+		VillageRules rules;
+		rules.werewolves = 13 <= players ? 3 : 8 <= players ? 2 : 1;
+		rules.madmen = 7 <= players ? 1 : 0;
+		rules.seers = 4 <= players ? 1 : 0;
+		rules.mediums = 8 <= players ? 1 : 0;
+		rules.hunters = 10 <= players ? 1 : 0;
+		return rules;
+	}
+
+	int VillageRules::count(Role role, size_t players)const
+	{
+		switch (role)
+		{
+		case Role::Werewolf:
+			return werewolves;
+		case Role::Seer:
+			return seers;
+		case Role::Medium:
+			return mediums;
+		case Role::Hunter:
+			return hunters;
+		case Role::Madman:
+			return madmen;
+		default:
+			return static_cast<int>(players) - werewolves - seers - mediums - hunters - madmen;
+		}
+	}
+
+	RoleConstraints RoleConstraints::FromBoard(const Board& board, const VillageRules& rules)
+	{
+		RoleConstraints constraints;
+		const size_t players = board.size();
+		constraints.masks.resize(players);
+		constraints.isClaimant.resize(players);
+		constraints.isAlive.resize(players);
+		for (size_t i = 0; i < players; ++i)
+		{
+			const Node& node = board.nodes[i];
+			constraints.isClaimant[i] = node.co != Node::None ? 1 : 0;
+			constraints.isAlive[i] = node.state == Node::Alive ? 1 : 0;
+			constraints.masks[i] = ClaimMask(node.co);
+			if (node.state == Node::Bitten)
+			{
+				constraints.masks[i] &= ~WolfBit;
+			}
+		}
+
+		for (const auto& edge : board.adjacents.edges())
+		{
+			const Node::Roal co = board.nodes[edge.from].co;
+			if (co == Node::Fortuneteller || co == Node::Spiritualist)
+			{
+				constraints.claims.push_back({ edge.from, edge.to, co == Node::Fortuneteller ? Role::Seer : Role::Medium, edge.color == 2 });
+			}
+		}
+
+		//EdgeStore の並びによらずキーが同じになるように並べる
+		std::sort(constraints.claims.begin(), constraints.claims.end(), [](const Claim& a, const Claim& b)
+		{
+			return a.claimant != b.claimant ? a.claimant < b.claimant : a.target < b.target;
+		});
+
+		for (size_t role = 0; role < RoleCount; ++role)
+		{
+			constraints.counts[role] = rules.count(static_cast<Role>(role), players);
+		}
+		constraints.gameContinues = rules.gameContinues;
+		return constraints;
+	}
+
+	std::string RoleConstraints::key()const
+	{
+		std::string result;
+		result.reserve(3 * size() + 9 * claims.size() + 4 * RoleCount + 1);
+		for (size_t i = 0; i < size(); ++i)
+		{
+			result.push_back(static_cast<char>(masks[i]));
+			result.push_back(static_cast<char>(isClaimant[i] | (isAlive[i] << 1)));
+		}
+
+		const auto append = [&](std::int32_t value)
+		{
+			result.append(reinterpret_cast<const char*>(&value), sizeof(value));
+		};
+		for (const auto& claim : claims)
+		{
+			append(claim.claimant);
+			append(claim.target);
+			result.push_back(static_cast<char>(static_cast<int>(claim.trueRole) | (claim.isBlack ? 0x80 : 0)));
+		}
+
+		result.push_back('|');
+		for (const int count : counts)
+		{
+			append(count);
+		}
+		result.push_back(gameContinues ? 1 : 0);
+		return result;
+	}
+
+	void RoleCounts::add(const RoleCounts& other)
+	{
+		worlds += other.worlds;
+		visitedNodes += other.visitedNodes;
+		weights.resize(std::max(weights.size(), other.weights.size()));
+		for (size_t i = 0; i < other.weights.size(); ++i)
+		{
+			for (size_t role = 0; role < RoleCount; ++role)
+			{
+				weights[i][role] += other.weights[i][role];
+			}
+		}
+	}
+
+	RoleSolution RoleCounts::normalized()const
+	{
+		RoleSolution solution;
+		solution.worlds = worlds;
+		solution.visitedNodes = visitedNodes;
+		solution.probabilities = weights;
+		if (0.0 < worlds)
+		{
+			for (auto& probability : solution.probabilities)
+			{
+				for (auto& value : probability)
+				{
+					value /= worlds;
+				}
+			}
+		}
+		return solution;
+	}
+
+	RoleCounts CountRoles(const RoleConstraints& constraints, const std::atomic<bool>* cancel)
+	{
+		return Solver(constraints, cancel).solve();
+	}
+
+	double EstimateSearchSize(const RoleConstraints& constraints)
+	{
+		std::vector<RoleMask> masks = constraints.masks;
+		if (!Propagate(constraints.claims, masks))
+		{
+			return 0.0;
+		}
+
+		double size = 1.0;
+		for (const int i : SearchOrder(constraints))
+		{
+			if (!IsDecided(constraints.isClaimant[i], masks[i]))
+			{
+				size *= constraints.isClaimant[i] ? PopCount(masks[i]) : 2;
+			}
+		}
+		return size;
+	}
+
+	std::vector<RoleConstraints> SplitRoles(const RoleConstraints& constraints)
+	{
+		std::vector<RoleMask> masks = constraints.masks;
+		if (!Propagate(constraints.claims, masks))
+		{
+			return{};
+		}
+
+		int first = -1;
+		for (const int i : SearchOrder(constraints))
+		{
+			if (!IsDecided(constraints.isClaimant[i], masks[i]))
+			{
+				first = i;
+				break;
+			}
+		}
+		if (first < 0)
+		{
+			return{};
+		}
+
+		std::vector<RoleMask> choices;
+		if (constraints.isClaimant[first])
+		{
+			for (RoleMask rest = masks[first]; rest; rest &= rest - 1)
+			{
+				choices.push_back(rest & ~(rest - 1));
+			}
+		}
+		else
+		{
+			choices = { static_cast<RoleMask>(masks[first] & WolfBit), static_cast<RoleMask>(masks[first] & ~WolfBit) };
+		}
+
+		std::vector<RoleConstraints> result;
+		for (const RoleMask choice : choices)
+		{
+			RoleConstraints child = constraints;
+			child.masks = masks;
+			child.masks[first] = choice;
+			if (!Propagate(child.claims, child.masks))
+			{
+				continue;
+			}
+
+			//本物でないと決まったプレイヤーの結果は、割り当てを絞らない
+			child.claims.erase(std::remove_if(child.claims.begin(), child.claims.end(), [&](const Claim& claim)
+			{
+				return !(child.masks[claim.claimant] & RoleBit(claim.trueRole));
+			}), child.claims.end());
+			result.push_back(std::move(child));
+		}
+		return result;
+	}
+
+	RoleSolution SolveRoles(const Board& board, const VillageRules& rules)
+	{
+		return CountRoles(RoleConstraints::FromBoard(board, rules)).normalized();
+	}
+}
@@ -0,0 +1,142 @@
+﻿# pragma once
+# include <array>
+# include <atomic>
+# include <cstddef>
+# include <cstdint>
+# include <string>
+# include <vector>
+# include "Board.hpp"
+
+namespace core
+{
+	//プレイヤーの本当の役職
+	enum class Role : std::uint8_t
+	{
+		Villager,
+		Werewolf,
+		Seer,
+		Medium,
+		Hunter,
+		Madman,
+	};
+
+	constexpr size_t RoleCount = 6;
+
+	//役職の候補の集合、Role の番号のビットを立てる
+	using RoleMask = std::uint8_t;
+
+	constexpr RoleMask RoleBit(Role role)
+	{
+		return static_cast<RoleMask>(1u << static_cast<unsigned>(role));
+	}
+
+	const char* ToString(Role role);
+
+	//村の配役と、盤面を解くときの前提
+	struct VillageRules
+	{
+		//役職ごとの人数、村人は残りの全員
+		int werewolves = 3;
+		int madmen = 1;
+		int seers = 1;
+		int mediums = 1;
+		int hunters = 1;
+
+		//まだ決着していない盤面として解く(生きている人狼が一人以上いて、生きている人狼以外より少ない)
+		bool gameContinues = true;
+
+		//人数に合わせた配役(人狼と狂人以外は、役職を騙らない)
+		static VillageRules ForPopulation(size_t players);
+
+		int count(Role role, size_t players)const;
+	};
+
+	//盤面から取り出した、役職の割り当てが満たすべき条件
+	struct RoleConstraints
+	{
+		//占い・霊媒の結果一つ、claimant が trueRole のときだけ正しい
+		struct Claim
+		{
+			int claimant;
+			int target;
+			Role trueRole;
+			bool isBlack;
+		};
+
+		//プレイヤーごとの役職の候補
+		std::vector<RoleMask> masks;
+		std::vector<std::uint8_t> isClaimant;
+		std::vector<std::uint8_t> isAlive;
+
+		std::vector<Claim> claims;
+
+		//役職ごとの人数
+		std::array<int, RoleCount> counts{};
+		bool gameContinues = true;
+
+		static RoleConstraints FromBoard(const Board& board, const VillageRules& rules);
+
+		size_t size()const
+		{
+			return masks.size();
+		}
+
+		//同じ条件なら同じになるバイト列、部分問題の結果のキャッシュのキーにする
+		std::string key()const;
+	};
+
+	struct RoleSolution
+	{
+		//盤面と矛盾しない役職の割り当ての数
+		double worlds = 0.0;
+
+		//probabilities[i][role]: 矛盾しない割り当てのうち、i 番目のプレイヤーが role であるものの割合
+		std::vector<std::array<double, RoleCount>> probabilities;
+
+		//探索した節の数
+		std::uint64_t visitedNodes = 0;
+
+		double probability(size_t player, Role role)const
+		{
+			return probabilities[player][static_cast<size_t>(role)];
+		}
+	};
+
+	//割合にする前の数え上げの結果、部分問題ごとの結果を足し合わせられる
+	struct RoleCounts
+	{
+		double worlds = 0.0;
+
+		//weights[i][role]: i 番目のプレイヤーが role である割り当ての数
+		std::vector<std::array<double, RoleCount>> weights;
+
+		std::uint64_t visitedNodes = 0;
+
+		void add(const RoleCounts& other);
+
+		RoleSolution normalized()const;
+	};
+
+	//constraints を満たす割り当てを数える(SolveRoles の説明を参照)
+	//cancel が true になったら途中でやめる、そのときの結果は使えない
+	RoleCounts CountRoles(const RoleConstraints& constraints, const std::atomic<bool>* cancel = nullptr);
+
+	//探索の葉の数の見積もり(まだ決まっていないプレイヤーの候補の数の積)、矛盾していれば 0
+	//数え上げ自体は枝刈りするので、実際の葉はこれより少ない
+	double EstimateSearchSize(const RoleConstraints& constraints);
+
+	//探索で最初に決めるプレイヤーの候補ごとに分けた部分問題、矛盾する候補は含めない
+	//部分問題では本物でないと決まったプレイヤーの結果を取り除くので、そのプレイヤーの結果が変わってもキーは変わらない
+	//全てのプレイヤーが決まっていて分けられないときは空
+	std::vector<RoleConstraints> SplitRoles(const RoleConstraints& constraints);
+
+	//盤面の CO、占い・霊媒の結果(白出し・黒出し)、噛まれたプレイヤーと矛盾しない役職の割り当てを全て数える
+	//
+	//	COしたプレイヤーは、その役職か、騙っている人狼か狂人(狂人COは狂人か人狼)
+	//	本物の占い師・霊媒師の結果は正しい、COしていないプレイヤーの出したリンクは使わない
+	//	噛まれたプレイヤーは人狼ではない
+	//
+	//候補をビット集合で持ち、占い・霊媒の結果から候補を絞り込みながら、CO したプレイヤーと結果に関わるプレイヤーだけを探索する
+	//関わりの無いプレイヤーは生死ごとに区別せず、組み合わせの数で数える
+	RoleSolution SolveRoles(const Board& board, const VillageRules& rules);
+}
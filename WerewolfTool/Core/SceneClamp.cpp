@@ -0,0 +1,258 @@
+﻿# include "SceneClamp.hpp"
+
+# if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#	define CORE_SCENE_CLAMP_X86
+#	include <immintrin.h>
+# endif
+
+//GCCとClangではAVX2の命令を使う関数だけAVX2向けにコンパイルする
+# if defined(CORE_SCENE_CLAMP_X86) && (defined(__GNUC__) || defined(__clang__))
+#	define CORE_TARGET_AVX2 __attribute__((target("avx2")))
+# else
+#	define CORE_TARGET_AVX2
+# endif
+
+namespace core
+{
+	namespace
+	{
+		//一つの頂点を FixedPosVel で戻す
+		//scene は値で受け取り、x や vx に書き込んだ後に読み直さないようにする
+		inline void ClampOne(const RectF scene, double radius, size_t i, double* x, double* y, double* vx, double* vy)
+		{
+			const RectF scope = scene.stretched(-radius, -radius);
+			const auto posVel = FixedPosVel(Vec2(x[i], y[i]), Vec2(vx[i], vy[i]), scope);
+			x[i] = posVel.first.x;
+			y[i] = posVel.first.y;
+			vx[i] = posVel.second.x;
+			vy[i] = posVel.second.y;
+		}
+
+		void ClampScalar(const RectF scene, const double* radius, const std::uint8_t* fixed,
+			size_t first, size_t last, double* x, double* y, double* vx, double* vy)
+		{
+			for (size_t i = first; i < last; ++i)
+			{
+				if (!fixed[i])
+				{
+					ClampOne(scene, radius[i], i, x, y, vx, vy);
+				}
+			}
+		}
+
+# if defined(CORE_SCENE_CLAMP_X86)
+		//二つずつ矩形の中にあるかを調べ、はみ出した頂点だけを一点ずつ戻す
+		//はみ出した頂点を二つ並べて計算すると四辺とも計算することになり、一点ずつ戻すのと変わらない
+		void ClampSSE2(const RectF& scene, const double* radius, const std::uint8_t* fixed,
+			size_t first, size_t last, double* x, double* y, double* vx, double* vy)
+		{
+			const __m128d two = _mm_set1_pd(2.0);
+			const __m128d sign = _mm_set1_pd(-0.0);
+			const __m128d sceneX = _mm_set1_pd(scene.pos.x);
+			const __m128d sceneY = _mm_set1_pd(scene.pos.y);
+			const __m128d sceneW = _mm_set1_pd(scene.size.x);
+			const __m128d sceneH = _mm_set1_pd(scene.size.y);
+
+			size_t i = first;
+			for (; i + 2 <= last; i += 2)
+			{
+				const __m128d px = _mm_loadu_pd(x + i);
+				const __m128d py = _mm_loadu_pd(y + i);
+
+				//scene.stretched(-radius, -radius)
+				const __m128d shrink = _mm_xor_pd(_mm_loadu_pd(radius + i), sign);
+				const __m128d left = _mm_sub_pd(sceneX, shrink);
+				const __m128d top = _mm_sub_pd(sceneY, shrink);
+				const __m128d width = _mm_add_pd(sceneW, _mm_mul_pd(shrink, two));
+				const __m128d height = _mm_add_pd(sceneH, _mm_mul_pd(shrink, two));
+
+				const __m128d isFixed = _mm_castsi128_pd(_mm_set_epi64x(fixed[i + 1] ? -1 : 0, fixed[i] ? -1 : 0));
+				const __m128d inside = _mm_and_pd(
+					_mm_and_pd(_mm_cmple_pd(left, px), _mm_cmplt_pd(px, _mm_add_pd(left, width))),
+					_mm_and_pd(_mm_cmple_pd(top, py), _mm_cmplt_pd(py, _mm_add_pd(top, height))));
+				const __m128d keep = _mm_or_pd(isFixed, inside);
+
+				//ほとんどの頂点は矩形の中にあるので、ここで次に進む
+				const int kept = _mm_movemask_pd(keep);
+				if (kept == 0x3)
+				{
+					continue;
+				}
+				for (size_t lane = 0; lane < 2; ++lane)
+				{
+					if (!(kept & (1 << lane)))
+					{
+						ClampOne(scene, radius[i + lane], i + lane, x, y, vx, vy);
+					}
+				}
+			}
+
+			ClampScalar(scene, radius, fixed, i, last, x, y, vx, vy);
+		}
+
+		//以下のAVX2版は FixedPosVel, Line::closest, RectF::stretched と同じ演算を同じ順に行う
+		//(途中で式を簡単にすると丸めが変わり、一点ずつ計算したときと結果が一致しなくなる)
+		//四つのうち二つ以上がはみ出しているときは、四辺との計算をまとめて行い、分岐の代わりにマスクで結果を選ぶ
+
+		CORE_TARGET_AVX2
+		inline __m256d IsOuterAVX2(__m256d ax, __m256d ay, __m256d bx, __m256d by, __m256d px, __m256d py)
+		{
+			const __m256d cross = _mm256_sub_pd(_mm256_mul_pd(_mm256_sub_pd(bx, ax), _mm256_sub_pd(py, ay)), _mm256_mul_pd(_mm256_sub_pd(by, ay), _mm256_sub_pd(px, ax)));
+			return _mm256_cmp_pd(cross, _mm256_setzero_pd(), _CMP_LT_OQ);
+		}
+
+		CORE_TARGET_AVX2
+		inline void ClosestAVX2(__m256d ax, __m256d ay, __m256d bx, __m256d by, __m256d px, __m256d py, __m256d& rx, __m256d& ry)
+		{
+			const __m256d zero = _mm256_setzero_pd();
+			const __m256d vx = _mm256_sub_pd(bx, ax);
+			const __m256d vy = _mm256_sub_pd(by, ay);
+			const __m256d length = _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(vx, vx), _mm256_mul_pd(vy, vy)));
+			const __m256d dx = _mm256_div_pd(vx, length);
+			const __m256d dy = _mm256_div_pd(vy, length);
+			const __m256d t = _mm256_add_pd(_mm256_mul_pd(dx, _mm256_sub_pd(px, ax)), _mm256_mul_pd(dy, _mm256_sub_pd(py, ay)));
+
+			const __m256d toBegin = _mm256_or_pd(_mm256_cmp_pd(length, zero, _CMP_EQ_OQ), _mm256_cmp_pd(t, zero, _CMP_LE_OQ));
+			const __m256d toEnd = _mm256_cmp_pd(length, t, _CMP_LE_OQ);
+			rx = _mm256_blendv_pd(_mm256_blendv_pd(_mm256_add_pd(ax, _mm256_mul_pd(dx, t)), bx, toEnd), ax, toBegin);
+			ry = _mm256_blendv_pd(_mm256_blendv_pd(_mm256_add_pd(ay, _mm256_mul_pd(dy, t)), by, toEnd), ay, toBegin);
+		}
+
+		CORE_TARGET_AVX2
+		void ClampAVX2(const RectF& scene, const double* radius, const std::uint8_t* fixed,
+			size_t first, size_t last, double* x, double* y, double* vx, double* vy)
+		{
+			const __m256d zero = _mm256_setzero_pd();
+			const __m256d one = _mm256_set1_pd(1.0);
+			const __m256d two = _mm256_set1_pd(2.0);
+			const __m256d sign = _mm256_set1_pd(-0.0);
+			const __m256d sceneX = _mm256_set1_pd(scene.pos.x);
+			const __m256d sceneY = _mm256_set1_pd(scene.pos.y);
+			const __m256d sceneW = _mm256_set1_pd(scene.size.x);
+			const __m256d sceneH = _mm256_set1_pd(scene.size.y);
+
+			size_t i = first;
+			for (; i + 4 <= last; i += 4)
+			{
+				const __m256d px = _mm256_loadu_pd(x + i);
+				const __m256d py = _mm256_loadu_pd(y + i);
+
+				const __m256d shrink = _mm256_xor_pd(_mm256_loadu_pd(radius + i), sign);
+				const __m256d left = _mm256_sub_pd(sceneX, shrink);
+				const __m256d top = _mm256_sub_pd(sceneY, shrink);
+				const __m256d width = _mm256_add_pd(sceneW, _mm256_mul_pd(shrink, two));
+				const __m256d height = _mm256_add_pd(sceneH, _mm256_mul_pd(shrink, two));
+
+				const __m256d isFixed = _mm256_castsi256_pd(_mm256_set_epi64x(
+					fixed[i + 3] ? -1 : 0, fixed[i + 2] ? -1 : 0, fixed[i + 1] ? -1 : 0, fixed[i] ? -1 : 0));
+				const __m256d inside = _mm256_and_pd(
+					_mm256_and_pd(_mm256_cmp_pd(left, px, _CMP_LE_OQ), _mm256_cmp_pd(px, _mm256_add_pd(left, width), _CMP_LT_OQ)),
+					_mm256_and_pd(_mm256_cmp_pd(top, py, _CMP_LE_OQ), _mm256_cmp_pd(py, _mm256_add_pd(top, height), _CMP_LT_OQ)));
+				const __m256d keep = _mm256_or_pd(isFixed, inside);
+
+				const int kept = _mm256_movemask_pd(keep);
+				if (kept == 0xF)
+				{
+					continue;
+				}
+
+				//はみ出したのが一つだけなら、その頂点だけを一点ずつ戻す方が速い
+				if (kept == 0xE || kept == 0xD || kept == 0xB || kept == 0x7)
+				{
+					const size_t lane = kept == 0xE ? 0 : kept == 0xD ? 1 : kept == 0xB ? 2 : 3;
+					ClampOne(scene, radius[i + lane], i + lane, x, y, vx, vy);
+					continue;
+				}
+
+				const __m256d pvx = _mm256_loadu_pd(vx + i);
+				const __m256d pvy = _mm256_loadu_pd(vy + i);
+
+				const __m256d tlX = left;
+				const __m256d tlY = top;
+				const __m256d trX = _mm256_add_pd(left, width);
+				const __m256d trY = _mm256_add_pd(top, zero);
+				const __m256d brX = _mm256_add_pd(left, width);
+				const __m256d brY = _mm256_add_pd(top, height);
+				const __m256d blX = _mm256_add_pd(left, zero);
+				const __m256d blY = _mm256_add_pd(top, height);
+
+				const __m256d outerTop = IsOuterAVX2(tlX, tlY, trX, trY, px, py);
+				const __m256d outerRight = IsOuterAVX2(trX, trY, brX, brY, px, py);
+				const __m256d outerBottom = IsOuterAVX2(brX, brY, blX, blY, px, py);
+				const __m256d outerLeft = IsOuterAVX2(blX, blY, tlX, tlY, px, py);
+
+				const __m256d realTrX = _mm256_add_pd(trX, one);
+				const __m256d realTrY = _mm256_add_pd(trY, zero);
+				const __m256d realBrX = _mm256_add_pd(brX, one);
+				const __m256d realBrY = _mm256_add_pd(brY, one);
+				const __m256d realBlX = _mm256_add_pd(blX, zero);
+				const __m256d realBlY = _mm256_add_pd(blY, one);
+
+				__m256d topX, topY, rightX, rightY, bottomX, bottomY, leftX, leftY;
+				ClosestAVX2(tlX, tlY, realTrX, realTrY, px, py, topX, topY);
+				ClosestAVX2(realTrX, realTrY, realBrX, realBrY, px, py, rightX, rightY);
+				ClosestAVX2(realBrX, realBrY, realBlX, realBlY, px, py, bottomX, bottomY);
+				ClosestAVX2(realBlX, realBlY, tlX, tlY, px, py, leftX, leftY);
+
+				const __m256d topLeft = _mm256_and_pd(outerTop, outerLeft);
+				const __m256d topRight = _mm256_and_pd(outerTop, outerRight);
+				const __m256d bottomRight = _mm256_and_pd(outerBottom, outerRight);
+				const __m256d bottomLeft = _mm256_and_pd(outerBottom, outerLeft);
+
+				__m256d rx = _mm256_blendv_pd(rightX, leftX, outerLeft);
+				__m256d ry = _mm256_blendv_pd(rightY, leftY, outerLeft);
+				__m256d rvx = zero;
+				__m256d rvy = pvy;
+
+				rx = _mm256_blendv_pd(rx, bottomX, outerBottom);
+				ry = _mm256_blendv_pd(ry, bottomY, outerBottom);
+				rvx = _mm256_blendv_pd(rvx, pvx, outerBottom);
+				rvy = _mm256_blendv_pd(rvy, zero, outerBottom);
+
+				rx = _mm256_blendv_pd(rx, blX, bottomLeft);
+				ry = _mm256_blendv_pd(ry, blY, bottomLeft);
+				rx = _mm256_blendv_pd(rx, brX, bottomRight);
+				ry = _mm256_blendv_pd(ry, brY, bottomRight);
+				rvx = _mm256_blendv_pd(rvx, zero, _mm256_or_pd(bottomLeft, bottomRight));
+
+				rx = _mm256_blendv_pd(rx, topX, outerTop);
+				ry = _mm256_blendv_pd(ry, topY, outerTop);
+				rvx = _mm256_blendv_pd(rvx, pvx, outerTop);
+				rvy = _mm256_blendv_pd(rvy, zero, outerTop);
+
+				rx = _mm256_blendv_pd(rx, trX, topRight);
+				ry = _mm256_blendv_pd(ry, trY, topRight);
+				rx = _mm256_blendv_pd(rx, tlX, topLeft);
+				ry = _mm256_blendv_pd(ry, tlY, topLeft);
+				rvx = _mm256_blendv_pd(rvx, zero, _mm256_or_pd(topLeft, topRight));
+
+				_mm256_storeu_pd(x + i, _mm256_blendv_pd(rx, px, keep));
+				_mm256_storeu_pd(y + i, _mm256_blendv_pd(ry, py, keep));
+				_mm256_storeu_pd(vx + i, _mm256_blendv_pd(rvx, pvx, keep));
+				_mm256_storeu_pd(vy + i, _mm256_blendv_pd(rvy, pvy, keep));
+			}
+
+			ClampScalar(scene, radius, fixed, i, last, x, y, vx, vy);
+		}
+# endif
+	}
+
+	void ClampToScene(ForceKernel kernel, const RectF& scene, const double* radius, const std::uint8_t* fixed,
+		size_t first, size_t last, double* x, double* y, double* vx, double* vy)
+	{
+		switch (ResolveForceKernel(kernel))
+		{
+# if defined(CORE_SCENE_CLAMP_X86)
+		case ForceKernel::SSE2:
+			ClampSSE2(scene, radius, fixed, first, last, x, y, vx, vy);
+			return;
+		case ForceKernel::AVX2:
+			ClampAVX2(scene, radius, fixed, first, last, x, y, vx, vy);
+			return;
+# endif
+		default:
+			ClampScalar(scene, radius, fixed, first, last, x, y, vx, vy);
+			return;
+		}
+	}
+}
@@ -0,0 +1,16 @@
+﻿# pragma once
+# include <cstddef>
+# include <cstdint>
+# include "ForceKernel.hpp"
+# include "Geometry.hpp"
+
+namespace core
+{
+	//i ∈ [first, last) かつ fixed[i] == 0 の頂点を scene.stretched(-radius[i], -radius[i]) の中に戻す
+	//一つずつ FixedPosVel を呼んだときと同じ規則で位置と速度を書き換え、結果もビット単位で一致する
+	//SSE2 と AVX2 では複数の頂点をまとめて矩形の中にあるかを調べ、全て中にあるまとまりは何もせずに飛ばす
+	//はみ出した頂点は、SSE2 と、AVX2 で一つだけはみ出したときは一点ずつ FixedPosVel で戻し
+	//AVX2 で二つ以上はみ出したときはまとめて計算してマスクで結果を選ぶ
+	void ClampToScene(ForceKernel kernel, const RectF& scene, const double* radius, const std::uint8_t* fixed,
+		size_t first, size_t last, double* x, double* y, double* vx, double* vy);
+}
@@ -0,0 +1,86 @@
+﻿# include "SegmentGrid.hpp"
+# include <algorithm>
+# include <cmath>
+# include <limits>
+
+namespace core
+{
+	SegmentGrid::SegmentGrid(double cellSize)
+		: cellLength(cellSize)
+	{}
+
+	void SegmentGrid::clear()
+	{
+		segments.clear();
+		cells.clear();
+		visited.clear();
+		stamp = 0;
+	}
+
+	std::int32_t SegmentGrid::CellCoord(double v)const
+	{
+		return static_cast<std::int32_t>(std::clamp(std::floor(v / cellLength), -1.0e9, 1.0e9));
+	}
+
+	void SegmentGrid::insert(std::uint32_t id, const Line& segment)
+	{
+		const auto index = static_cast<std::uint32_t>(segments.size());
+		segments.push_back({ id, segment });
+		visited.push_back(0);
+
+		traverse(segment, scratchCells);
+		for (const std::int64_t key : scratchCells)
+		{
+			cells[key].push_back(index);
+		}
+	}
+
+	void SegmentGrid::traverse(const Line& segment, std::vector<std::int64_t>& keys)const
+	{
+		keys.clear();
+
+		const Vec2 begin = segment.begin;
+		const Vec2 end = segment.end;
+		if (!std::isfinite(begin.x) || !std::isfinite(begin.y) || !std::isfinite(end.x) || !std::isfinite(end.y))
+		{
+			return;
+		}
+
+		std::int32_t x = CellCoord(begin.x);
+		std::int32_t y = CellCoord(begin.y);
+		const std::int32_t endX = CellCoord(end.x);
+		const std::int32_t endY = CellCoord(end.y);
+
+		const Vec2 d = end - begin;
+		const std::int32_t stepX = d.x > 0 ? 1 : -1;
+		const std::int32_t stepY = d.y > 0 ? 1 : -1;
+
+		//次のセルの境界に着くまでの媒介変数 t と、一セル進むごとの t の増分
+		constexpr double Infinity = std::numeric_limits<double>::infinity();
+		const double nextX = (x + (stepX > 0 ? 1 : 0)) * cellLength;
+		const double nextY = (y + (stepY > 0 ? 1 : 0)) * cellLength;
+		double tMaxX = d.x != 0.0 ? (nextX - begin.x) / d.x : Infinity;
+		double tMaxY = d.y != 0.0 ? (nextY - begin.y) / d.y : Infinity;
+		const double tDeltaX = d.x != 0.0 ? cellLength / std::abs(d.x) : Infinity;
+		const double tDeltaY = d.y != 0.0 ? cellLength / std::abs(d.y) : Infinity;
+
+		//丸め誤差で終点のセルを通り過ぎないように、通るセルの数で打ち切る
+		const std::int64_t maxCells = std::abs(static_cast<std::int64_t>(endX) - x) + std::abs(static_cast<std::int64_t>(endY) - y) + 1;
+
+		keys.push_back(Key(x, y));
+		while (static_cast<std::int64_t>(keys.size()) < maxCells && (x != endX || y != endY))
+		{
+			if (tMaxX < tMaxY)
+			{
+				x += stepX;
+				tMaxX += tDeltaX;
+			}
+			else
+			{
+				y += stepY;
+				tMaxY += tDeltaY;
+			}
+			keys.push_back(Key(x, y));
+		}
+	}
+}
@@ -0,0 +1,88 @@
+﻿# pragma once
+# include <cstdint>
+# include <unordered_map>
+# include <vector>
+# include "Geometry.hpp"
+
+namespace core
+{
+	//線分を、その線分が通るセルに登録する一様な格子
+	//別の線分と交わるものを探すときは、その線分が通るセルに登録されたものだけを調べる
+	class SegmentGrid
+	{
+	public:
+		explicit SegmentGrid(double cellSize = 128.0);
+
+		void clear();
+
+		//id は呼び出し側で決める番号(同じ番号を何度登録してもよい)
+		void insert(std::uint32_t id, const Line& segment);
+
+		//stroke と交わる線分を一本につき一度ずつ列挙する func(id, segment)
+		//作業用の配列を使い回すので、同じ SegmentGrid を複数のスレッドから同時に引かないこと
+		template <class Func>
+		void forEachIntersecting(const Line& stroke, Func func)const
+		{
+			traverse(stroke, scratchCells);
+
+			//一本の線分が複数のセルに入っているので、今回調べたかどうかを印で覚える
+			if (++stamp == 0)
+			{
+				std::fill(visited.begin(), visited.end(), 0);
+				stamp = 1;
+			}
+
+			for (const std::int64_t key : scratchCells)
+			{
+				const auto it = cells.find(key);
+				if (it == cells.end())
+				{
+					continue;
+				}
+				for (const std::uint32_t index : it->second)
+				{
+					if (visited[index] == stamp)
+					{
+						continue;
+					}
+					visited[index] = stamp;
+
+					if (segments[index].segment.intersects(stroke))
+					{
+						func(segments[index].id, segments[index].segment);
+					}
+				}
+			}
+		}
+
+		size_t size()const
+		{
+			return segments.size();
+		}
+
+	private:
+		struct Segment
+		{
+			std::uint32_t id;
+			Line segment;
+		};
+
+		static std::int64_t Key(std::int32_t x, std::int32_t y)
+		{
+			return (static_cast<std::int64_t>(x) << 32) ^ static_cast<std::uint32_t>(y);
+		}
+
+		std::int32_t CellCoord(double v)const;
+
+		//segment が通るセルを始点側から順に keys に入れる(Amanatides-Woo の方法)
+		void traverse(const Line& segment, std::vector<std::int64_t>& keys)const;
+
+		double cellLength;
+		std::vector<Segment> segments;
+		std::unordered_map<std::int64_t, std::vector<std::uint32_t>> cells;
+
+		mutable std::vector<std::int64_t> scratchCells;
+		mutable std::vector<std::uint32_t> visited;
+		mutable std::uint32_t stamp = 0;
+	};
+}
@@ -0,0 +1,103 @@
+﻿# include "SpatialGrid.hpp"
+# include <algorithm>
+# include <cmath>
+
+namespace core
+{
+	SpatialGrid::SpatialGrid(double cellSize)
+		: cellLength(cellSize)
+	{}
+
+	void SpatialGrid::clear()
+	{
+		items.clear();
+		cells.clear();
+	}
+
+	std::int32_t SpatialGrid::CellCoord(double v)const
+	{
+		//画面から大きく外れた値でも int32 に収まるようにする
+		if (!std::isfinite(v))
+		{
+			return 0;
+		}
+		const double cell = std::floor(v / cellLength);
+		return static_cast<std::int32_t>(std::clamp(cell, -1.0e9, 1.0e9));
+	}
+
+	void SpatialGrid::update(size_t id, const RectF& bounds)
+	{
+		if (items.size() <= id)
+		{
+			items.resize(id + 1);
+		}
+
+		Item& item = items[id];
+		item.bounds = bounds;
+
+		const std::int32_t x0 = CellCoord(bounds.pos.x);
+		const std::int32_t y0 = CellCoord(bounds.pos.y);
+		const std::int32_t x1 = CellCoord(bounds.pos.x + bounds.size.x);
+		const std::int32_t y1 = CellCoord(bounds.pos.y + bounds.size.y);
+		if (x0 == item.x0 && y0 == item.y0 && x1 == item.x1 && y1 == item.y1)
+		{
+			return;
+		}
+
+		unlink(static_cast<std::uint32_t>(id));
+		item.x0 = x0;
+		item.y0 = y0;
+		item.x1 = x1;
+		item.y1 = y1;
+		link(static_cast<std::uint32_t>(id));
+	}
+
+	void SpatialGrid::remove(size_t id)
+	{
+		if (id < items.size())
+		{
+			unlink(static_cast<std::uint32_t>(id));
+			items[id] = Item();
+		}
+	}
+
+	void SpatialGrid::link(std::uint32_t id)
+	{
+		const Item& item = items[id];
+		for (std::int32_t y = item.y0; y <= item.y1; ++y)
+		{
+			for (std::int32_t x = item.x0; x <= item.x1; ++x)
+			{
+				cells[Key(x, y)].push_back(id);
+			}
+		}
+	}
+
+	void SpatialGrid::unlink(std::uint32_t id)
+	{
+		const Item& item = items[id];
+		for (std::int32_t y = item.y0; y <= item.y1; ++y)
+		{
+			for (std::int32_t x = item.x0; x <= item.x1; ++x)
+			{
+				const auto it = cells.find(Key(x, y));
+				if (it == cells.end())
+				{
+					continue;
+				}
+
+				auto& ids = it->second;
+				const auto found = std::find(ids.begin(), ids.end(), id);
+				if (found != ids.end())
+				{
+					*found = ids.back();
+					ids.pop_back();
+				}
+				if (ids.empty())
+				{
+					cells.erase(it);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,109 @@
+﻿# pragma once
+# include <cstdint>
+# include <unordered_map>
+# include <vector>
+# include "Geometry.hpp"
+
+namespace core
+{
+	//円や矩形などを境界矩形で一様な格子に登録し、点や範囲に重なるものを探す
+	//登録したものは 0 から始まる番号で区別する、番号が大きいものほど手前に描かれている前提で topmost を選ぶ
+	class SpatialGrid
+	{
+	public:
+		explicit SpatialGrid(double cellSize = 128.0);
+
+		double cellSize()const
+		{
+			return cellLength;
+		}
+
+		void clear();
+
+		//id の境界矩形を登録する、既にあれば置き換える
+		//掛かるセルが変わらなければ境界矩形を書き換えるだけで済む
+		void update(size_t id, const RectF& bounds);
+
+		void remove(size_t id);
+
+		//境界矩形が point を含むものの id を順不同で列挙する
+		template <class Func>
+		void forEachAt(const Vec2& point, Func func)const
+		{
+			const auto it = cells.find(Key(CellCoord(point.x), CellCoord(point.y)));
+			if (it == cells.end())
+			{
+				return;
+			}
+			for (const std::uint32_t id : it->second)
+			{
+				if (Contains(items[id].bounds, point))
+				{
+					func(static_cast<size_t>(id));
+				}
+			}
+		}
+
+		//境界矩形が point を含み、hit(id) が true になるもののうち一番手前(id が最大)のもの、無ければ -1
+		template <class Hit>
+		int topmost(const Vec2& point, Hit hit)const
+		{
+			int result = -1;
+			forEachAt(point, [&](size_t id)
+			{
+				if (result < static_cast<int>(id) && hit(id))
+				{
+					result = static_cast<int>(id);
+				}
+			});
+			return result;
+		}
+
+		//一番奥(id が最小)のもの、無ければ -1
+		template <class Hit>
+		int bottommost(const Vec2& point, Hit hit)const
+		{
+			int result = -1;
+			forEachAt(point, [&](size_t id)
+			{
+				if ((result < 0 || static_cast<int>(id) < result) && hit(id))
+				{
+					result = static_cast<int>(id);
+				}
+			});
+			return result;
+		}
+
+	private:
+		struct Item
+		{
+			RectF bounds;
+
+			//掛かっているセルの範囲 [x0, x1] x [y0, y1]
+			std::int32_t x0 = 0;
+			std::int32_t y0 = 0;
+			std::int32_t x1 = -1;
+			std::int32_t y1 = -1;
+		};
+
+		//点の判定は RectF::intersects と違い右端と下端も含める(円の境界上も当たりにするため)
+		static bool Contains(const RectF& rect, const Vec2& p)
+		{
+			return rect.pos.x <= p.x && p.x <= rect.pos.x + rect.size.x && rect.pos.y <= p.y && p.y <= rect.pos.y + rect.size.y;
+		}
+
+		static std::int64_t Key(std::int32_t x, std::int32_t y)
+		{
+			return (static_cast<std::int64_t>(x) << 32) ^ static_cast<std::uint32_t>(y);
+		}
+
+		std::int32_t CellCoord(double v)const;
+
+		void link(std::uint32_t id);
+		void unlink(std::uint32_t id);
+
+		double cellLength;
+		std::vector<Item> items;
+		std::unordered_map<std::int64_t, std::vector<std::uint32_t>> cells;
+	};
+}
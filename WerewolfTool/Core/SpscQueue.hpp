@@ -0,0 +1,72 @@
+﻿# pragma once
+# include <atomic>
+# include <cstddef>
+# include <utility>
+# include <vector>
+
+namespace core
+{
+	//一つのスレッドが push し、別の一つのスレッドが pop する固定長のキュー
+	//どちらの操作もロックを取らず、相手を待たない
+	template <class T>
+	class SpscQueue
+	{
+	public:
+		//capacity は2の累乗に切り上げる
+		explicit SpscQueue(size_t capacity)
+		{
+			size_t size = 1;
+			while (size < capacity)
+			{
+				size *= 2;
+			}
+			slots.resize(size);
+			mask = size - 1;
+		}
+
+		SpscQueue(const SpscQueue&) = delete;
+		SpscQueue& operator=(const SpscQueue&) = delete;
+
+		//満杯のときは value に触らずに false を返す
+		bool push(T&& value)
+		{
+			const size_t t = tail.load(std::memory_order_relaxed);
+			if (t - head.load(std::memory_order_acquire) == slots.size())
+			{
+				return false;
+			}
+
+			slots[t & mask] = std::move(value);
+			tail.store(t + 1, std::memory_order_release);
+			return true;
+		}
+
+		//空のときは false を返す
+		bool pop(T& value)
+		{
+			const size_t h = head.load(std::memory_order_relaxed);
+			if (h == tail.load(std::memory_order_acquire))
+			{
+				return false;
+			}
+
+			value = std::move(slots[h & mask]);
+			head.store(h + 1, std::memory_order_release);
+			return true;
+		}
+
+		//pop する側から見て空か
+		bool empty()const
+		{
+			return head.load(std::memory_order_relaxed) == tail.load(std::memory_order_acquire);
+		}
+
+	private:
+		std::vector<T> slots;
+		size_t mask = 0;
+
+		//push と pop で別のキャッシュラインに置く
+		alignas(64) std::atomic<size_t> head{ 0 };
+		alignas(64) std::atomic<size_t> tail{ 0 };
+	};
+}
@@ -0,0 +1,106 @@
+﻿# include "ThreadPool.hpp"
+
+namespace core
+{
+	ThreadPool::ThreadPool(size_t threadCount)
+	{
+		if (threadCount == 0)
+		{
+			threadCount = HardwareThreadCount();
+		}
+
+		for (size_t i = 1; i < threadCount; ++i)
+		{
+			workers.emplace_back([this] { workerLoop(); });
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard lock(mutex);
+			stopping = true;
+		}
+		wakeCondition.notify_all();
+
+		for (auto& worker : workers)
+		{
+			worker.join();
+		}
+	}
+
+	void ThreadPool::parallelFor(size_t taskCount, const std::function<void(size_t)>& func)
+	{
+		if (workers.empty() || taskCount <= 1)
+		{
+			for (size_t i = 0; i < taskCount; ++i)
+			{
+				func(i);
+			}
+			return;
+		}
+
+		{
+			std::lock_guard lock(mutex);
+			job = &func;
+			jobTaskCount = taskCount;
+			nextTask = 0;
+			runningWorkers = workers.size();
+			++generation;
+		}
+		wakeCondition.notify_all();
+
+		//呼び出し元のスレッドもタスクを取りに行く
+		runTasks();
+
+		std::unique_lock lock(mutex);
+		doneCondition.wait(lock, [&] { return runningWorkers == 0; });
+		job = nullptr;
+	}
+
+	size_t ThreadPool::HardwareThreadCount()
+	{
+		const size_t count = std::thread::hardware_concurrency();
+		return count == 0 ? 1 : count;
+	}
+
+	void ThreadPool::workerLoop()
+	{
+		std::uint64_t seenGeneration = 0;
+		for (;;)
+		{
+			{
+				std::unique_lock lock(mutex);
+				wakeCondition.wait(lock, [&] { return stopping || generation != seenGeneration; });
+				if (stopping)
+				{
+					return;
+				}
+				seenGeneration = generation;
+			}
+
+			runTasks();
+
+			{
+				std::lock_guard lock(mutex);
+				if (--runningWorkers == 0)
+				{
+					doneCondition.notify_one();
+				}
+			}
+		}
+	}
+
+	void ThreadPool::runTasks()
+	{
+		for (;;)
+		{
+			const size_t task = nextTask.fetch_add(1);
+			if (jobTaskCount <= task)
+			{
+				return;
+			}
+			(*job)(task);
+		}
+	}
+}
@@ -0,0 +1,55 @@
+﻿# pragma once
+# include <atomic>
+# include <condition_variable>
+# include <cstdint>
+# include <functional>
+# include <mutex>
+# include <thread>
+# include <vector>
+
+namespace core
+{
+	//起動したまま使い回すワーカースレッド
+	class ThreadPool
+	{
+	public:
+		//threadCount: 呼び出し元のスレッドを含めた並列数、0 ならCPUの論理コア数
+		//1 のときはスレッドを作らず、全て呼び出し元で実行する
+		explicit ThreadPool(size_t threadCount = 0);
+
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		//呼び出し元のスレッドを含めた並列数
+		size_t threadCount()const
+		{
+			return workers.size() + 1;
+		}
+
+		//func(taskIndex) を taskIndex ∈ [0, taskCount) について呼び、全て終わるまで待つ
+		//どのタスクをどのスレッドが実行するかは決まっていないので、タスクごとに書き込み先を分けること
+		void parallelFor(size_t taskCount, const std::function<void(size_t)>& func);
+
+		static size_t HardwareThreadCount();
+
+	private:
+		void workerLoop();
+
+		void runTasks();
+
+		std::vector<std::thread> workers;
+
+		std::mutex mutex;
+		std::condition_variable wakeCondition;
+		std::condition_variable doneCondition;
+
+		const std::function<void(size_t)>* job = nullptr;
+		size_t jobTaskCount = 0;
+		std::atomic<size_t> nextTask{ 0 };
+		size_t runningWorkers = 0;
+		std::uint64_t generation = 0;
+		bool stopping = false;
+	};
+}
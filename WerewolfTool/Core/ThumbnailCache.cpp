@@ -0,0 +1,167 @@
+﻿# include "ThumbnailCache.hpp"
+# include <cstdio>
+# include <cstring>
+# include <fstream>
+# include <system_error>
+# include <vector>
+
+namespace core
+{
+	namespace
+	{
+		constexpr char Magic[8] = { 'W', 'W', 'T', 'H', 'U', 'M', 'B', '\0' };
+		constexpr std::uint32_t Version = 1;
+
+		//ファイルの先頭に置くヘッダ、続けてパス(UTF-8)と、16バイト境界からRGBAの画素を置く
+		struct Header
+		{
+			char magic[8];
+			std::uint32_t version;
+			std::uint32_t width;
+			std::uint32_t height;
+			std::uint32_t pathLength;
+			std::uint64_t fileSize;
+			std::int64_t writeTime;
+		};
+
+		size_t PixelOffset(size_t pathLength)
+		{
+			return (sizeof(Header) + pathLength + 15) / 16 * 16;
+		}
+
+		std::string PathString(const std::filesystem::path& path)
+		{
+			const auto utf8 = path.u8string();
+			return std::string(utf8.begin(), utf8.end());
+		}
+
+		std::uint64_t Fnv1a(const std::string& text, std::uint64_t hash = 14695981039346656037ull)
+		{
+			for (const char c : text)
+			{
+				hash = (hash ^ static_cast<std::uint8_t>(c)) * 1099511628211ull;
+			}
+			return hash;
+		}
+	}
+
+	std::optional<ThumbnailKey> ThumbnailKey::FromFile(const std::filesystem::path& path, std::uint32_t width, std::uint32_t height)
+	{
+		std::error_code error;
+		const auto fileSize = std::filesystem::file_size(path, error);
+		if (error)
+		{
+			return std::nullopt;
+		}
+
+		const auto writeTime = std::filesystem::last_write_time(path, error);
+		if (error)
+		{
+			return std::nullopt;
+		}
+
+		ThumbnailKey key;
+		key.path = path;
+		key.fileSize = fileSize;
+		key.writeTime = static_cast<std::int64_t>(writeTime.time_since_epoch().count());
+		key.width = width;
+		key.height = height;
+		return key;
+	}
+
+	ThumbnailCache::ThumbnailCache(std::filesystem::path directory)
+		: directory(std::move(directory))
+	{}
+
+	std::filesystem::path ThumbnailCache::filePath(const ThumbnailKey& key)const
+	{
+		const std::uint64_t hash = Fnv1a(std::to_string(key.width) + "x" + std::to_string(key.height), Fnv1a(PathString(key.path)));
+
+		char name[32];
+		std::snprintf(name, sizeof(name), "%016llx.thumb", static_cast<unsigned long long>(hash));
+		return directory / name;
+	}
+
+	std::optional<Thumbnail> ThumbnailCache::load(const ThumbnailKey& key)const
+	{
+		auto file = MappedFile::Open(filePath(key));
+		if (!file || file->size() < sizeof(Header))
+		{
+			return std::nullopt;
+		}
+
+		Header header;
+		std::memcpy(&header, file->data(), sizeof(Header));
+
+		const std::string path = PathString(key.path);
+		const size_t pixelOffset = PixelOffset(header.pathLength);
+		const size_t pixelBytes = static_cast<size_t>(header.width) * header.height * 4;
+		if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0
+			|| header.version != Version
+			|| header.width != key.width
+			|| header.height != key.height
+			|| header.fileSize != key.fileSize
+			|| header.writeTime != key.writeTime
+			|| header.pathLength != path.size()
+			|| file->size() < pixelOffset + pixelBytes
+			|| std::memcmp(file->data() + sizeof(Header), path.data(), path.size()) != 0)
+		{
+			return std::nullopt;
+		}
+
+		Thumbnail thumbnail;
+		thumbnail.width = header.width;
+		thumbnail.height = header.height;
+		thumbnail.pixels = file->data() + pixelOffset;
+		thumbnail.file = std::move(*file);
+		return thumbnail;
+	}
+
+	bool ThumbnailCache::store(const ThumbnailKey& key, const std::uint8_t* rgba)const
+	{
+		std::error_code error;
+		std::filesystem::create_directories(directory, error);
+
+		const std::string path = PathString(key.path);
+
+		Header header{};
+		std::memcpy(header.magic, Magic, sizeof(Magic));
+		header.version = Version;
+		header.width = key.width;
+		header.height = key.height;
+		header.pathLength = static_cast<std::uint32_t>(path.size());
+		header.fileSize = key.fileSize;
+		header.writeTime = key.writeTime;
+
+		std::vector<char> bytes(PixelOffset(path.size()), 0);
+		std::memcpy(bytes.data(), &header, sizeof(Header));
+		std::memcpy(bytes.data() + sizeof(Header), path.data(), path.size());
+
+		//書きかけのファイルを読まないように、別名で書いてから置き換える
+		const auto target = filePath(key);
+		auto temporary = target;
+		temporary += ".tmp";
+		bool isWritten = false;
+		{
+			std::ofstream ofs(temporary, std::ios::binary | std::ios::trunc);
+			ofs.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+			ofs.write(reinterpret_cast<const char*>(rgba), static_cast<std::streamsize>(static_cast<size_t>(key.width) * key.height * 4));
+			isWritten = static_cast<bool>(ofs);
+		}
+
+		//書きかけのファイルを残さないように、閉じてから消す
+		if (!isWritten)
+		{
+			std::filesystem::remove(temporary, error);
+			return false;
+		}
+
+		std::filesystem::rename(temporary, target, error);
+		if (error)
+		{
+			std::filesystem::remove(temporary, error);
+			return false;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,55 @@
+﻿# pragma once
+# include <cstddef>
+# include <cstdint>
+# include <filesystem>
+# include <optional>
+# include <string>
+# include "MappedFile.hpp"
+
+namespace core
+{
+	//縮小済み画像のキャッシュを引くためのキー
+	//元画像のパス、サイズ、更新日時と縮小後の大きさが全て一致したときだけキャッシュを使う
+	struct ThumbnailKey
+	{
+		std::filesystem::path path;
+		std::uint64_t fileSize = 0;
+		std::int64_t writeTime = 0;
+		std::uint32_t width = 0;
+		std::uint32_t height = 0;
+
+		//元画像が無いときは std::nullopt
+		static std::optional<ThumbnailKey> FromFile(const std::filesystem::path& path, std::uint32_t width, std::uint32_t height);
+	};
+
+	//キャッシュから読んだ画像、画素はマップしたファイルをそのまま指す
+	struct Thumbnail
+	{
+		MappedFile file;
+		std::uint32_t width = 0;
+		std::uint32_t height = 0;
+
+		//RGBA各8ビット、width * height * 4 バイト
+		const std::uint8_t* pixels = nullptr;
+	};
+
+	//縮小済みのキャラクター画像をディスクに保存しておくキャッシュ
+	//一枚ごとにヘッダと無圧縮のRGBAを並べたファイルを作り、読むときはメモリにマップする
+	class ThumbnailCache
+	{
+	public:
+		explicit ThumbnailCache(std::filesystem::path directory);
+
+		//キーが一致するキャッシュがあれば返す
+		std::optional<Thumbnail> load(const ThumbnailKey& key)const;
+
+		//rgba: width * height * 4 バイト、書き込めなかったときは false
+		bool store(const ThumbnailKey& key, const std::uint8_t* rgba)const;
+
+		//キーに対応するキャッシュファイル、パスと縮小後の大きさのハッシュから名前を決める
+		std::filesystem::path filePath(const ThumbnailKey& key)const;
+
+	private:
+		std::filesystem::path directory;
+	};
+}
@@ -0,0 +1,63 @@
+﻿# pragma once
+# include <atomic>
+# include <cstdint>
+
+namespace core
+{
+	//書き込み側のスレッドと読み込み側のスレッドが互いを待たずに値を受け渡すための三重バッファ
+	//書き込み側は back に書いて publish し、読み込み側は update で最新の値を front に取り出す
+	//読み込み側が取り出す前に何度 publish されても、受け取るのは最後の値だけになる
+	template <class T>
+	class TripleBuffer
+	{
+	public:
+		//書き込み側: 次に公開する値を書く場所、前に使った値が残っているので全て書き直すこと
+		T& back()
+		{
+			return slots[backIndex];
+		}
+
+		//書き込み側: back に書いた値を公開する
+		void publish()
+		{
+			const std::uint8_t previous = middle.exchange(static_cast<std::uint8_t>(backIndex | FreshBit), std::memory_order_acq_rel);
+			backIndex = previous & IndexMask;
+		}
+
+		//読み込み側: 前回から publish されていれば、その値を front に取り出して true を返す
+		bool update()
+		{
+			if ((middle.load(std::memory_order_relaxed) & FreshBit) == 0)
+			{
+				return false;
+			}
+
+			const std::uint8_t previous = middle.exchange(frontIndex, std::memory_order_acq_rel);
+			frontIndex = previous & IndexMask;
+			return true;
+		}
+
+		//読み込み側: 最後に update で取り出した値
+		const T& front()const
+		{
+			return slots[frontIndex];
+		}
+
+	private:
+		static constexpr std::uint8_t IndexMask = 0x3;
+
+		//middle の値がまだ読まれていない
+		static constexpr std::uint8_t FreshBit = 0x4;
+
+		T slots[3];
+
+		//書き込み側と読み込み側が受け渡しに使う位置、下位2ビットが slots の位置
+		std::atomic<std::uint8_t> middle{ 1 };
+
+		//書き込み側だけが使う
+		std::uint8_t backIndex = 0;
+
+		//読み込み側だけが使う
+		std::uint8_t frontIndex = 2;
+	};
+}
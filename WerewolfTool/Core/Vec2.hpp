@@ -0,0 +1,44 @@
+﻿# pragma once
+# include <cmath>
+
+namespace core
+{
+	//描画ライブラリに依存しない2次元ベクトル
+	struct Vec2
+	{
+		double x = 0.0;
+		double y = 0.0;
+
+		constexpr Vec2() = default;
+		constexpr Vec2(double x, double y)
+			: x(x)
+			, y(y)
+		{}
+
+		constexpr Vec2 operator+(const Vec2& v)const { return { x + v.x, y + v.y }; }
+		constexpr Vec2 operator-(const Vec2& v)const { return { x - v.x, y - v.y }; }
+		constexpr Vec2 operator-()const { return { -x, -y }; }
+		constexpr Vec2 operator*(double s)const { return { x * s, y * s }; }
+		constexpr Vec2 operator/(double s)const { return { x / s, y / s }; }
+
+		constexpr Vec2& operator+=(const Vec2& v) { x += v.x; y += v.y; return *this; }
+		constexpr Vec2& operator-=(const Vec2& v) { x -= v.x; y -= v.y; return *this; }
+		constexpr Vec2& operator*=(double s) { x *= s; y *= s; return *this; }
+
+		constexpr bool operator==(const Vec2& v)const { return x == v.x && y == v.y; }
+		constexpr bool operator!=(const Vec2& v)const { return !(*this == v); }
+
+		constexpr double dot(const Vec2& v)const { return x * v.x + y * v.y; }
+		constexpr double cross(const Vec2& v)const { return x * v.y - y * v.x; }
+		constexpr double lengthSq()const { return dot(*this); }
+		double length()const { return std::sqrt(lengthSq()); }
+		double distanceFrom(const Vec2& v)const { return (v - *this).length(); }
+
+		static constexpr Vec2 Zero() { return {}; }
+	};
+
+	constexpr Vec2 operator*(double s, const Vec2& v)
+	{
+		return v * s;
+	}
+}
@@ -0,0 +1,143 @@
+﻿# pragma once
+# include <atomic>
+# include <condition_variable>
+# include <cstddef>
+# include <deque>
+# include <mutex>
+# include <vector>
+
+namespace core
+{
+	//実行中に新しいタスクが増える処理を、複数のスレッドで分け合うためのスレッドごとの両端キュー
+	//持ち主のスレッドは後ろに積んで後ろから取り(深さ優先で、キャッシュに残っているものから)
+	//自分のキューが空になったら、他のスレッドのキューの前から(分ける前の大きなタスクを)盗む
+	//
+	//	ThreadPool::parallelFor(threadCount, ...) の各タスクで、waitPop が false を返すまで waitPop と done を繰り返して使う
+	//	どこにもタスクが無いスレッドは、新しいタスクが積まれるか全て終わるまで眠る
+	template <class T>
+	class WorkStealingQueues
+	{
+	public:
+		explicit WorkStealingQueues(size_t threadCount)
+			: queues(threadCount)
+		{}
+
+		size_t threadCount()const
+		{
+			return queues.size();
+		}
+
+		void push(size_t thread, T task)
+		{
+			pending.fetch_add(1, std::memory_order_relaxed);
+			{
+				//取り出す側が減らすより先に増やしておく
+				std::lock_guard lock(queues[thread].mutex);
+				queued.fetch_add(1, std::memory_order_relaxed);
+				queues[thread].tasks.push_back(std::move(task));
+			}
+
+			//眠っているスレッドが空のキューを見てから眠るまでの間に積んだ場合も起こせるように、ロックを取ってから知らせる
+			{
+				std::lock_guard lock(idleMutex);
+			}
+			idleCondition.notify_one();
+		}
+
+		//自分のキューから取り、空なら他のスレッドから盗む、どこにも無ければ false
+		bool pop(size_t thread, T& task)
+		{
+			{
+				Queue& own = queues[thread];
+				std::lock_guard lock(own.mutex);
+				if (!own.tasks.empty())
+				{
+					task = std::move(own.tasks.back());
+					own.tasks.pop_back();
+					queued.fetch_sub(1, std::memory_order_relaxed);
+					return true;
+				}
+			}
+
+			for (size_t offset = 1; offset < queues.size(); ++offset)
+			{
+				Queue& victim = queues[(thread + offset) % queues.size()];
+				std::lock_guard lock(victim.mutex);
+				if (!victim.tasks.empty())
+				{
+					task = std::move(victim.tasks.front());
+					victim.tasks.pop_front();
+					queued.fetch_sub(1, std::memory_order_relaxed);
+					++stolen;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		//pop と同じだが、どこにも無ければ新しいタスクが積まれるまで眠る、全て終わっていれば false
+		bool waitPop(size_t thread, T& task)
+		{
+			for (;;)
+			{
+				if (pop(thread, task))
+				{
+					return true;
+				}
+
+				std::unique_lock lock(idleMutex);
+				idleCondition.wait(lock, [&] { return isFinished() || 0 < queued.load(std::memory_order_acquire); });
+				if (isFinished())
+				{
+					return false;
+				}
+			}
+		}
+
+		//pop で取り出したタスクが終わったら呼ぶ、タスクが積んだ子のタスクは先に push しておくこと
+		void done()
+		{
+			if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			{
+				//眠っているスレッドを全て起こして終わらせる
+				{
+					std::lock_guard lock(idleMutex);
+				}
+				idleCondition.notify_all();
+			}
+		}
+
+		//積まれたタスクが全て終わったか
+		bool isFinished()const
+		{
+			return pending.load(std::memory_order_acquire) == 0;
+		}
+
+		//他のスレッドから盗んだ回数
+		size_t stolenCount()const
+		{
+			return stolen.load(std::memory_order_relaxed);
+		}
+
+	private:
+		//隣のキューと同じキャッシュラインに載らないように離す
+		struct alignas(64) Queue
+		{
+			std::mutex mutex;
+			std::deque<T> tasks;
+		};
+
+		std::vector<Queue> queues;
+
+		//積まれてまだ終わっていないタスクの数
+		std::atomic<size_t> pending{ 0 };
+
+		//積まれてまだ取り出されていないタスクの数
+		std::atomic<size_t> queued{ 0 };
+
+		std::atomic<size_t> stolen{ 0 };
+
+		std::mutex idleMutex;
+		std::condition_variable idleCondition;
+	};
+}
@@ -0,0 +1,67 @@
+﻿# include "LabelCache.hpp"
+
+size_t LabelCache::KeyHash::operator()(const Key& key)const
+{
+	size_t hash = std::hash<std::u32string_view>()(std::u32string_view(key.text.data(), key.text.size()));
+	hash ^= (static_cast<size_t>(key.fontID) * 0x9E3779B9u) + (static_cast<size_t>(key.color) << 1) + (key.hasShadow ? 1 : 0);
+	return hash;
+}
+
+TextureRegion LabelCache::get(const Font& font, const String& text, const ColorF& color, bool hasShadow)
+{
+	const Key key{ static_cast<uint64>(font.id().value()), text, Color(color).asUint32(), hasShadow };
+
+	auto it = regions.find(key);
+	if (it == regions.end())
+	{
+		const DrawableText drawable = font(text);
+		//端が切れないように1ピクセル広く取る
+		const Size textSize = drawable.region().size.asPoint() + Size(1, 1);
+		const Size size = hasShadow ? textSize + Size(ShadowX, ShadowY) : textSize;
+		const Entry entry = allocate(size);
+
+		{
+			//透明なテクスチャに描くので、アルファは大きい方を残す
+			const ScopedRenderTarget2D target(pages[entry.page]);
+			const ScopedRenderStates2D blend(BlendState::MaxAlpha);
+			if (hasShadow)
+			{
+				drawable.draw(entry.rect.pos + Vec2(ShadowX, ShadowY), Palette::Black);
+			}
+			drawable.draw(entry.rect.pos, color);
+		}
+
+		it = regions.emplace(key, entry).first;
+	}
+
+	return pages[it->second.page](it->second.rect);
+}
+
+void LabelCache::clear()
+{
+	regions.clear();
+	pages.clear();
+	cursor = Point(0, 0);
+	shelfHeight = 0;
+}
+
+LabelCache::Entry LabelCache::allocate(const Size& size)
+{
+	if (PageSize < cursor.x + size.x)
+	{
+		cursor = Point(0, cursor.y + shelfHeight);
+		shelfHeight = 0;
+	}
+
+	if (pages.empty() || PageSize < cursor.y + size.y)
+	{
+		pages.emplace_back(Size(PageSize, PageSize), ColorF(0.0, 0.0, 0.0, 0.0));
+		cursor = Point(0, 0);
+		shelfHeight = 0;
+	}
+
+	const Entry entry{ pages.size() - 1, RectF(cursor, size) };
+	cursor.x += size.x;
+	shelfHeight = std::max(shelfHeight, size.y);
+	return entry;
+}
@@ -0,0 +1,67 @@
+﻿# pragma once
+# include <Siv3D.hpp>
+# include <unordered_map>
+
+//名前や死因の文字を一度だけテクスチャに描いておき、次からはそれを貼るだけにする
+//フォントから毎フレーム文字を組み立てずに済み、全ての文字が一つのテクスチャから描かれるので描画もまとまる
+//文字列、フォント、色、影の有無のどれかが変われば別の項目として描き直す
+class LabelCache
+{
+public:
+	LabelCache() = default;
+
+	//text を描いたテクスチャの範囲、hasShadow なら右下に黒い影を付ける
+	//初めての組み合わせのときだけテクスチャに描く
+	TextureRegion get(const Font& font, const String& text, const ColorF& color, bool hasShadow);
+
+	//全て描き直す
+	void clear();
+
+	//描いた文字列の数
+	size_t size()const
+	{
+		return regions.size();
+	}
+
+private:
+	struct Key
+	{
+		uint64 fontID;
+		String text;
+		uint32 color;
+		bool hasShadow;
+
+		bool operator==(const Key& other)const
+		{
+			return fontID == other.fontID && text == other.text && color == other.color && hasShadow == other.hasShadow;
+		}
+	};
+
+	struct KeyHash
+	{
+		size_t operator()(const Key& key)const;
+	};
+
+	struct Entry
+	{
+		size_t page;
+		RectF rect;
+	};
+
+	//1ページの大きさ
+	static constexpr int32 PageSize = 2048;
+
+	//影をずらす量
+	static constexpr int32 ShadowX = 1;
+	static constexpr int32 ShadowY = 2;
+
+	//size の場所を空ける、ページが足りなければ増やす
+	Entry allocate(const Size& size);
+
+	std::unordered_map<Key, Entry, KeyHash> regions;
+
+	//棚詰め: 左から順に並べ、入らなくなったら一段下の棚に移る
+	Array<RenderTexture> pages;
+	Point cursor{ 0, 0 };
+	int32 shelfHeight = 0;
+};
@@ -1,1011 +1,1742 @@
-﻿#include <Siv3D.hpp> // OpenSiv3D v0.6.3
-
-inline std::pair<Vec2, Vec2> FixedPosVel(const Vec2& pos, const Vec2& vel, const RectF& rect)
-{
-	if (rect.intersects(pos))
-	{
-		return { pos, vel };
-	}
-
-	const auto isOuter = [&](const Line& line)
-	{
-		return line.vector().cross(pos - line.begin) < 0.0;
-	};
-
-	const Line topLine(rect.tl(), rect.tr());
-	const Line rightLine(rect.tr(), rect.br());
-	const Line bottomLine(rect.br(), rect.bl());
-	const Line leftLine(rect.bl(), rect.tl());
-
-	const Line realTopLine(rect.tl(), rect.tr() + Vec2(1, 0));
-	const Line realRightLine(rect.tr() + Vec2(1, 0), rect.br() + Vec2(1, 1));
-	const Line realBottomLine(rect.br() + Vec2(1, 1), rect.bl() + Vec2(0, 1));
-	const Line realLeftLine(rect.bl() + Vec2(0, 1), rect.tl());
-
-	/*
-	0 | 1 | 2
-	---------
-	6 |   | 7
-	---------
-	5 | 4 | 3
-	*/
-
-	if (isOuter(topLine))
-	{
-		//case 0
-		if (isOuter(leftLine))return { rect.tl(), Vec2::Zero() };
-		//case 2
-		if (isOuter(rightLine))return { rect.tr(), Vec2::Zero() };
-		//case 1
-		return { realTopLine.closest(pos), Vec2(vel.x,0) };
-	}
-
-	if (isOuter(bottomLine))
-	{
-		//case 3
-		if (isOuter(rightLine))return { rect.br(), Vec2::Zero() };
-		//case 5
-		if (isOuter(leftLine))return { rect.bl(), Vec2::Zero() };
-		//case 4
-		return { realBottomLine.closest(pos), Vec2(vel.x,0) };
-	}
-
-	//case 6
-	if (isOuter(leftLine))return { realLeftLine.closest(pos), Vec2(0,vel.y) };
-	//case 7
-	return { realRightLine.closest(pos), Vec2(0,vel.y) };
-};
-
-inline Vec2 FixedRectPos(const RectF& rect, const RectF& scope)
-{
-	if (scope.contains(rect))
-	{
-		return rect.pos;
-	}
-
-	const Vec2 fixVecBL = FixedPosVel(rect.bl(), Vec2::Zero(), scope).first - rect.bl();
-	const auto blFixedRect = rect.movedBy(fixVecBL);
-	if (scope.contains(blFixedRect))
-	{
-		return blFixedRect.pos;
-	}
-
-	const Vec2 fixVecTR = FixedPosVel(rect.tr(), Vec2::Zero(), scope).first - rect.tr();
-	const auto trFixedRect = rect.movedBy(fixVecTR);
-	if (scope.contains(trFixedRect))
-	{
-		return trFixedRect.pos;
-	}
-
-	const Vec2 fixVecBR = FixedPosVel(rect.br(), Vec2::Zero(), scope).first - rect.br();
-	return rect.movedBy(fixVecBR).pos;
-}
-
-inline Optional<Line> CutoffLine(const Line& original, double lengthBegin, double lengthEnd)
-{
-	const Vec2 v = original.vector().normalize();
-	const double l = lengthBegin + lengthEnd;
-	if (original.lengthSq() < l * l)
-	{
-		return none;
-	}
-	return Line(original.begin + v * lengthBegin, original.end - v * lengthEnd);
-};
-
-inline void DrawBR(const Vec2& bottomRight, const DrawableText& str, const Color& color = Palette::White)
-{
-	str.draw(bottomRight - str.region().size, color);
-};
-
-struct Character
-{
-	Character() = default;
-	Character(const String& name, const Texture& texture, const Vec2& pos, bool isActive = false)
-		: name(name)
-		, texture(texture)
-		, position(position)
-		, isActive(isActive)
-	{}
-
-	virtual void draw(const Font& font, const Font& fontDeathCause, const Color& overlayColor = Alpha(0))const
-	{
-		texture.drawAt(position).draw(overlayColor);
-		font(name).draw(position - texture.size() * 0.5 + Vec2(1, 2), Palette::Black);
-		font(name).draw(position - texture.size() * 0.5, isActive ? Palette::Red : Palette::White);
-	}
-
-	RectF rect()const
-	{
-		return RectF(texture.size()).setCenter(position);
-	}
-
-	String name;
-	Texture texture;
-	Vec2 position;
-	bool isActive;
-};
-
-struct CharacterNode : public Character
-{
-	CharacterNode() = default;
-
-	CharacterNode(const String& name, const Texture& texture, const Vec2& pos, bool isActive = false)
-		: Character(name, texture, pos, isActive)
-	{
-		initRadius();
-	}
-
-	CharacterNode(const Character& character)
-		: Character(character)
-	{
-		initRadius();
-	}
-
-	void initRadius()
-	{
-		radius = 0.5 * sqrt(texture.width() * texture.width() + texture.height() * texture.height());
-	}
-
-	void draw(const Font& font, const Font& fontDeathCause, const Color& overlayColor = Alpha(0))const override
-	{
-		if (state == Alive)
-		{
-			texture.drawAt(position).draw(overlayColor);
-		}
-		else
-		{
-			texture.drawAt(position).draw(Color(0, 0, 0, 180)).draw(overlayColor);
-
-			switch (state)
-			{
-			case CharacterNode::Hanged:
-				DrawBR(rect().br(), fontDeathCause(U"吊"), Palette::Red);
-				break;
-			case CharacterNode::Bitten:
-				DrawBR(rect().br(), fontDeathCause(U"噛"), Palette::Red);
-				break;
-			case CharacterNode::Suddenly:
-				DrawBR(rect().br(), fontDeathCause(U"突"), Palette::Red);
-				break;
-			default:
-				break;
-			}
-		}
-		font(name).draw(position - texture.size() * 0.5 + Vec2(1, 2), Palette::Black);
-		font(name).draw(position - texture.size() * 0.5, isActive ? Palette::Red : Palette::White);
-	}
-
-	RectF rect()const
-	{
-		return RectF(texture.size()).setCenter(position);
-	}
-
-	RectF getFieldScope()const
-	{
-		return Scene::Rect().stretched(-radius, -radius);
-	}
-
-	Color getColor()const
-	{
-		switch (co)
-		{
-		case CharacterNode::None:
-			return HSV(0, 0, 0.5);
-		case CharacterNode::Fortuneteller:
-			return HSV(200, 1, 1);
-		case CharacterNode::Spiritualist:
-			return HSV(300, 1, 1);
-		case CharacterNode::Hunter:
-			return HSV(90, 1, 1);
-		case CharacterNode::Madman:
-			return HSV(30, 1, 1);
-		default:
-			return HSV(0, 0, 0);
-		}
-	}
-
-	enum Roal { None, Fortuneteller, Spiritualist, Hunter, Madman };
-	enum State { Alive, Hanged, Bitten, Suddenly };
-
-	Vec2 velocity;
-	double radius;
-	Roal co = None;
-	bool isAutoLayout = true;
-	State state = Alive;
-};
-
-//256,384
-struct MenuGUI
-{
-	MenuGUI() = default;
-	MenuGUI(int nodeIndex, const Vec2& pos)
-		: nodeIndex(nodeIndex)
-		, guiPos(FixedRectPos(RectF(pos, 256, 384), Scene::Rect()))
-	{}
-
-	int nodeIndex;
-	Vec2 guiPos;
-
-	RectF guiRect()const
-	{
-		return RectF(guiPos, 256, 384);
-	}
-
-	RectF buttonFortuneteller()const
-	{
-		return RectF(3, 3, 122, 122).moveBy(guiPos);
-	}
-	RectF buttonSpiritualist()const
-	{
-		return RectF(131, 3, 122, 122).moveBy(guiPos);
-	}
-	RectF buttonHunter()const
-	{
-		return RectF(3, 131, 122, 122).moveBy(guiPos);
-	}
-	RectF buttonMadman()const
-	{
-		return RectF(131, 131, 122, 122).moveBy(guiPos);
-	}
-	RectF buttonFixPos()const
-	{
-		return RectF(3, 259, 122, 122).moveBy(guiPos);
-	}
-
-	RectF buttonHang()const
-	{
-		return RectF(130, 258, 60, 60).moveBy(guiPos);
-	}
-	RectF buttonBite()const
-	{
-		return RectF(194, 258, 60, 60).moveBy(guiPos);
-	}
-	RectF buttonSudden()const
-	{
-		return RectF(130, 322, 60, 60).moveBy(guiPos);
-	}
-
-	std::vector<RectF> buttonsRects()const
-	{
-		return {
-			buttonFortuneteller(),
-			buttonSpiritualist(),
-			buttonHunter(),
-			buttonMadman(),
-			buttonFixPos(),
-			buttonHang(),
-			buttonBite(),
-			buttonSudden()
-		};
-	}
-
-	void update(std::vector<CharacterNode>& nodes)
-	{
-		CharacterNode& node = nodes[nodeIndex];
-
-		const auto updateCO = [&](CharacterNode::Roal roal)
-		{
-			//node.co = node.co == roal ? CharacterNode::None : roal;
-			if (node.co == roal)
-			{
-				node.co = CharacterNode::None;
-				//node.isAutoLayout = false;
-			}
-			else
-			{
-				node.co = roal;
-				//node.isAutoLayout = true;
-			}
-		};
-
-		const auto updateState = [&](CharacterNode::State state)
-		{
-			node.state = node.state == state ? CharacterNode::Alive : state;
-		};
-
-		if (buttonFortuneteller().leftClicked())
-		{
-			updateCO(CharacterNode::Fortuneteller);
-		}
-		else if (buttonSpiritualist().leftClicked())
-		{
-			updateCO(CharacterNode::Spiritualist);
-		}
-		else if (buttonHunter().leftClicked())
-		{
-			updateCO(CharacterNode::Hunter);
-		}
-		else if (buttonMadman().leftClicked())
-		{
-			updateCO(CharacterNode::Madman);
-		}
-		else if (buttonFixPos().leftClicked())
-		{
-			node.isAutoLayout = !node.isAutoLayout;
-		}
-		else if (buttonHang().leftClicked())
-		{
-			updateState(CharacterNode::State::Hanged);
-		}
-		else if (buttonBite().leftClicked())
-		{
-			updateState(CharacterNode::State::Bitten);
-		}
-		else if (buttonSudden().leftClicked())
-		{
-			updateState(CharacterNode::State::Suddenly);
-		}
-	}
-
-	void draw(const Texture& texture, const std::vector<CharacterNode>& nodes)const
-	{
-		texture.draw(guiPos);
-
-		const CharacterNode& node = nodes[nodeIndex];
-
-		Graphics3D::Internal::SetBlendState(BlendState::Additive);
-
-		const auto currentRoalColor = node.getColor().setA(64);
-		switch (node.co)
-		{
-		case CharacterNode::Fortuneteller:
-			buttonFortuneteller().draw(currentRoalColor);
-			break;
-		case CharacterNode::Spiritualist:
-			buttonSpiritualist().draw(currentRoalColor);
-			break;
-		case CharacterNode::Hunter:
-			buttonHunter().draw(currentRoalColor);
-			break;
-		case CharacterNode::Madman:
-			buttonMadman().draw(currentRoalColor);
-			break;
-		default:
-			break;
-		}
-
-		if (node.isAutoLayout)
-		{
-			buttonFixPos().draw(HSV(30, 1, 1).toColor(64));
-		}
-
-		switch (node.state)
-		{
-		case CharacterNode::State::Hanged:
-			buttonHang().draw(HSV(0, 1, 1).toColor(64));
-			break;
-		case CharacterNode::State::Bitten:
-			buttonBite().draw(HSV(0, 1, 1).toColor(64));
-			break;
-		case CharacterNode::State::Suddenly:
-			buttonSudden().draw(HSV(0, 1, 1).toColor(64));
-			break;
-		default:
-			break;
-		}
-
-		for (const auto& buttonRect : buttonsRects())
-		{
-			if (buttonRect.mouseOver())
-			{
-				buttonRect.draw(Alpha(32));
-			}
-		}
-
-		Graphics3D::Internal::SetBlendState(BlendState::Default2D);
-
-		node.texture.scaled(30.0 / node.texture.width(), 30.0 / node.texture.height()).draw(guiPos + Vec2(224, 352));
-	}
-};
-
-//参考資料: http://asus.myds.me:6543/paper/nw/Efficient,%20High-QualityForce-Directed%20GraphDrawing.pdf
-class Graph
-{
-public:
-	Graph() = default;
-	Graph(const std::vector<CharacterNode>& nodes)
-		: adjacents(nodes.size(), std::vector<char>(nodes.size(), 0))
-		, menuTexture(U"Resource/gui.png")
-	{}
-
-	void initialize(const std::vector<CharacterNode>& nodes)
-	{
-		adjacents = std::vector<std::vector<char>>(nodes.size(), std::vector<char>(nodes.size(), 0));
-		menuTexture = Texture(U"Resource/gui.png");
-		linkBeginIndex = none;
-		moveIndex = none;
-		characterGUI = none;
-
-		continueSimulation = true;
-	}
-
-	void setLink(int indexFrom, int indexTo, char isEnabled)
-	{
-		adjacents[indexFrom][indexTo] = isEnabled;
-	}
-
-	void update(std::vector<CharacterNode>& nodes)
-	{
-		for (auto i : step(nodes.size()))
-		{
-			//NaN対策：二つのノードが完全に重なったとき反発力がNaNになる
-			//二つのノードが完全に重なることは基本無いがFixedPosVelで位置が四隅に補正された場合はあり得る
-			if (nodes[i].position != nodes[i].position || nodes[i].velocity != nodes[i].velocity)
-			{
-				auto posVel = FixedPosVel(RandomVec2(Scene::Rect()), Vec2::Zero(), Scene::Rect());
-				nodes[i].position = posVel.first;
-				nodes[i].velocity = Vec2::Zero();
-			}
-		}
-
-		inputsUpdate(nodes);
-		physicsUpdate(nodes);
-	}
-
-	void draw(const std::vector<CharacterNode>& nodes, const Font& characterNameFont, const Font& characterDeathCauseFont)const
-	{
-		for (auto i : step(nodes.size()))
-		{
-			const Circle circle(nodes[i].position, nodes[i].radius);
-			circle.drawFrame(5.0, 0.0, nodes[i].getColor());
-			nodes[i].draw(characterNameFont, characterDeathCauseFont);
-		}
-
-		//リンクの描画;
-		for (int me = 0; me < nodes.size(); ++me)
-		{
-			for (int other = 0; other < nodes.size(); ++other)
-			{
-				if (me == other)
-				{
-					continue;
-				}
-
-				if (adjacents[me][other] != 0)
-				{
-					const auto color = adjacents[me][other] == 1 ? Palette::White : Palette::Black;
-					if (auto arrow = CutoffLine(Line(nodes[me].position, nodes[other].position), nodes[me].radius, nodes[other].radius))
-					{
-						arrow.value().drawArrow(3.0, { 20,20 }, color);
-					}
-
-				}
-			}
-		}
-
-		if (linkBeginIndex && !Circle(nodes[linkBeginIndex.value()].position, nodes[linkBeginIndex.value()].radius).mouseOver())
-		{
-			if (auto arrow = CutoffLine(Line(nodes[linkBeginIndex.value()].position, Cursor::PosF()), nodes[linkBeginIndex.value()].radius, 0))
-			{
-				arrow.value().drawArrow(3.0, { 15,15 }, Alpha(128));
-			}
-		}
-
-		if (characterGUI)
-		{
-			characterGUI.value().draw(menuTexture, nodes);
-		}
-
-		if (linkEraseBegin)
-		{
-			Line(linkEraseBegin.value(), Cursor::PosF()).draw(3.0, Color(255, 0, 0, 128));
-		}
-	}
-
-private:
-	void inputsUpdate(std::vector<CharacterNode>& nodes)
-	{
-		if (!linkBeginIndex && !moveIndex && !characterGUI && !linkEraseBegin)
-		{
-			for (int i : step(nodes.size()))
-			{
-				const int index = nodes.size() - 1 - i;
-				const Circle circle(nodes[index].position, nodes[index].radius);
-				if (circle.rightClicked())
-				{
-					moveIndex = index;
-					break;
-				}
-				if (circle.leftClicked())
-				{
-					linkBeginIndex = index;
-					break;
-				}
-			}
-
-			if (MouseL.down() && !moveIndex && !linkBeginIndex)
-			{
-				linkEraseBegin = Cursor::PosF();
-			}
-		}
-		else if (moveIndex)
-		{
-			if (MouseR.pressed())
-			{
-				nodes[moveIndex.value()].position = FixedPosVel(Cursor::PosF(), Vec2::Zero(), nodes[moveIndex.value()].getFieldScope()).first;
-			}
-			if (MouseR.up())
-			{
-				characterGUI = none;
-				moveIndex = none;
-				linkBeginIndex = none;
-				linkEraseBegin = none;
-			}
-		}
-		else if (linkBeginIndex)
-		{
-			if (MouseL.up())
-			{
-				Optional<int> linkEndIndex;
-				for (auto i : step(nodes.size()))
-				{
-					if (Circle(nodes[i].position, nodes[i].radius).mouseOver())
-					{
-						if (i == linkBeginIndex.value())
-						{
-							characterGUI = MenuGUI(i, Cursor::PosF());
-							break;
-						}
-						else
-						{
-							linkEndIndex = i;
-							break;
-						}
-					}
-				}
-
-				if (linkEndIndex)
-				{
-					const int color = KeyAlt.pressed() ? 2 : 1;
-					setLink(linkBeginIndex.value(), linkEndIndex.value(), color);
-				}
-
-				moveIndex = none;
-				linkBeginIndex = none;
-				linkEraseBegin = none;
-			}
-		}
-		else if (characterGUI)
-		{
-			characterGUI.value().update(nodes);
-			if (MouseL.down())
-			{
-				if (!characterGUI.value().guiRect().mouseOver())
-				{
-					characterGUI = none;
-					moveIndex = none;
-					linkBeginIndex = none;
-					linkEraseBegin = none;
-				}
-			}
-		}
-		else if (linkEraseBegin)
-		{
-			if (!MouseL.pressed())
-			{
-				const Line eracerLine(linkEraseBegin.value(), Cursor::PosF());
-
-				for (int me = 0; me < nodes.size(); ++me)
-				{
-					for (int other = 0; other < nodes.size(); ++other)
-					{
-						if (me == other)
-						{
-							continue;
-						}
-
-						if (adjacents[me][other] != 0)
-						{
-							if (auto arrow = CutoffLine(Line(nodes[me].position, nodes[other].position), nodes[me].radius, nodes[other].radius))
-							{
-								if (arrow.value().intersects(eracerLine))
-								{
-									setLink(me, other, 0);
-									setLink(other, me, 0);
-								}
-							}
-							//if (CutoffLine(Line(nodes[me].position, nodes[other].position), nodes[me].radius, nodes[other].radius).intersects(eracerLine))
-							//{
-							//	setLink(me, other, 0);
-							//	setLink(other, me, 0);
-							//}
-						}
-					}
-				}
-
-				characterGUI = none;
-				moveIndex = none;
-				linkBeginIndex = none;
-				linkEraseBegin = none;
-			}
-		}
-	}
-
-	void physicsUpdate(std::vector<CharacterNode>& nodes)
-	{
-		if (KeySpace.down())
-		{
-			continueSimulation = !continueSimulation;
-		}
-
-		if (!continueSimulation)
-		{
-			return;
-		}
-
-		const double naturalDistance = 300.0;
-		const double relativeStrength = 0.2;
-		//const double relativeStrength = 0.4;
-		//const double relativeStrength = 0.1;
-
-		//const double relativeStrength = 0.6;
-		//const double relativeStrength = 1.0;
-		//const double naturalDistance = 500.0;
-		//const double relativeStrength = 0.1;
-
-		const double K = naturalDistance;
-		const double K2 = K * K;
-		const double C = relativeStrength;
-
-		//const double dt = 0.0167;
-		const double dt = 0.005;
-
-		for (int i = 0; i < 10; ++i)
-		{
-			std::vector<Vec2> forces(nodes.size(), Vec2::Zero());
-			for (int me = 0; me < nodes.size(); ++me)
-			{
-				if (!nodes[me].isAutoLayout)
-				{
-					continue;
-				}
-
-				const Vec2 pos_me = nodes[me].position;
-				//forces[me] += pos_me.distanceFrom(Window::Center()) * (Window::Center() - pos_me) / K;
-				//散らばりすぎないように求心力も少し加える
-				forces[me] += 0.5 * pos_me.distanceFrom(Scene::Center()) * (Scene::Center() - pos_me) / K;
-
-				for (int other = 0; other < nodes.size(); ++other)
-				{
-					if (me == other)
-					{
-						continue;
-					}
-
-					const Vec2 pos_other = nodes[other].position;
-					const Vec2 relative = pos_other - pos_me;
-					const double distance2 = relative.dot(relative);
-					const double distance = sqrt(distance2);
-
-					//全ての頂点間の斥力
-					forces[me] += -C * K2 * relative / distance2;
-					/*if (1.e-6 < distance2)
-					{
-						forces[me] += -C * K2 * relative / distance2;
-					}
-					else
-					{
-						forces[me] += RandomVec2()*100;
-					}*/
-
-					//リンク間の引力
-					//運動方程式を解く時はリンクの向きは考慮しない
-					if (adjacents[me][other] != 0 || adjacents[other][me] != 0)
-					{
-						forces[me] += 0.175 * distance * relative / K;
-						//forces[me] += (distance - K) * relative;
-					}
-				}
-			}
-
-			for (int me = 0; me < nodes.size(); ++me)
-			{
-				if (!nodes[me].isAutoLayout)
-				{
-					nodes[me].velocity = Vec2::Zero();
-					continue;
-				}
-
-				//const double resistance = 0.999;
-				const double resistance = 0.995;
-
-				auto posVel = FixedPosVel(nodes[me].position + nodes[me].velocity * dt, nodes[me].velocity + forces[me] * dt, nodes[me].getFieldScope());
-				nodes[me].position = posVel.first;
-				nodes[me].velocity = posVel.second * resistance;
-			}
-		}
-	}
-
-	//0: リンクなし, 1:白出し, 2:黒出し
-	std::vector<std::vector<char>> adjacents;
-
-	Optional<Vec2> linkEraseBegin;
-	Optional<int> linkBeginIndex;
-	Optional<int> moveIndex;
-	Optional<MenuGUI> characterGUI;
-
-	Texture menuTexture;
-	bool continueSimulation = true;
-};
-
-class Game
-{
-public:
-	Game(const std::vector<FilePath>& characterImagePaths, const std::vector<FilePath>& characterImagePaths2)
-		: characterNameFont(14, Typeface::Heavy)
-		, systemFont(32)
-		, characterDeathCauseFont(32)
-	{
-		{
-			Image image(U"Resource/gui2.png");
-			image.scale(LoadResolution().x, LoadResolution().y);
-			characterHideTexture = Texture(image);
-		}
-
-		for (const auto& path : characterImagePaths)
-		{
-			Image image(path);
-			image.scale(LoadResolution().x, LoadResolution().y);
-			characterTemplates.emplace_back(FileSystem::BaseName(path), Texture(image), RandomVec2(Scene::Rect()));
-		}
-
-		for (const auto& path : characterImagePaths2)
-		{
-			Image image(path);
-			image.scale(LoadResolution().x, LoadResolution().y);
-			characterTemplates2.emplace_back(FileSystem::BaseName(path), Texture(image), RandomVec2(Scene::Rect()));
-		}
-
-		std::sort(characterTemplates.begin(), characterTemplates.end(), [](const Character& a, const Character& b) {return a.name < b.name; });
-		std::sort(characterTemplates2.begin(), characterTemplates2.end(), [](const Character& a, const Character& b) {return a.name < b.name; });
-
-		restart();
-	}
-
-	void restart()
-	{
-		state = Initial;
-		characters.clear();
-		characterHideButton = none;
-		showCharacter2 = false;
-	}
-
-	void update()
-	{
-		if (state == Initial)
-		{
-			const int horizontalNum = Scene::Width() / LoadResolution().x;
-
-			{
-				size_t i = 0;
-				const Vec2 w = LoadResolution();
-
-				for (; i < characterTemplates.size(); ++i)
-				{
-					const int x = i % horizontalNum;
-					const int y = i / horizontalNum;
-					characterTemplates[i].position = w * Vec2(x, y) + w * 0.5;
-				}
-
-				if (!characterTemplates2.empty())
-				{
-					characterHideButton = RectF(w * Vec2(i % horizontalNum, i / horizontalNum), w);
-					for (++i; i < 1 + characterTemplates.size() + characterTemplates2.size(); ++i)
-					{
-						const int x = i % horizontalNum;
-						const int y = i / horizontalNum;
-						characterTemplates2[i - 1 - characterTemplates.size()].position = w * Vec2(x, y) + w * 0.5;
-					}
-				}
-			}
-
-			for (auto& character : characterTemplates)
-			{
-				if (character.rect().leftClicked())
-				{
-					character.isActive = !character.isActive;
-				}
-			}
-
-			if (characterHideButton)
-			{
-				if (characterHideButton.value().leftClicked())
-				{
-					showCharacter2 = !showCharacter2;
-				}
-			}
-
-			if (showCharacter2)
-			{
-				for (auto& character : characterTemplates2)
-				{
-					if (character.rect().leftClicked())
-					{
-						character.isActive = !character.isActive;
-					}
-				}
-			}
-
-			if (KeyEnter.down())
-			{
-				//state = Select;
-
-				characters.clear();
-				for (const auto& characterTemplate : characterTemplates)
-				{
-					if (characterTemplate.isActive)
-					{
-						characters.push_back(characterTemplate);
-					}
-				}
-				for (const auto& characterTemplate : characterTemplates2)
-				{
-					if (characterTemplate.isActive)
-					{
-						characters.push_back(characterTemplate);
-					}
-				}
-				for (int j = 0; j < characters.size(); ++j)
-				{
-					characters[j].isActive = false;
-				}
-				graph.initialize(characters);
-
-				state = Update;
-			}
-		}
-		else if (state == Select)
-		{
-			int realIndex = 0;
-
-			const auto switchToUpdate = [&]()
-			{
-				characters.clear();
-				for (const auto& characterTemplate : characterTemplates)
-				{
-					if (characterTemplate.isActive)
-					{
-						characters.push_back(characterTemplate);
-					}
-				}
-				for (const auto& characterTemplate : characterTemplates2)
-				{
-					if (characterTemplate.isActive)
-					{
-						characters.push_back(characterTemplate);
-					}
-				}
-				for (int j = 0; j < characters.size(); ++j)
-				{
-					characters[j].isActive = (j == realIndex ? true : false);
-				}
-				myselfIndex = realIndex;
-				state = Update;
-				graph.initialize(characters);
-			};
-
-			for (int i = 0; i < characterTemplates.size(); ++i)
-			{
-				if (characterTemplates[i].isActive)
-				{
-					if (characterTemplates[i].rect().leftClicked())
-					{
-						switchToUpdate();
-						break;
-					}
-
-					++realIndex;
-				}
-			}
-			for (int i = 0; i < characterTemplates2.size(); ++i)
-			{
-				if (characterTemplates2[i].isActive)
-				{
-					if (characterTemplates2[i].rect().leftClicked())
-					{
-						switchToUpdate();
-						break;
-					}
-
-					++realIndex;
-				}
-			}
-		}
-		else if (state == Update)
-		{
-			graph.update(characters);
-		}
-	}
-
-	void draw()const
-	{
-		if (state == Initial)
-		{
-			for (const auto& character : characterTemplates)
-			{
-				character.draw(characterNameFont, characterDeathCauseFont, character.rect().mouseOver() ? Alpha(0) : Color(0, 0, 0, 160));
-			}
-
-			if (characterHideButton)
-			{
-				characterHideTexture.drawAt(characterHideButton.value().center()).draw(characterHideButton.value().mouseOver() ? Alpha(0) : Color(0, 0, 0, 160));
-			}
-
-			if (showCharacter2)
-			{
-				for (const auto& character : characterTemplates2)
-				{
-					character.draw(characterNameFont, characterDeathCauseFont, character.rect().mouseOver() ? Alpha(0) : Color(0, 0, 0, 160));
-				}
-			}
-
-			const int population1 = std::count_if(characterTemplates.begin(), characterTemplates.end(), [](const Character& c) {return c.isActive; });
-			const int population2 = std::count_if(characterTemplates2.begin(), characterTemplates2.end(), [](const Character& c) {return c.isActive; });
-
-			DrawBR(Scene::Rect().br(), systemFont(Format(population1 + population2, U"人村(Enterでスタート)")));
-		}
-		else if (state == Select)
-		{
-			for (const auto& character : characterTemplates)
-			{
-				if (character.isActive)
-				{
-					character.draw(characterNameFont, characterDeathCauseFont, character.rect().mouseOver() ? Alpha(0) : Color(0, 0, 0, 160));
-				}
-			}
-
-			for (const auto& character : characterTemplates2)
-			{
-				if (character.isActive)
-				{
-					character.draw(characterNameFont, characterDeathCauseFont, character.rect().mouseOver() ? Alpha(0) : Color(0, 0, 0, 160));
-				}
-			}
-
-			DrawBR(Scene::Rect().br(), systemFont(Format(U"自キャラを選択")));
-		}
-		else if (state == Update)
-		{
-			graph.draw(characters, characterNameFont, characterDeathCauseFont);
-		}
-	}
-
-private:
-	static Size LoadResolution()
-	{
-		//return Size(128, 128);
-		return Size(100, 100);
-	}
-
-	enum State { Initial, Select, Update };
-	Font characterNameFont;
-	Font characterDeathCauseFont;
-	Font systemFont;
-	std::vector<Character> characterTemplates;
-	std::vector<Character> characterTemplates2;
-	std::vector<CharacterNode> characters;
-	Texture characterHideTexture;
-	Optional<RectF> characterHideButton;
-	bool showCharacter2 = false;
-	State state;
-	Graph graph;
-	int myselfIndex;
-};
-
-void Main()
-{
-	Window::SetTitle(U"人狼盤面整理ツール");
-	Scene::SetBackground(Color(73, 83, 94));
-	Window::Resize(1280, 720);
-
-	auto paths = FileSystem::DirectoryContents(U"キャラクター画像1");
-
-	auto paths2 = FileSystem::DirectoryContents(U"キャラクター画像2");
-
-	Game game(paths, paths2);
-	while (System::Update())
-	{
-		game.update();
-		game.draw();
-	}
-}
+﻿#include <Siv3D.hpp> // OpenSiv3D v0.6.3
+#include <fstream>
+#include "Core/BoardHistory.hpp"
+#include "Core/BoardSnapshot.hpp"
+#include "Core/FrameProfiler.hpp"
+#include "Core/Layout.hpp"
+#include "Core/LayoutThread.hpp"
+#include "Core/RoleEngine.hpp"
+#include "Core/SegmentGrid.hpp"
+#include "Core/SpatialGrid.hpp"
+#include "ArrowRenderer.hpp"
+#include "CharacterAtlas.hpp"
+#include "CharacterImageLoader.hpp"
+#include "LabelCache.hpp"
+
+//フレーム毎に測る処理の区間、並びは MakeProfiler に渡す名前と同じ
+namespace ProfilePhase
+{
+	enum : size_t { Update, Input, Physics, Arrows, Draw, Characters, Roles };
+}
+
+//フレーム毎に記録する数
+namespace ProfileCounter
+{
+	enum : size_t { Nodes, Edges, DrawCalls, Redrawn };
+}
+
+inline core::FrameProfiler MakeProfiler()
+{
+	return core::FrameProfiler({ "update", "input", "physics", "arrows", "draw", "characters", "roles" }, { "nodes", "edges", "draw_calls", "redrawn" });
+}
+
+inline core::Vec2 ToCore(const Vec2& v)
+{
+	return { v.x, v.y };
+}
+
+inline core::RectF ToCore(const RectF& rect)
+{
+	return { ToCore(rect.pos), ToCore(rect.size) };
+}
+
+inline core::Line ToCore(const Line& line)
+{
+	return { ToCore(line.begin), ToCore(line.end) };
+}
+
+inline Vec2 ToS3D(const core::Vec2& v)
+{
+	return { v.x, v.y };
+}
+
+inline Line ToS3D(const core::Line& line)
+{
+	return { ToS3D(line.begin), ToS3D(line.end) };
+}
+
+inline core::RectF SceneRect()
+{
+	return ToCore(RectF(Scene::Rect()));
+}
+
+inline void DrawBR(const Vec2& bottomRight, const DrawableText& str, const Color& color = Palette::White)
+{
+	str.draw(bottomRight - str.region().size, color);
+};
+
+inline void DrawBR(const Vec2& bottomRight, const TextureRegion& label)
+{
+	label.draw(bottomRight - label.size);
+};
+
+//CO した役職の本物の役職、CO していなければ none
+inline Optional<core::Role> ClaimedRole(core::Node::Roal co)
+{
+	switch (co)
+	{
+	case core::Node::Fortuneteller:
+		return core::Role::Seer;
+	case core::Node::Spiritualist:
+		return core::Role::Medium;
+	case core::Node::Hunter:
+		return core::Role::Hunter;
+	case core::Node::Madman:
+		return core::Role::Madman;
+	default:
+		return none;
+	}
+}
+
+//黒を alpha で重ねたのと同じ明るさになるように、画像に掛ける色
+//四角形を重ねて描かないので、画像の描画が途切れない
+inline ColorF Shade(int alpha)
+{
+	return ColorF(1.0 - alpha / 255.0, 1.0 - alpha / 255.0, 1.0 - alpha / 255.0);
+}
+
+struct Character
+{
+	Character() = default;
+	Character(const String& name, const CharacterAtlas::Region& region, const Vec2& pos, bool isActive = false)
+		: name(name)
+		, region(region)
+		, position(pos)
+		, isActive(isActive)
+	{}
+
+	void drawImage(const CharacterAtlas& atlas, const ColorF& tint = ColorF(1))const
+	{
+		atlas(region).drawAt(position, tint);
+	}
+
+	void drawName(LabelCache& labels, const Font& font)const
+	{
+		labels.get(font, name, isActive ? Palette::Red : Palette::White, true).draw(position - region.rect.size * 0.5);
+	}
+
+	RectF rect()const
+	{
+		return RectF(region.rect.size).setCenter(position);
+	}
+
+	String name;
+	CharacterAtlas::Region region;
+	Vec2 position;
+	bool isActive;
+};
+
+//盤面上のキャラクターの見た目
+//位置や役職などの状態は core::Node が持つ
+struct CharacterNode
+{
+	CharacterNode() = default;
+
+	CharacterNode(const Character& character)
+		: name(character.name)
+		, region(character.region)
+		, isActive(character.isActive)
+	{}
+
+	double radius()const
+	{
+		const Size size = region.rect.size;
+		return 0.5 * sqrt(size.x * size.x + size.y * size.y);
+	}
+
+	//死んだキャラクターは暗くして描く
+	void drawImage(const core::Node& node, const CharacterAtlas& atlas)const
+	{
+		atlas(region).drawAt(ToS3D(node.position), node.state == core::Node::Alive ? ColorF(1) : Shade(180));
+	}
+
+	void drawDeathCause(const core::Node& node, LabelCache& labels, const Font& fontDeathCause)const
+	{
+		switch (node.state)
+		{
+		case core::Node::Hanged:
+			DrawBR(rect(node).br(), labels.get(fontDeathCause, U"吊", Palette::Red, false));
+			break;
+		case core::Node::Bitten:
+			DrawBR(rect(node).br(), labels.get(fontDeathCause, U"噛", Palette::Red, false));
+			break;
+		case core::Node::Suddenly:
+			DrawBR(rect(node).br(), labels.get(fontDeathCause, U"突", Palette::Red, false));
+			break;
+		default:
+			break;
+		}
+	}
+
+	//矛盾しない割り当てのうち、人狼である割合と、COした役職の本物である割合を左下に描く
+	//半分以上の割り当てで人狼なら赤くする
+	void drawRoleProbability(const core::Node& node, LabelCache& labels, const Font& font, const core::RoleSolution& solution, size_t index)const
+	{
+		const auto percent = [&](core::Role role)
+		{
+			return static_cast<int32>(solution.probability(index, role) * 100.0 + 0.5);
+		};
+
+		const double werewolf = solution.probability(index, core::Role::Werewolf);
+		const auto wolfLabel = labels.get(font, Format(U"狼", percent(core::Role::Werewolf), U"%"), 0.5 <= werewolf ? Palette::Red : Palette::White, true);
+		Vec2 pos = rect(node).bl() - Vec2(0, wolfLabel.size.y);
+		wolfLabel.draw(pos);
+
+		if (const auto claimed = ClaimedRole(node.co))
+		{
+			const auto genuineLabel = labels.get(font, Format(U"真", percent(claimed.value()), U"%"), Palette::White, true);
+			pos.y -= genuineLabel.size.y;
+			genuineLabel.draw(pos);
+		}
+	}
+
+	void drawName(const core::Node& node, LabelCache& labels, const Font& font)const
+	{
+		labels.get(font, name, isActive ? Palette::Red : Palette::White, true).draw(ToS3D(node.position) - region.rect.size * 0.5);
+	}
+
+	RectF rect(const core::Node& node)const
+	{
+		return RectF(region.rect.size).setCenter(ToS3D(node.position));
+	}
+
+	static Color GetColor(core::Node::Roal co)
+	{
+		switch (co)
+		{
+		case core::Node::None:
+			return HSV(0, 0, 0.5);
+		case core::Node::Fortuneteller:
+			return HSV(200, 1, 1);
+		case core::Node::Spiritualist:
+			return HSV(300, 1, 1);
+		case core::Node::Hunter:
+			return HSV(90, 1, 1);
+		case core::Node::Madman:
+			return HSV(30, 1, 1);
+		default:
+			return HSV(0, 0, 0);
+		}
+	}
+
+	String name;
+	CharacterAtlas::Region region;
+	bool isActive = false;
+};
+
+//見た目が変わらないフレームは描き直さず、前に描いた画面を貼るだけにする
+class FrameCache
+{
+public:
+	//isChanged か画面の大きさが変わったときだけ draw で描き直す
+	template <class Draw>
+	void render(bool isChanged, Draw draw)
+	{
+		if (texture.size() != Scene::Size())
+		{
+			texture = MSRenderTexture(Scene::Size());
+			isChanged = true;
+		}
+
+		if (isChanged)
+		{
+			texture.clear(Scene::GetBackground());
+			{
+				const ScopedRenderTarget2D target(texture);
+				draw();
+			}
+			Graphics2D::Flush();
+			texture.resolve();
+			++renderedCount;
+		}
+		else
+		{
+			++skippedCount;
+		}
+
+		texture.draw();
+	}
+
+	size_t renderedFrames()const
+	{
+		return renderedCount;
+	}
+
+	//描き直さずに済んだフレームの数
+	size_t skippedFrames()const
+	{
+		return skippedCount;
+	}
+
+private:
+	MSRenderTexture texture;
+	size_t renderedCount = 0;
+	size_t skippedCount = 0;
+};
+
+//256,384
+struct MenuGUI
+{
+	MenuGUI() = default;
+	MenuGUI(int nodeIndex, const Vec2& pos)
+		: nodeIndex(nodeIndex)
+		, guiPos(ToS3D(core::FixedRectPos(ToCore(RectF(pos, 256, 384)), SceneRect())))
+	{}
+
+	int nodeIndex;
+	Vec2 guiPos;
+
+	RectF guiRect()const
+	{
+		return RectF(guiPos, 256, 384);
+	}
+
+	RectF buttonFortuneteller()const
+	{
+		return RectF(3, 3, 122, 122).moveBy(guiPos);
+	}
+	RectF buttonSpiritualist()const
+	{
+		return RectF(131, 3, 122, 122).moveBy(guiPos);
+	}
+	RectF buttonHunter()const
+	{
+		return RectF(3, 131, 122, 122).moveBy(guiPos);
+	}
+	RectF buttonMadman()const
+	{
+		return RectF(131, 131, 122, 122).moveBy(guiPos);
+	}
+	RectF buttonFixPos()const
+	{
+		return RectF(3, 259, 122, 122).moveBy(guiPos);
+	}
+
+	RectF buttonHang()const
+	{
+		return RectF(130, 258, 60, 60).moveBy(guiPos);
+	}
+	RectF buttonBite()const
+	{
+		return RectF(194, 258, 60, 60).moveBy(guiPos);
+	}
+	RectF buttonSudden()const
+	{
+		return RectF(130, 322, 60, 60).moveBy(guiPos);
+	}
+
+	std::vector<RectF> buttonsRects()const
+	{
+		return {
+			buttonFortuneteller(),
+			buttonSpiritualist(),
+			buttonHunter(),
+			buttonMadman(),
+			buttonFixPos(),
+			buttonHang(),
+			buttonBite(),
+			buttonSudden()
+		};
+	}
+
+	//レイアウトが変わる操作(位置の固定の切り替え)をしたら true を返す
+	bool update(std::vector<core::Node>& nodes)
+	{
+		core::Node& node = nodes[nodeIndex];
+
+		const auto updateCO = [&](core::Node::Roal roal)
+		{
+			//node.co = node.co == roal ? core::Node::None : roal;
+			if (node.co == roal)
+			{
+				node.co = core::Node::None;
+				//node.isAutoLayout = false;
+			}
+			else
+			{
+				node.co = roal;
+				//node.isAutoLayout = true;
+			}
+		};
+
+		const auto updateState = [&](core::Node::State state)
+		{
+			node.state = node.state == state ? core::Node::Alive : state;
+		};
+
+		if (buttonFortuneteller().leftClicked())
+		{
+			updateCO(core::Node::Fortuneteller);
+		}
+		else if (buttonSpiritualist().leftClicked())
+		{
+			updateCO(core::Node::Spiritualist);
+		}
+		else if (buttonHunter().leftClicked())
+		{
+			updateCO(core::Node::Hunter);
+		}
+		else if (buttonMadman().leftClicked())
+		{
+			updateCO(core::Node::Madman);
+		}
+		else if (buttonFixPos().leftClicked())
+		{
+			node.isAutoLayout = !node.isAutoLayout;
+			return true;
+		}
+		else if (buttonHang().leftClicked())
+		{
+			updateState(core::Node::State::Hanged);
+		}
+		else if (buttonBite().leftClicked())
+		{
+			updateState(core::Node::State::Bitten);
+		}
+		else if (buttonSudden().leftClicked())
+		{
+			updateState(core::Node::State::Suddenly);
+		}
+
+		return false;
+	}
+
+	void draw(const Texture& texture, const CharacterAtlas& atlas, const std::vector<CharacterNode>& characters, const std::vector<core::Node>& nodes)const
+	{
+		texture.draw(guiPos);
+
+		const core::Node& node = nodes[nodeIndex];
+
+		Graphics3D::Internal::SetBlendState(BlendState::Additive);
+
+		const auto currentRoalColor = CharacterNode::GetColor(node.co).setA(64);
+		switch (node.co)
+		{
+		case core::Node::Fortuneteller:
+			buttonFortuneteller().draw(currentRoalColor);
+			break;
+		case core::Node::Spiritualist:
+			buttonSpiritualist().draw(currentRoalColor);
+			break;
+		case core::Node::Hunter:
+			buttonHunter().draw(currentRoalColor);
+			break;
+		case core::Node::Madman:
+			buttonMadman().draw(currentRoalColor);
+			break;
+		default:
+			break;
+		}
+
+		if (node.isAutoLayout)
+		{
+			buttonFixPos().draw(HSV(30, 1, 1).toColor(64));
+		}
+
+		switch (node.state)
+		{
+		case core::Node::State::Hanged:
+			buttonHang().draw(HSV(0, 1, 1).toColor(64));
+			break;
+		case core::Node::State::Bitten:
+			buttonBite().draw(HSV(0, 1, 1).toColor(64));
+			break;
+		case core::Node::State::Suddenly:
+			buttonSudden().draw(HSV(0, 1, 1).toColor(64));
+			break;
+		default:
+			break;
+		}
+
+		for (const auto& buttonRect : buttonsRects())
+		{
+			if (buttonRect.mouseOver())
+			{
+				buttonRect.draw(Alpha(32));
+			}
+		}
+
+		Graphics3D::Internal::SetBlendState(BlendState::Default2D);
+
+		atlas(characters[nodeIndex].region).resized(30, 30).draw(guiPos + Vec2(224, 352));
+	}
+};
+
+//盤面の入力と描画
+//レイアウト計算は core::LayoutThread が別のスレッドで行い、ここでは公開された位置を受け取るだけにする
+class Graph
+{
+public:
+	Graph() = default;
+
+	void initialize(const std::vector<Character>& characters)
+	{
+		std::vector<core::Node> boardNodes;
+		for (const auto& character : characters)
+		{
+			core::Node node;
+			node.position = ToCore(character.position);
+			node.radius = CharacterNode(character).radius();
+			boardNodes.push_back(node);
+		}
+
+		start(characters, core::Board(std::move(boardNodes)));
+		relayout();
+	}
+
+	//保存しておいた盤面から続ける、characters は savedBoard.nodes と同じ順
+	//位置は保存したときのままにして、配置し直さない
+	void restore(const std::vector<Character>& characters, core::Board savedBoard)
+	{
+		start(characters, std::move(savedBoard));
+	}
+
+	//盤面をスナップショットに保存する、キャラクターは画像のファイル名で記録する
+	bool saveSnapshot(const FilePath& path)const
+	{
+		std::vector<std::string> roster;
+		for (const auto& node : nodes)
+		{
+			roster.push_back(Unicode::ToUTF8(node.name));
+		}
+		return core::SaveBoardSnapshot(Unicode::ToWstring(path), board, roster);
+	}
+
+	//多段階法で盤面全体を配置し直す
+	void relayout()
+	{
+		simulation->send(core::LayoutThread::Relayout{});
+	}
+
+	void setLink(int indexFrom, int indexTo, char isEnabled)
+	{
+		if (board.link(indexFrom, indexTo) != isEnabled)
+		{
+			history.record(core::BoardEdit::LinkEdit(indexFrom, indexTo, board.link(indexFrom, indexTo), isEnabled));
+			board.setLink(indexFrom, indexTo, isEnabled);
+			edgeGridLinksChanged = true;
+			rolesChanged = true;
+
+			//リンク一本の変更では、両端の周りだけを動かす(LayoutThread が Layout::wakeAround を呼ぶ)
+			simulation->send(core::LayoutThread::SetLink{ indexFrom, indexTo, isEnabled });
+		}
+	}
+
+	core::SimulationState simulationState()const
+	{
+		if (!continueSimulation || !simulation)
+		{
+			return core::SimulationState::Paused;
+		}
+		return simulation->frame().state == core::SimulationState::Settled ? core::SimulationState::Settled : core::SimulationState::Running;
+	}
+
+	void update(core::FrameProfiler& profiler)
+	{
+		{
+			const core::ScopedPhase phase(profiler, ProfilePhase::Physics);
+			receiveLayout();
+		}
+		updateNodeGrid();
+
+		{
+			const core::ScopedPhase phase(profiler, ProfilePhase::Input);
+			inputsUpdate();
+		}
+		{
+			const core::ScopedPhase phase(profiler, ProfilePhase::Physics);
+			physicsUpdate();
+		}
+		{
+			const core::ScopedPhase phase(profiler, ProfilePhase::Roles);
+			updateRoles();
+		}
+		{
+			const core::ScopedPhase phase(profiler, ProfilePhase::Arrows);
+
+			Optional<core::Line> dragArrow;
+			if (linkBeginIndex && !nodeCircle(linkBeginIndex.value()).mouseOver())
+			{
+				const core::Node& node = board.nodes[linkBeginIndex.value()];
+				if (auto arrow = core::CutoffLine(core::Line(node.position, ToCore(Cursor::PosF())), node.radius, 0))
+				{
+					dragArrow = arrow.value();
+				}
+			}
+			arrowRenderer.update(board, dragArrow);
+		}
+
+		profiler.setCount(ProfileCounter::Nodes, static_cast<double>(board.nodes.size()));
+		profiler.setCount(ProfileCounter::Edges, static_cast<double>(board.adjacents.size()));
+
+		updateRedrawState();
+	}
+
+	//前に描き直したときから見た目が変わったか(直前の update の結果)
+	bool needsRedraw()const
+	{
+		return redrawNeeded;
+	}
+
+	//同じ種類のものをまとめて描く(枠、画像、死因と名前の順)
+	//キャラクター毎に順に描くとテクスチャが切り替わる度に描画が分かれてしまう
+	void draw(const CharacterAtlas& atlas, LabelCache& labels, core::FrameProfiler& profiler, const Font& characterNameFont, const Font& characterDeathCauseFont)const
+	{
+		{
+			const core::ScopedPhase phase(profiler, ProfilePhase::Characters);
+			for (auto i : step(nodes.size()))
+			{
+				nodeCircle(i).drawFrame(5.0, 0.0, CharacterNode::GetColor(board.nodes[i].co));
+			}
+			for (auto i : step(nodes.size()))
+			{
+				nodes[i].drawImage(board.nodes[i], atlas);
+			}
+			for (auto i : step(nodes.size()))
+			{
+				nodes[i].drawDeathCause(board.nodes[i], labels, characterDeathCauseFont);
+			}
+			for (auto i : step(nodes.size()))
+			{
+				nodes[i].drawName(board.nodes[i], labels, characterNameFont);
+			}
+
+			if (showRoles && roleSolution.probabilities.size() == nodes.size())
+			{
+				for (auto i : step(nodes.size()))
+				{
+					nodes[i].drawRoleProbability(board.nodes[i], labels, characterNameFont, roleSolution, i);
+				}
+
+				//数え直している間は前の結果を出しておく
+				const String status = roleReceivedSerial < roleSubmittedSerial ? U"(計算中)" : U"";
+				const auto worlds = characterNameFont(0.0 < roleSolution.worlds
+					? Format(U"矛盾しない割り当て ", static_cast<uint64>(roleSolution.worlds), U"通り", status, U"(F6で表示切り替え)")
+					: Format(U"矛盾しない割り当てがありません", status, U"(F6で表示切り替え)"));
+				worlds.draw(Vec2(7, Scene::Height() - worlds.region().size.y - 4));
+			}
+		}
+
+		//リンクと引いている途中の矢印は update で作った頂点をまとめて描く
+		{
+			const core::ScopedPhase phase(profiler, ProfilePhase::Arrows);
+			arrowRenderer.draw();
+		}
+
+		if (characterGUI)
+		{
+			characterGUI.value().draw(menuTexture, atlas, nodes, board.nodes);
+		}
+
+		if (linkEraseBegin)
+		{
+			//消しゴムで切れるリンクを強調する
+			for (const auto& [a, b] : erasedLinkCandidates)
+			{
+				if (auto arrow = core::CutoffLine(core::Line(board.nodes[a].position, board.nodes[b].position), board.nodes[a].radius, board.nodes[b].radius))
+				{
+					ToS3D(arrow.value()).draw(9.0, Color(255, 0, 0, 160));
+				}
+			}
+
+			Line(linkEraseBegin.value(), Cursor::PosF()).draw(3.0, Color(255, 0, 0, 128));
+		}
+	}
+
+private:
+	//盤面を受け取って、操作の途中の状態と計算のスレッドを作り直す
+	void start(const std::vector<Character>& characters, core::Board newBoard)
+	{
+		nodes.clear();
+		for (const auto& character : characters)
+		{
+			nodes.emplace_back(character);
+		}
+		board = std::move(newBoard);
+
+		//格子の一辺はノードの直径くらいにして、点の問い合わせで見るノードを数個にする
+		double maxRadius = 1.0;
+		for (const auto& node : board.nodes)
+		{
+			maxRadius = std::max(maxRadius, node.radius);
+		}
+		nodeGrid = core::SpatialGrid(2.0 * maxRadius);
+
+		menuTexture = Texture(U"Resource/gui.png");
+		linkBeginIndex = none;
+		moveIndex = none;
+		characterGUI = none;
+		linkEraseBegin = none;
+		erasedLinkCandidates.clear();
+		edgeGridLinksChanged = true;
+		arrowRenderer = ArrowRenderer();
+		history.clear();
+
+		//配役は人数から決める
+		//数え上げのスレッドは部分問題のキャッシュごと使い回し、前の盤面の結果は受け取らない
+		villageRules = core::VillageRules::ForPopulation(board.size());
+		if (!roleEngine)
+		{
+			roleEngine = std::make_unique<core::RoleEngine>();
+		}
+		roleSolution = core::RoleSolution();
+		roleStartSerial = roleSubmittedSerial + 1;
+		roleReceivedSerial = roleSubmittedSerial;
+		rolesChanged = true;
+
+		//スレッドには盤面の複製を渡し、以降はリンクや位置の固定などの変更をコマンドで送る
+		simulation = std::make_unique<core::LayoutThread>(core::LayoutParams());
+		simulationScene = SceneRect();
+		resetSerial = simulation->send(core::LayoutThread::Reset{ board, simulationScene });
+
+		continueSimulation = true;
+	}
+
+	Circle nodeCircle(size_t index)const
+	{
+		return Circle(ToS3D(board.nodes[index].position), board.nodes[index].radius);
+	}
+
+	//前のフレームから動いたノードだけ格子の登録し直しになる
+	void updateNodeGrid()
+	{
+		for (size_t i = 0; i < board.nodes.size(); ++i)
+		{
+			const core::Node& node = board.nodes[i];
+			nodeGrid.update(i, core::RectF(node.position - core::Vec2(node.radius, node.radius), core::Vec2(node.radius, node.radius) * 2.0));
+		}
+	}
+
+	bool nodeContains(size_t index, const core::Vec2& point)const
+	{
+		const core::Node& node = board.nodes[index];
+		return (point - node.position).lengthSq() <= node.radius * node.radius;
+	}
+
+	//ノードが前に描き直したときから RedrawDistance 以上動いたか、マウスで操作している途中なら描き直す
+	void updateRedrawState()
+	{
+		constexpr double RedrawDistance = 0.5;
+
+		bool isMoved = drawnPositions.size() != board.nodes.size();
+		for (size_t i = 0; !isMoved && i < board.nodes.size(); ++i)
+		{
+			isMoved = RedrawDistance * RedrawDistance <= (board.nodes[i].position - drawnPositions[i]).lengthSq();
+		}
+
+		if (isMoved)
+		{
+			drawnPositions.resize(board.nodes.size());
+			for (size_t i = 0; i < board.nodes.size(); ++i)
+			{
+				drawnPositions[i] = board.nodes[i].position;
+			}
+		}
+
+		redrawNeeded = isMoved || arrowRenderer.isLinksChanged() || isRolesUpdated || characterGUI || linkBeginIndex || moveIndex || linkEraseBegin;
+		isRolesUpdated = false;
+	}
+
+	//CO、リンク、死因が変わっていたら役職の割り当てを数え直させる
+	//数え上げは core::RoleEngine が別のスレッドで行い、ここでは数え終わった結果を受け取るだけにする
+	void updateRoles()
+	{
+		if (KeyF6.down())
+		{
+			showRoles = !showRoles;
+			isRolesUpdated = true;
+		}
+
+		if (rolesChanged)
+		{
+			roleSubmittedSerial = roleEngine->submit(board, villageRules);
+			rolesChanged = false;
+		}
+
+		if (roleEngine->receive() && roleStartSerial <= roleEngine->frame().serial)
+		{
+			roleSolution = roleEngine->frame().solution;
+			roleReceivedSerial = roleEngine->frame().serial;
+			isRolesUpdated = true;
+		}
+	}
+
+	//リンクの矢印の線分を格子に登録し直す
+	//ノードが動いたかリンクが変わったときだけ作り直す
+	void updateEdgeGrid()
+	{
+		bool isChanged = edgeGridLinksChanged || edgeGridPositions.size() != board.nodes.size();
+		for (size_t i = 0; !isChanged && i < board.nodes.size(); ++i)
+		{
+			isChanged = edgeGridPositions[i] != board.nodes[i].position;
+		}
+		if (!isChanged)
+		{
+			return;
+		}
+
+		edgeGrid = core::SegmentGrid(nodeGrid.cellSize());
+		edgeGridLinks.clear();
+		board.adjacents.forEach([&](int me, int other, char)
+		{
+			if (auto arrow = core::CutoffLine(core::Line(board.nodes[me].position, board.nodes[other].position), board.nodes[me].radius, board.nodes[other].radius))
+			{
+				edgeGrid.insert(static_cast<uint32>(edgeGridLinks.size()), arrow.value());
+				edgeGridLinks.emplace_back(me, other);
+			}
+		});
+
+		edgeGridPositions.resize(board.nodes.size());
+		for (size_t i = 0; i < board.nodes.size(); ++i)
+		{
+			edgeGridPositions[i] = board.nodes[i].position;
+		}
+		edgeGridLinksChanged = false;
+	}
+
+	//stroke が横切るリンクを、向きを問わずノードの組ごとに一つずつ(番号の小さい方が先)
+	std::vector<std::pair<int, int>> linksCutBy(const core::Line& stroke)
+	{
+		updateEdgeGrid();
+
+		std::vector<std::pair<int, int>> links;
+		edgeGrid.forEachIntersecting(stroke, [&](uint32 id, const core::Line&)
+		{
+			const auto [me, other] = edgeGridLinks[id];
+			links.emplace_back(std::min(me, other), std::max(me, other));
+		});
+
+		std::sort(links.begin(), links.end());
+		links.erase(std::unique(links.begin(), links.end()), links.end());
+		return links;
+	}
+
+	void eraseLinks(const std::vector<std::pair<int, int>>& links)
+	{
+		for (const auto& [a, b] : links)
+		{
+			setLink(a, b, 0);
+			setLink(b, a, 0);
+		}
+	}
+
+	//カーソルの下のノード、重なっているときは手前に描かれている(番号が大きい)方
+	Optional<int> topmostNodeAtCursor()const
+	{
+		const core::Vec2 cursor = ToCore(Cursor::PosF());
+		const int index = nodeGrid.topmost(cursor, [&](size_t i) { return nodeContains(i, cursor); });
+		return index < 0 ? none : Optional<int>(index);
+	}
+
+	//リンクの終点は以前から番号が小さい方を選んでいるので、それに合わせる
+	Optional<int> bottommostNodeAtCursor()const
+	{
+		const core::Vec2 cursor = ToCore(Cursor::PosF());
+		const int index = nodeGrid.bottommost(cursor, [&](size_t i) { return nodeContains(i, cursor); });
+		return index < 0 ? none : Optional<int>(index);
+	}
+
+	//history.undo() や redo() が返した変更を盤面と計算のスレッドに反映する
+	void applyHistory(const std::vector<core::BoardEdit>& edits)
+	{
+		for (const auto& edit : edits)
+		{
+			core::ApplyEdit(board, edit);
+			rolesChanged = true;
+			switch (edit.kind)
+			{
+			case core::BoardEdit::Link:
+				edgeGridLinksChanged = true;
+				simulation->send(core::LayoutThread::SetLink{ edit.node, edit.other, static_cast<char>(edit.after) });
+				break;
+			case core::BoardEdit::AutoLayout:
+				simulation->send(core::LayoutThread::SetAutoLayout{ edit.node, edit.after != 0 });
+				break;
+			case core::BoardEdit::Position:
+				simulation->send(core::LayoutThread::MoveNode{ edit.node, edit.positionAfter });
+				break;
+			default:
+				break;
+			}
+		}
+	}
+
+	//メニューで変わったノードの状態を履歴に記録する
+	void recordNodeChange(int index, const core::Node& before)
+	{
+		const core::Node& after = board.nodes[index];
+		rolesChanged = rolesChanged || before.co != after.co || before.state != after.state;
+		if (before.co != after.co)
+		{
+			history.record(core::BoardEdit::CoEdit(index, before.co, after.co));
+		}
+		if (before.state != after.state)
+		{
+			history.record(core::BoardEdit::StateEdit(index, before.state, after.state));
+		}
+		if (before.isAutoLayout != after.isAutoLayout)
+		{
+			history.record(core::BoardEdit::AutoLayoutEdit(index, before.isAutoLayout, after.isAutoLayout));
+		}
+	}
+
+	void inputsUpdate()
+	{
+		const bool isIdle = !linkBeginIndex && !moveIndex && !linkEraseBegin;
+
+		//Ctrl+Z で戻す、Ctrl+Y か Ctrl+Shift+Z でやり直す(ドラッグ中は受け付けない)
+		if (isIdle && KeyControl.pressed())
+		{
+			if (KeyZ.down())
+			{
+				applyHistory(KeyShift.pressed() ? history.redo() : history.undo());
+			}
+			else if (KeyY.down())
+			{
+				applyHistory(history.redo());
+			}
+		}
+
+		if (!linkBeginIndex && !moveIndex && !characterGUI && !linkEraseBegin)
+		{
+			if (MouseR.down() || MouseL.down())
+			{
+				if (const auto index = topmostNodeAtCursor())
+				{
+					if (MouseR.down())
+					{
+						moveIndex = index;
+						moveBeginPosition = board.nodes[index.value()].position;
+					}
+					else
+					{
+						linkBeginIndex = index;
+					}
+				}
+			}
+
+			if (MouseL.down() && !moveIndex && !linkBeginIndex)
+			{
+				linkEraseBegin = Cursor::PosF();
+			}
+		}
+		else if (moveIndex)
+		{
+			if (MouseR.pressed())
+			{
+				core::Node& node = board.nodes[moveIndex.value()];
+				node.position = core::FixedPosVel(ToCore(Cursor::PosF()), core::Vec2::Zero(), node.getFieldScope(SceneRect())).first;
+				simulation->send(core::LayoutThread::MoveNode{ moveIndex.value(), node.position });
+			}
+			if (MouseR.up())
+			{
+				//固定したノードを動かしたときだけ、動かす前の位置に戻せるようにする
+				const core::Node& node = board.nodes[moveIndex.value()];
+				if (!node.isAutoLayout && node.position != moveBeginPosition)
+				{
+					history.record(core::BoardEdit::PositionEdit(moveIndex.value(), moveBeginPosition, node.position));
+				}
+
+				characterGUI = none;
+				moveIndex = none;
+				linkBeginIndex = none;
+				linkEraseBegin = none;
+			}
+		}
+		else if (linkBeginIndex)
+		{
+			if (MouseL.up())
+			{
+				Optional<int> linkEndIndex;
+				if (const auto index = bottommostNodeAtCursor())
+				{
+					if (index.value() == linkBeginIndex.value())
+					{
+						characterGUI = MenuGUI(index.value(), Cursor::PosF());
+					}
+					else
+					{
+						linkEndIndex = index;
+					}
+				}
+
+				if (linkEndIndex)
+				{
+					const int color = KeyAlt.pressed() ? 2 : 1;
+					setLink(linkBeginIndex.value(), linkEndIndex.value(), color);
+				}
+
+				moveIndex = none;
+				linkBeginIndex = none;
+				linkEraseBegin = none;
+			}
+		}
+		else if (characterGUI)
+		{
+			const int index = characterGUI.value().nodeIndex;
+			const core::Node before = board.nodes[index];
+			if (characterGUI.value().update(board.nodes))
+			{
+				simulation->send(core::LayoutThread::SetAutoLayout{ index, board.nodes[index].isAutoLayout });
+			}
+			recordNodeChange(index, before);
+			if (MouseL.down())
+			{
+				if (!characterGUI.value().guiRect().mouseOver())
+				{
+					characterGUI = none;
+					moveIndex = none;
+					linkBeginIndex = none;
+					linkEraseBegin = none;
+				}
+			}
+		}
+		else if (linkEraseBegin)
+		{
+			//線を引いている間は毎フレーム、切れるリンクを調べて強調する
+			const core::Line eracerLine(ToCore(linkEraseBegin.value()), ToCore(Cursor::PosF()));
+			erasedLinkCandidates = linksCutBy(eracerLine);
+
+			//Ctrlを押している間は、なぞったリンクをその場で消していく
+			if (KeyControl.pressed() && MouseL.pressed())
+			{
+				eraseLinks(erasedLinkCandidates);
+				erasedLinkCandidates.clear();
+				linkEraseBegin = Cursor::PosF();
+			}
+
+			if (!MouseL.pressed())
+			{
+				eraseLinks(erasedLinkCandidates);
+				erasedLinkCandidates.clear();
+
+				characterGUI = none;
+				moveIndex = none;
+				linkBeginIndex = none;
+				linkEraseBegin = none;
+			}
+		}
+
+		//ドラッグや消しゴムの線が終わったら、そこまでの変更を一段として閉じる
+		if (!linkBeginIndex && !moveIndex && !linkEraseBegin)
+		{
+			history.commit();
+		}
+	}
+
+	void physicsUpdate()
+	{
+		if (KeySpace.down())
+		{
+			continueSimulation = !continueSimulation;
+			simulation->send(core::LayoutThread::SetRunning{ continueSimulation });
+		}
+
+		if (KeyR.down())
+		{
+			relayout();
+		}
+
+		//ウィンドウの大きさが変わったら、ノードが動ける範囲も変える
+		const core::RectF scene = SceneRect();
+		if (scene.pos != simulationScene.pos || scene.size != simulationScene.size)
+		{
+			simulationScene = scene;
+			simulation->send(core::LayoutThread::SetScene{ scene });
+		}
+
+		//キューが一杯で送れなかったコマンドがあれば送る
+		simulation->flush();
+	}
+
+	//スレッドが最後に公開した位置を受け取る、計算が終わるのは待たない
+	void receiveLayout()
+	{
+		if (!simulation->receive())
+		{
+			return;
+		}
+
+		//盤面を渡す前の結果は使わない
+		const core::LayoutFrame& frame = simulation->frame();
+		if (frame.commandSerial < resetSerial || frame.positions.size() != board.nodes.size())
+		{
+			return;
+		}
+
+		for (size_t i = 0; i < board.nodes.size(); ++i)
+		{
+			//ドラッグ中のノードは、こちらで動かした位置をそのまま使う
+			if (moveIndex && static_cast<size_t>(moveIndex.value()) == i)
+			{
+				continue;
+			}
+			board.nodes[i].position = frame.positions[i];
+			board.nodes[i].velocity = frame.velocities[i];
+		}
+	}
+
+	//描画用のデータ、board.nodes と同じ順番で並ぶ
+	std::vector<CharacterNode> nodes;
+
+	core::Board board;
+
+	//レイアウト計算のスレッドと、最後に送った盤面と画面の範囲
+	std::unique_ptr<core::LayoutThread> simulation;
+	std::uint64_t resetSerial = 0;
+	core::RectF simulationScene;
+
+	//ノードの円の当たり判定用
+	core::SpatialGrid nodeGrid;
+
+	//消しゴムの当たり判定用、edgeGridLinks[id] が登録したリンク
+	core::SegmentGrid edgeGrid;
+	std::vector<std::pair<int, int>> edgeGridLinks;
+	std::vector<core::Vec2> edgeGridPositions;
+	bool edgeGridLinksChanged = true;
+
+	ArrowRenderer arrowRenderer;
+
+	//最後に描き直したときのノードの位置
+	std::vector<core::Vec2> drawnPositions;
+	bool redrawNeeded = true;
+
+	//元に戻す・やり直すための編集の履歴
+	core::BoardHistory history;
+
+	//村の配役と、盤面と矛盾しない役職の割り当て(F6で表示を切り替える)
+	core::VillageRules villageRules;
+	core::RoleSolution roleSolution;
+	bool rolesChanged = true;
+
+	//役職の割り当てを数えるスレッドと、最後に送った盤面・今の盤面で最初に送った盤面・最後に受け取った結果の番号
+	std::unique_ptr<core::RoleEngine> roleEngine;
+	std::uint64_t roleSubmittedSerial = 0;
+	std::uint64_t roleStartSerial = 1;
+	std::uint64_t roleReceivedSerial = 0;
+	bool isRolesUpdated = false;
+	bool showRoles = true;
+
+	//ドラッグを始めたときのノードの位置
+	core::Vec2 moveBeginPosition;
+
+	//消しゴムの線で今消えるリンク
+	std::vector<std::pair<int, int>> erasedLinkCandidates;
+
+	Optional<Vec2> linkEraseBegin;
+	Optional<int> linkBeginIndex;
+	Optional<int> moveIndex;
+	Optional<MenuGUI> characterGUI;
+
+	Texture menuTexture;
+	bool continueSimulation = true;
+};
+
+class Game
+{
+public:
+	Game(const std::vector<FilePath>& characterImagePaths, const std::vector<FilePath>& characterImagePaths2)
+		: characterNameFont(14, Typeface::Heavy)
+		, systemFont(32)
+		, characterDeathCauseFont(32)
+	{
+		//画像は別のスレッドで読み込むので、先に名前順に並べて読み込み終わるまでは仮の画像で表示する
+		const auto sortByName = [](std::vector<FilePath> paths)
+		{
+			std::sort(paths.begin(), paths.end(), [](const FilePath& a, const FilePath& b) {return FileSystem::BaseName(a) < FileSystem::BaseName(b); });
+			return paths;
+		};
+		const auto paths = sortByName(characterImagePaths);
+		const auto paths2 = sortByName(characterImagePaths2);
+
+		Array<FilePath> allPaths = paths;
+		allPaths.insert(allPaths.end(), paths2.begin(), paths2.end());
+
+		//アトラスには読み込む画像の順に並べ、最後にキャラクター画像2の表示切り替えボタンを置く
+		atlas = CharacterAtlas(LoadResolution(), allPaths.size() + 1, Color(96, 106, 117));
+		for (size_t i = 0; i < paths.size(); ++i)
+		{
+			characterTemplates.emplace_back(FileSystem::BaseName(paths[i]), atlas.region(i), RandomVec2(Scene::Rect()));
+		}
+		for (size_t i = 0; i < paths2.size(); ++i)
+		{
+			characterTemplates2.emplace_back(FileSystem::BaseName(paths2[i]), atlas.region(paths.size() + i), RandomVec2(Scene::Rect()));
+		}
+
+		characterHideRegion = atlas.region(allPaths.size());
+		atlas.set(allPaths.size(), Image(U"Resource/gui2.png"));
+		atlas.upload();
+
+		imageLoader = std::make_unique<CharacterImageLoader>(allPaths, LoadResolution(), U"ThumbnailCache");
+
+		restart();
+	}
+
+	void restart()
+	{
+		state = Initial;
+		characters.clear();
+		characterHideButton = none;
+		showCharacter2 = false;
+	}
+
+	void update()
+	{
+		profiler.beginFrame();
+		const core::ScopedPhase phase(profiler, ProfilePhase::Update);
+
+		const State previousState = state;
+		const bool isImageReceived = receiveImages();
+
+		if (KeyF3.down())
+		{
+			showStatistics = !showStatistics;
+		}
+
+		if (KeyF4.down())
+		{
+			isOnDemand = !isOnDemand;
+		}
+
+		if (KeyF5.down())
+		{
+			exportProfile();
+		}
+
+		if (KeyControl.pressed())
+		{
+			if (KeyS.down() && state == Update)
+			{
+				saveSnapshot();
+			}
+			else if (KeyO.down())
+			{
+				loadSnapshot();
+			}
+			else if (KeyE.down())
+			{
+				exportSnapshotText();
+			}
+		}
+
+		if (state == Initial)
+		{
+			const int horizontalNum = Scene::Width() / LoadResolution().x;
+
+			{
+				size_t i = 0;
+				const Vec2 w = LoadResolution();
+
+				for (; i < characterTemplates.size(); ++i)
+				{
+					const int x = i % horizontalNum;
+					const int y = i / horizontalNum;
+					characterTemplates[i].position = w * Vec2(x, y) + w * 0.5;
+				}
+
+				if (!characterTemplates2.empty())
+				{
+					characterHideButton = RectF(w * Vec2(i % horizontalNum, i / horizontalNum), w);
+					for (++i; i < 1 + characterTemplates.size() + characterTemplates2.size(); ++i)
+					{
+						const int x = i % horizontalNum;
+						const int y = i / horizontalNum;
+						characterTemplates2[i - 1 - characterTemplates.size()].position = w * Vec2(x, y) + w * 0.5;
+					}
+				}
+			}
+
+			//位置は毎フレーム決め直すが、変わらなければ格子は書き換わらない
+			for (size_t i = 0; i < characterTemplates.size() + characterTemplates2.size(); ++i)
+			{
+				templateGrid.update(i, ToCore(characterTemplate(i).rect()));
+			}
+
+			if (MouseL.down())
+			{
+				const core::Vec2 cursor = ToCore(Cursor::PosF());
+				const int index = templateGrid.topmost(cursor, [&](size_t i)
+				{
+					return (i < characterTemplates.size() || showCharacter2) && ToCore(characterTemplate(i).rect()).intersects(cursor);
+				});
+				if (0 <= index)
+				{
+					characterTemplate(index).isActive = !characterTemplate(index).isActive;
+				}
+			}
+
+			if (characterHideButton)
+			{
+				if (characterHideButton.value().leftClicked())
+				{
+					showCharacter2 = !showCharacter2;
+				}
+			}
+
+			//全ての画像を読み込むまでは始めない
+			if (KeyEnter.down() && imageLoader->isDone())
+			{
+				//state = Select;
+
+				characters.clear();
+				for (const auto& characterTemplate : characterTemplates)
+				{
+					if (characterTemplate.isActive)
+					{
+						characters.push_back(characterTemplate);
+					}
+				}
+				for (const auto& characterTemplate : characterTemplates2)
+				{
+					if (characterTemplate.isActive)
+					{
+						characters.push_back(characterTemplate);
+					}
+				}
+				for (int j = 0; j < characters.size(); ++j)
+				{
+					characters[j].isActive = false;
+				}
+				graph.initialize(characters);
+
+				state = Update;
+			}
+		}
+		else if (state == Select)
+		{
+			int realIndex = 0;
+
+			const auto switchToUpdate = [&]()
+			{
+				characters.clear();
+				for (const auto& characterTemplate : characterTemplates)
+				{
+					if (characterTemplate.isActive)
+					{
+						characters.push_back(characterTemplate);
+					}
+				}
+				for (const auto& characterTemplate : characterTemplates2)
+				{
+					if (characterTemplate.isActive)
+					{
+						characters.push_back(characterTemplate);
+					}
+				}
+				for (int j = 0; j < characters.size(); ++j)
+				{
+					characters[j].isActive = (j == realIndex ? true : false);
+				}
+				myselfIndex = realIndex;
+				state = Update;
+				graph.initialize(characters);
+			};
+
+			for (int i = 0; i < characterTemplates.size(); ++i)
+			{
+				if (characterTemplates[i].isActive)
+				{
+					if (characterTemplates[i].rect().leftClicked())
+					{
+						switchToUpdate();
+						break;
+					}
+
+					++realIndex;
+				}
+			}
+			for (int i = 0; i < characterTemplates2.size(); ++i)
+			{
+				if (characterTemplates2[i].isActive)
+				{
+					if (characterTemplates2[i].rect().leftClicked())
+					{
+						switchToUpdate();
+						break;
+					}
+
+					++realIndex;
+				}
+			}
+		}
+		else if (state == Update)
+		{
+			graph.update(profiler);
+		}
+
+		redrawNeeded = !isOnDemand
+			|| receivedInput()
+			|| isImageReceived
+			|| state != previousState
+			|| (state == Update && graph.needsRedraw());
+	}
+
+	//見た目が変わったときだけ描き直し、それ以外は前に描いた画面を貼る
+	void present()
+	{
+		{
+			const core::ScopedPhase phase(profiler, ProfilePhase::Draw);
+			frameCache.render(redrawNeeded, [this] { draw(); });
+		}
+
+		profiler.setCount(ProfileCounter::DrawCalls, Profiler::GetStat().drawCalls);
+		profiler.setCount(ProfileCounter::Redrawn, redrawNeeded ? 1.0 : 0.0);
+
+		if (showStatistics)
+		{
+			drawStatistics();
+		}
+
+		profiler.endFrame();
+	}
+
+	//描き直す必要が無かったか、このときは次のフレームまで間を空けてよい
+	bool isIdle()const
+	{
+		return !redrawNeeded;
+	}
+
+	void draw()const
+	{
+		if (state == Initial)
+		{
+			if (characterHideButton)
+			{
+				atlas(characterHideRegion).drawAt(characterHideButton.value().center(), characterHideButton.value().mouseOver() ? ColorF(1) : Shade(160));
+			}
+
+			Array<const Character*> visibleCharacters;
+			for (const auto& character : characterTemplates)
+			{
+				visibleCharacters.push_back(&character);
+			}
+			if (showCharacter2)
+			{
+				for (const auto& character : characterTemplates2)
+				{
+					visibleCharacters.push_back(&character);
+				}
+			}
+			drawCharacters(visibleCharacters);
+
+			const int population1 = std::count_if(characterTemplates.begin(), characterTemplates.end(), [](const Character& c) {return c.isActive; });
+			const int population2 = std::count_if(characterTemplates2.begin(), characterTemplates2.end(), [](const Character& c) {return c.isActive; });
+
+			if (imageLoader->isDone())
+			{
+				DrawBR(Scene::Rect().br(), systemFont(Format(population1 + population2, U"人村(Enterでスタート)")));
+			}
+			else
+			{
+				DrawBR(Scene::Rect().br(), systemFont(Format(population1 + population2, U"人村(画像を読み込み中 ", imageLoader->takenCount(), U"/", imageLoader->totalCount(), U")")));
+			}
+		}
+		else if (state == Select)
+		{
+			Array<const Character*> visibleCharacters;
+			for (const auto& character : characterTemplates)
+			{
+				if (character.isActive)
+				{
+					visibleCharacters.push_back(&character);
+				}
+			}
+			for (const auto& character : characterTemplates2)
+			{
+				if (character.isActive)
+				{
+					visibleCharacters.push_back(&character);
+				}
+			}
+			drawCharacters(visibleCharacters);
+
+			DrawBR(Scene::Rect().br(), systemFont(Format(U"自キャラを選択")));
+		}
+		else if (state == Update)
+		{
+			graph.draw(atlas, labels, profiler, characterNameFont, characterDeathCauseFont);
+
+			switch (graph.simulationState())
+			{
+			case core::SimulationState::Running:
+				DrawBR(Scene::Rect().br(), characterNameFont(U"計算中"), Alpha(128));
+				break;
+			case core::SimulationState::Settled:
+				DrawBR(Scene::Rect().br(), characterNameFont(U"安定"), Alpha(128));
+				break;
+			case core::SimulationState::Paused:
+				DrawBR(Scene::Rect().br(), characterNameFont(U"停止中(Spaceで再開)"), Alpha(128));
+				break;
+			}
+		}
+	}
+
+private:
+	static Size LoadResolution()
+	{
+		//return Size(128, 128);
+		return Size(100, 100);
+	}
+
+	//キャラクター画像1, 2を続けて数えたときの index 番目
+	Character& characterTemplate(size_t index)
+	{
+		return index < characterTemplates.size() ? characterTemplates[index] : characterTemplates2[index - characterTemplates.size()];
+	}
+
+	//1フレームにアトラスへ書き込む画像の数の上限
+	static constexpr size_t MaxTextureUploadsPerFrame = 16;
+
+	//画像を全て描いてから名前を描く
+	//画像は全て同じアトラスから描くので一回の描画にまとまる
+	void drawCharacters(const Array<const Character*>& visibleCharacters)const
+	{
+		const core::ScopedPhase phase(profiler, ProfilePhase::Characters);
+		for (const auto* character : visibleCharacters)
+		{
+			character->drawImage(atlas, character->rect().mouseOver() ? ColorF(1) : Shade(160));
+		}
+		for (const auto* character : visibleCharacters)
+		{
+			character->drawName(labels, characterNameFont);
+		}
+	}
+
+	//マウスやキーの入力があったか、離したフレームも入力に数える
+	bool receivedInput()
+	{
+		const bool isPressed = MouseL.pressed() || MouseR.pressed() || MouseM.pressed() || !Keyboard::GetAllInputs().empty();
+		const bool result = isPressed || wasPressed || Cursor::Delta() != Point(0, 0) || Mouse::Wheel() != 0.0;
+		wasPressed = isPressed;
+		return result;
+	}
+
+	//F3で表示する、描画の回数は前のフレームのもの
+	//区間の時間と数は直近 StatisticsWindow フレームの中央値と99パーセンタイル
+	void drawStatistics()const
+	{
+		constexpr size_t StatisticsWindow = 600;
+
+		Array<String> lines;
+		lines.push_back(Format(U"描画 ", Profiler::GetStat().drawCalls, U"回 / ", Scene::DeltaTime() * 1000.0, U"ms / ", Profiler::FPS(), U"fps / ",
+			isOnDemand ? U"描き直し省略 " : U"毎フレーム描画(F4) ", frameCache.skippedFrames(), U"/", frameCache.skippedFrames() + frameCache.renderedFrames()));
+		lines.push_back(Format(U"frame: ", profiler.framePercentile(0.5, StatisticsWindow), U" / ", profiler.framePercentile(0.99, StatisticsWindow), U"ms"));
+
+		const auto& phaseNames = profiler.phaseNames();
+		for (size_t i = 0; i < phaseNames.size(); ++i)
+		{
+			lines.push_back(Format(Unicode::FromUTF8(phaseNames[i]), U": ", profiler.phasePercentile(i, 0.5, StatisticsWindow), U" / ", profiler.phasePercentile(i, 0.99, StatisticsWindow), U"ms"));
+		}
+
+		const auto& counterNames = profiler.counterNames();
+		for (size_t i = 0; i < counterNames.size(); ++i)
+		{
+			lines.push_back(Format(Unicode::FromUTF8(counterNames[i]), U": ", profiler.counterPercentile(i, 0.5, StatisticsWindow), U" / ", profiler.counterPercentile(i, 0.99, StatisticsWindow)));
+		}
+		lines.push_back(Format(U"allocations: ", profiler.allocationPercentile(0.5, StatisticsWindow), U" / ", profiler.allocationPercentile(0.99, StatisticsWindow), U" (F5でCSVに書き出す)"));
+
+		for (size_t i = 0; i < lines.size(); ++i)
+		{
+			const Vec2 pos(7, 6 + 20 * i);
+			characterNameFont(lines[i]).draw(pos + Vec2(1, 2), Palette::Black);
+			characterNameFont(lines[i]).draw(pos, Palette::White);
+		}
+	}
+
+	//残っているフレームの記録を CSV に書き出す
+	void exportProfile()const
+	{
+		const FilePath path = U"Profile.csv";
+		std::ofstream ofs(std::filesystem::path(Unicode::ToWstring(path)));
+		profiler.writeCsv(ofs);
+		Logger << Format(path, U" に ", profiler.recordedFrames(), U"フレーム分の記録を書き出しました");
+	}
+
+	static FileFilter SnapshotFilter()
+	{
+		return{ U"盤面", { U"wwboard" } };
+	}
+
+	//Ctrl+S: 今の盤面をスナップショットに保存する
+	void saveSnapshot()const
+	{
+		const auto path = Dialog::SaveFile({ SnapshotFilter() });
+		if (!path)
+		{
+			return;
+		}
+
+		if (graph.saveSnapshot(path.value()))
+		{
+			Logger << Format(path.value(), U" に盤面を保存しました");
+		}
+		else
+		{
+			Logger << Format(path.value(), U" に盤面を保存できませんでした");
+		}
+	}
+
+	//Ctrl+O: 保存した盤面を開く、キャラクターは名前が同じ画像で表示する
+	void loadSnapshot()
+	{
+		const auto path = Dialog::OpenFile({ SnapshotFilter() });
+		if (!path)
+		{
+			return;
+		}
+
+		const auto snapshot = core::BoardSnapshotView::Open(Unicode::ToWstring(path.value()));
+		std::optional<core::Board> savedBoard;
+		if (snapshot)
+		{
+			savedBoard = snapshot->toBoard();
+		}
+		if (!savedBoard)
+		{
+			Logger << Format(path.value(), U" は盤面のファイルではありません");
+			return;
+		}
+
+		std::vector<Character> savedCharacters;
+		for (size_t i = 0; i < snapshot->nodeCount(); ++i)
+		{
+			const String name = Unicode::FromUTF8(snapshot->rosterName(i));
+			const Character* character = findCharacterTemplate(name);
+			if (!character)
+			{
+				Logger << Format(U"キャラクター画像 ", name, U" が見つからないので ", path.value(), U" を開けません");
+				return;
+			}
+			savedCharacters.push_back(*character);
+			savedCharacters.back().isActive = false;
+		}
+
+		characters = std::move(savedCharacters);
+		state = Update;
+		graph.restore(characters, std::move(savedBoard.value()));
+	}
+
+	//Ctrl+E: スナップショットをデバッグ用にテキスト形式で書き出す(同じ場所に .txt を付けた名前で置く)
+	void exportSnapshotText()const
+	{
+		const auto path = Dialog::OpenFile({ SnapshotFilter() });
+		if (!path)
+		{
+			return;
+		}
+
+		const auto snapshot = core::BoardSnapshotView::Open(Unicode::ToWstring(path.value()));
+		const FilePath textPath = path.value() + U".txt";
+		std::ofstream ofs(std::filesystem::path(Unicode::ToWstring(textPath)));
+		if (snapshot && core::ExportSnapshotText(ofs, *snapshot))
+		{
+			Logger << Format(textPath, U" に書き出しました");
+		}
+		else
+		{
+			Logger << Format(textPath, U" に書き出せませんでした");
+		}
+	}
+
+	const Character* findCharacterTemplate(const String& name)const
+	{
+		for (const auto* templates : { &characterTemplates, &characterTemplates2 })
+		{
+			for (const auto& character : *templates)
+			{
+				if (character.name == name)
+				{
+					return &character;
+				}
+			}
+		}
+		return nullptr;
+	}
+
+	//読み込み終わったキャラクター画像をアトラスに書き込んで、仮の画像と入れ替える
+	//新しく受け取った画像があれば true を返す
+	bool receiveImages()
+	{
+		if (imageLoader->isDone())
+		{
+			return false;
+		}
+
+		const auto loadedImages = imageLoader->takeLoaded(MaxTextureUploadsPerFrame);
+		for (const auto& loaded : loadedImages)
+		{
+			if (loaded.image)
+			{
+				atlas.set(loaded.index, loaded.image);
+			}
+			Logger << Format(imageLoader->path(loaded.index), loaded.fromCache ? U" (cache): " : U": ", loaded.decodeMs, U"ms");
+		}
+
+		atlas.upload();
+
+		if (imageLoader->isDone())
+		{
+			Logger << Format(U"キャラクター画像 ", imageLoader->totalCount(), U"枚(キャッシュ ", imageLoader->cacheHitCount(), U"枚)の読み込み: ", imageLoader->elapsedMs(), U"ms");
+		}
+		return !loadedImages.empty();
+	}
+
+	enum State { Initial, Select, Update };
+	Font characterNameFont;
+	Font characterDeathCauseFont;
+	Font systemFont;
+	std::vector<Character> characterTemplates;
+	std::vector<Character> characterTemplates2;
+	std::vector<Character> characters;
+	CharacterAtlas atlas;
+	CharacterAtlas::Region characterHideRegion;
+
+	//描画中に初めて出てきた文字を描き足すので mutable
+	mutable LabelCache labels;
+
+	//描画中の区間も測るので mutable
+	mutable core::FrameProfiler profiler = MakeProfiler();
+	std::unique_ptr<CharacterImageLoader> imageLoader;
+	Optional<RectF> characterHideButton;
+
+	//キャラクター選択画面の当たり判定用、番号は characterTemplate(index) と同じ
+	core::SpatialGrid templateGrid{ static_cast<double>(LoadResolution().x) };
+	bool showCharacter2 = false;
+	bool showStatistics = false;
+
+	//見た目が変わったフレームだけ描き直す(F4で切り替え)
+	bool isOnDemand = true;
+	bool redrawNeeded = true;
+	bool wasPressed = false;
+	FrameCache frameCache;
+	State state;
+	Graph graph;
+	int myselfIndex;
+};
+
+void Main()
+{
+	Window::SetTitle(U"人狼盤面整理ツール");
+	Scene::SetBackground(Color(73, 83, 94));
+	Window::Resize(1280, 720);
+
+	auto paths = FileSystem::DirectoryContents(U"キャラクター画像1");
+
+	auto paths2 = FileSystem::DirectoryContents(U"キャラクター画像2");
+
+	//何も変わらないときのフレームの間隔、入力への反応がこれだけ遅れる
+	constexpr int32 IdleTickMs = 50;
+
+	Game game(paths, paths2);
+	while (System::Update())
+	{
+		game.update();
+		game.present();
+
+		//盤面が止まっていて入力も無い間は、CPUとGPUをほとんど使わないように間を空ける
+		if (game.isIdle())
+		{
+			System::Sleep(IdleTickMs);
+		}
+	}
+}
@@ -0,0 +1,573 @@
+﻿# include <algorithm>
+# include <chrono>
+# include <cstdio>
+# include <cstdlib>
+# include <cstdint>
+# include <cstring>
+# include <fstream>
+# include <optional>
+# include <random>
+# include <string>
+# include <thread>
+# include "Core/BoardGenerator.hpp"
+# include "Core/BoardHistory.hpp"
+# include "Core/BoardSnapshot.hpp"
+# include "Core/BoardText.hpp"
+# include "Core/Layout.hpp"
+# include "Core/LayoutThread.hpp"
+# include "Core/Multilevel.hpp"
+
+//ウィンドウを開かずに盤面のレイアウト計算だけを実行して速度を測る
+
+namespace
+{
+	void PrintUsage(const char* name)
+	{
+		std::fprintf(stderr,
+			"usage: %s [options]\n"
+			"  --board=PATH       load a board saved in the text or snapshot format\n"
+			"  --nodes=N          number of nodes of the random board (default 15)\n"
+			"  --links=N          number of links of the random board (default 2 * nodes)\n"
+			"  --seed=N           seed of the random board (default 1)\n"
+			"  --scene=WxH        scene size (default 1280x720, enlarged for more than 15 random nodes)\n"
+			"  --steps=N          number of frames to simulate (default 600)\n"
+			"  --theta=X          Barnes-Hut opening angle (default 0.5)\n"
+			"  --bh-threshold=N   use Barnes-Hut from N nodes (default 256)\n"
+			"  --kernel=NAME      repulsion kernel: auto, scalar, sse2 or avx2 (default auto)\n"
+			"  --integrator=NAME  euler, semi-implicit-euler, verlet or adaptive (default euler)\n"
+			"  --multilevel       lay out the board with the multilevel scheme before the frames\n"
+			"  --fps=N            advance by 1/N seconds per frame instead of a fixed number of sub-steps\n"
+			"  --threads=N        worker threads including the main thread, 0 for all cores (default 0)\n"
+			"  --parallel-threshold=N  run on one thread below N nodes (default 512)\n"
+			"  --threaded         run the frames on core::LayoutThread in lockstep (the state hash matches the direct run)\n"
+			"  --edits=N          after the frames, add N random links one at a time and run until the board settles again,\n"
+			"                     then check that undoing and redoing all of them restores the links\n"
+			"  --global-edits     wake the whole board after each edit instead of only the neighbourhood\n"
+			"  --hops=N           links followed from an edited node to find the nodes that move (default 2)\n"
+			"  --save=PATH        save the final board in the text format\n"
+			"  --snapshot=PATH    save the final board in the binary snapshot format\n",
+			name);
+	}
+
+	bool ParseOption(const char* arg, const char* name, const char*& value)
+	{
+		const size_t length = std::strlen(name);
+		if (std::strncmp(arg, name, length) != 0)
+		{
+			return false;
+		}
+
+		value = arg + length;
+		return true;
+	}
+
+	double KineticEnergy(const core::Board& board)
+	{
+		double energy = 0.0;
+		for (const auto& node : board.nodes)
+		{
+			energy += 0.5 * node.velocity.lengthSq();
+		}
+		return energy;
+	}
+
+	//バネ・電気モデルのエネルギー(参考資料の式)、小さいほど良い配置
+	//Layout が計算する力は、このエネルギーの勾配の符号を変えたものになる
+	double LayoutEnergy(const core::Board& board, const core::RectF& scene, const core::LayoutParams& params)
+	{
+		const double K = params.naturalDistance;
+		const double C = params.relativeStrength;
+
+		double energy = 0.0;
+		for (size_t a = 0; a < board.size(); ++a)
+		{
+			const double toCenter = board.nodes[a].position.distanceFrom(scene.center());
+			energy += params.centripetal * toCenter * toCenter * toCenter / (3.0 * K);
+
+			for (size_t b = a + 1; b < board.size(); ++b)
+			{
+				const double distance = board.nodes[a].position.distanceFrom(board.nodes[b].position);
+				energy -= C * K * K * std::log(distance);
+				if (board.isLinked(static_cast<int>(a), static_cast<int>(b)))
+				{
+					energy += params.attraction * distance * distance * distance / (3.0 * K);
+				}
+			}
+		}
+		return energy;
+	}
+
+	struct EditResult
+	{
+		long long frames = 0;
+		std::uint64_t evaluations = 0;
+
+		//1px 以上動いたノードの数
+		size_t movedNodes = 0;
+
+		bool isSettled = false;
+
+		//範囲だけでは落ち着かず、盤面全体を動かしたか
+		bool fellBack = false;
+	};
+
+	//ランダムな二人の間に白出しのリンクを一本足して、落ち着くまで(最大 maxFrames フレーム) update を繰り返す
+	//足したリンクは一段ずつ history に記録する
+	EditResult RunEdit(core::Board& board, core::Layout& layout, const core::RectF& scene, std::mt19937& rng, bool isGlobal, long long maxFrames, core::BoardHistory& history)
+	{
+		EditResult result;
+		std::uniform_int_distribution<int> index(0, static_cast<int>(board.size()) - 1);
+		int a = 0;
+		int b = 0;
+		for (int attempt = 0; attempt < 1000 && (a == b || board.isLinked(a, b)); ++attempt)
+		{
+			a = index(rng);
+			b = index(rng);
+		}
+		if (a == b || board.isLinked(a, b))
+		{
+			return result;
+		}
+
+		std::vector<core::Vec2> before;
+		for (const auto& node : board.nodes)
+		{
+			before.push_back(node.position);
+		}
+
+		history.record(core::BoardEdit::LinkEdit(a, b, 0, 1));
+		history.commit();
+		board.setLink(a, b, 1);
+		if (isGlobal)
+		{
+			layout.wake();
+		}
+		else
+		{
+			layout.wakeAround({ a, b });
+		}
+
+		const std::uint64_t evaluations = layout.forceEvaluations();
+		while (result.frames < maxFrames && !layout.isSettled())
+		{
+			layout.resetInvalidNodes(board, scene);
+			layout.update(board, scene);
+			++result.frames;
+			result.fellBack = result.fellBack || (!isGlobal && !layout.isLocal());
+		}
+		result.evaluations = layout.forceEvaluations() - evaluations;
+		result.isSettled = layout.isSettled();
+
+		for (size_t i = 0; i < board.size(); ++i)
+		{
+			result.movedNodes += 1.0 <= board.nodes[i].position.distanceFrom(before[i]) ? 1 : 0;
+		}
+		return result;
+	}
+
+	std::vector<core::EdgeStore::Edge> SortedEdges(const core::Board& board)
+	{
+		auto edges = board.adjacents.edges();
+		std::sort(edges.begin(), edges.end(), [](const core::EdgeStore::Edge& a, const core::EdgeStore::Edge& b)
+		{
+			return a.from != b.from ? a.from < b.from : a.to < b.to;
+		});
+		return edges;
+	}
+
+	bool SameEdges(const std::vector<core::EdgeStore::Edge>& a, const std::vector<core::EdgeStore::Edge>& b)
+	{
+		return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const core::EdgeStore::Edge& x, const core::EdgeStore::Edge& y)
+		{
+			return x.from == y.from && x.to == y.to && x.color == y.color;
+		});
+	}
+
+	//スレッド数を変えても結果が一致することを確かめるための、位置と速度のビット列のハッシュ(FNV-1a)
+	std::uint64_t StateHash(const core::Board& board)
+	{
+		std::uint64_t hash = 14695981039346656037ull;
+		const auto feed = [&](double value)
+		{
+			std::uint64_t bits;
+			std::memcpy(&bits, &value, sizeof(bits));
+			for (int i = 0; i < 8; ++i)
+			{
+				hash = (hash ^ ((bits >> (8 * i)) & 0xff)) * 1099511628211ull;
+			}
+		};
+
+		for (const auto& node : board.nodes)
+		{
+			feed(node.position.x);
+			feed(node.position.y);
+			feed(node.velocity.x);
+			feed(node.velocity.y);
+		}
+		return hash;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string boardPath;
+	std::string savePath;
+	std::string snapshotPath;
+	size_t nodeCount = 15;
+	long long linkCount = -1;
+	unsigned seed = 1;
+	std::optional<core::RectF> scene;
+	long long steps = 600;
+	double fps = 0.0;
+	bool multilevel = false;
+	long long edits = 0;
+	bool globalEdits = false;
+	bool threaded = false;
+	core::LayoutParams params;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* value = nullptr;
+		if (ParseOption(argv[i], "--board=", value))
+		{
+			boardPath = value;
+		}
+		else if (ParseOption(argv[i], "--save=", value))
+		{
+			savePath = value;
+		}
+		else if (ParseOption(argv[i], "--snapshot=", value))
+		{
+			snapshotPath = value;
+		}
+		else if (ParseOption(argv[i], "--nodes=", value))
+		{
+			nodeCount = std::strtoull(value, nullptr, 10);
+		}
+		else if (ParseOption(argv[i], "--links=", value))
+		{
+			linkCount = std::strtoll(value, nullptr, 10);
+		}
+		else if (ParseOption(argv[i], "--seed=", value))
+		{
+			seed = static_cast<unsigned>(std::strtoul(value, nullptr, 10));
+		}
+		else if (ParseOption(argv[i], "--scene=", value))
+		{
+			double w = 0.0;
+			double h = 0.0;
+			if (std::sscanf(value, "%lfx%lf", &w, &h) != 2 || w <= 0.0 || h <= 0.0)
+			{
+				PrintUsage(argv[0]);
+				return 1;
+			}
+			scene = core::RectF(0, 0, w, h);
+		}
+		else if (ParseOption(argv[i], "--steps=", value))
+		{
+			steps = std::strtoll(value, nullptr, 10);
+		}
+		else if (ParseOption(argv[i], "--theta=", value))
+		{
+			params.barnesHutTheta = std::atof(value);
+		}
+		else if (ParseOption(argv[i], "--bh-threshold=", value))
+		{
+			params.barnesHutThreshold = std::strtoull(value, nullptr, 10);
+		}
+		else if (ParseOption(argv[i], "--kernel=", value))
+		{
+			const auto kernel = core::ParseForceKernel(value);
+			if (!kernel)
+			{
+				PrintUsage(argv[0]);
+				return 1;
+			}
+			params.forceKernel = *kernel;
+		}
+		else if (ParseOption(argv[i], "--integrator=", value))
+		{
+			const auto integrator = core::ParseIntegrator(value);
+			if (!integrator)
+			{
+				PrintUsage(argv[0]);
+				return 1;
+			}
+			params.integrator = *integrator;
+		}
+		else if (std::strcmp(argv[i], "--multilevel") == 0)
+		{
+			multilevel = true;
+		}
+		else if (ParseOption(argv[i], "--fps=", value))
+		{
+			fps = std::atof(value);
+		}
+		else if (ParseOption(argv[i], "--threads=", value))
+		{
+			params.threadCount = std::strtoull(value, nullptr, 10);
+		}
+		else if (ParseOption(argv[i], "--parallel-threshold=", value))
+		{
+			params.parallelThreshold = std::strtoull(value, nullptr, 10);
+		}
+		else if (ParseOption(argv[i], "--edits=", value))
+		{
+			edits = std::strtoll(value, nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--threaded") == 0)
+		{
+			threaded = true;
+		}
+		else if (std::strcmp(argv[i], "--global-edits") == 0)
+		{
+			globalEdits = true;
+		}
+		else if (ParseOption(argv[i], "--hops=", value))
+		{
+			params.localHops = std::atoi(value);
+		}
+		else
+		{
+			PrintUsage(argv[0]);
+			return 1;
+		}
+	}
+
+	core::Board board;
+	if (!boardPath.empty())
+	{
+		//スナップショットとして開けなければテキスト形式として読む
+		std::optional<core::Board> loaded;
+		if (const auto snapshot = core::BoardSnapshotView::Open(boardPath))
+		{
+			loaded = snapshot->toBoard();
+		}
+		else
+		{
+			std::ifstream ifs(boardPath);
+			loaded = core::LoadBoardText(ifs);
+		}
+
+		if (!loaded)
+		{
+			std::fprintf(stderr, "failed to load %s\n", boardPath.c_str());
+			return 1;
+		}
+		board = std::move(*loaded);
+	}
+	else
+	{
+		if (!scene)
+		{
+			scene = core::SceneForNodeCount(nodeCount);
+		}
+		board = core::RandomBoard(nodeCount, linkCount < 0 ? 2 * nodeCount : static_cast<size_t>(linkCount), *scene, seed);
+	}
+
+	if (!scene)
+	{
+		scene = core::RectF(0, 0, 1280, 720);
+	}
+
+	using Clock = std::chrono::steady_clock;
+
+	if (multilevel)
+	{
+		const auto multilevelBegin = Clock::now();
+		const auto result = core::MultilevelLayout(board, *scene, params);
+		const double multilevelSeconds = std::chrono::duration<double>(Clock::now() - multilevelBegin).count();
+
+		std::printf("multilevel       %zu levels, nodes", result.nodeCounts.size());
+		for (const size_t count : result.nodeCounts)
+		{
+			std::printf(" %zu", count);
+		}
+		std::printf("\n");
+		std::printf("  evaluations    ");
+		for (const auto count : result.forceEvaluations)
+		{
+			std::printf(" %llu", static_cast<unsigned long long>(count));
+		}
+		std::printf(" (%.0f at full size)\n", result.equivalentEvaluations);
+		std::printf("  elapsed        %.3f s\n", multilevelSeconds);
+	}
+
+	if (threaded && 0 < edits)
+	{
+		PrintUsage(argv[0]);
+		return 1;
+	}
+
+	core::Layout layout(params);
+
+	const auto begin = Clock::now();
+	long long settledFrame = -1;
+	std::uint64_t settledEvaluations = 0;
+	std::uint64_t forceEvaluations = 0;
+	if (threaded)
+	{
+		//一フレームずつ進めさせて、結果が公開されるまで待つ
+		core::LayoutThread simulation(params, true);
+		simulation.send(core::LayoutThread::Reset{ board, *scene });
+		for (long long i = 0; i < steps; ++i)
+		{
+			const std::uint64_t serial = simulation.send(core::LayoutThread::Advance{ 0.0 < fps ? 1.0 / fps : 0.0 });
+			while (simulation.frame().commandSerial < serial)
+			{
+				if (!simulation.receive())
+				{
+					std::this_thread::yield();
+				}
+			}
+
+			if (settledFrame < 0 && simulation.frame().state == core::SimulationState::Settled)
+			{
+				settledFrame = i + 1;
+				settledEvaluations = simulation.frame().forceEvaluations;
+			}
+		}
+
+		const core::LayoutFrame& frame = simulation.frame();
+		for (size_t i = 0; i < board.size() && i < frame.positions.size(); ++i)
+		{
+			board.nodes[i].position = frame.positions[i];
+			board.nodes[i].velocity = frame.velocities[i];
+		}
+		forceEvaluations = frame.forceEvaluations;
+	}
+	else
+	{
+		for (long long i = 0; i < steps; ++i)
+		{
+			layout.resetInvalidNodes(board, *scene);
+			if (0.0 < fps)
+			{
+				layout.advance(board, *scene, 1.0 / fps);
+			}
+			else
+			{
+				layout.update(board, *scene);
+			}
+
+			if (settledFrame < 0 && layout.isSettled())
+			{
+				settledFrame = i + 1;
+				settledEvaluations = layout.forceEvaluations();
+			}
+		}
+		forceEvaluations = layout.forceEvaluations();
+	}
+	const double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+	layout.resetInvalidNodes(board, *scene);
+
+	std::printf("scene            %gx%g\n", scene->size.x, scene->size.y);
+	std::printf("nodes            %zu\n", board.size());
+	std::printf("links            %zu\n", board.adjacents.size());
+	std::printf("kernel           %s\n", core::ToString(core::ResolveForceKernel(params.forceKernel)));
+	std::printf("threads          %zu\n", params.threadCount == 0 ? core::ThreadPool::HardwareThreadCount() : params.threadCount);
+	std::printf("integrator       %s\n", core::ToString(params.integrator));
+	if (0.0 < fps)
+	{
+		std::printf("frames           %lld (%g fps)\n", steps, fps);
+	}
+	else
+	{
+		std::printf("frames           %lld (x%d sub-steps)\n", steps, params.subSteps);
+	}
+	std::printf("elapsed          %.3f s\n", seconds);
+	std::printf("frames/sec       %.1f\n", steps / seconds);
+	std::printf("force evals/sec  %.1f\n", forceEvaluations / seconds);
+	std::printf("kinetic energy   %.6g\n", KineticEnergy(board));
+	if (0 <= settledFrame)
+	{
+		std::printf("settled at frame %lld (%llu force evaluations)\n", settledFrame, static_cast<unsigned long long>(settledEvaluations));
+	}
+	else if (threaded)
+	{
+		std::printf("settled at frame -\n");
+	}
+	else
+	{
+		std::printf("settled at frame - (last step: energy %.6g, max displacement %.6g px)\n", layout.kineticEnergy(), layout.maxDisplacement());
+	}
+	std::printf("layout energy    %.6g\n", LayoutEnergy(board, *scene, params));
+	std::printf("state hash       %016llx\n", static_cast<unsigned long long>(StateHash(board)));
+
+	//一本ずつリンクを足したときに、落ち着くまでにかかるフレーム数と動いたノードの数
+	if (0 < edits)
+	{
+		std::mt19937 rng(seed);
+		long long frames = 0;
+		std::uint64_t evaluations = 0;
+		size_t movedNodes = 0;
+		long long unsettled = 0;
+		long long fallbacks = 0;
+		core::BoardHistory history;
+		const auto linksBefore = SortedEdges(board);
+		const auto editBegin = Clock::now();
+		for (long long i = 0; i < edits; ++i)
+		{
+			const EditResult result = RunEdit(board, layout, *scene, rng, globalEdits, 10 * steps, history);
+			frames += result.frames;
+			evaluations += result.evaluations;
+			movedNodes += result.movedNodes;
+			unsettled += result.isSettled ? 0 : 1;
+			fallbacks += result.fellBack ? 1 : 0;
+		}
+		const double editSeconds = std::chrono::duration<double>(Clock::now() - editBegin).count();
+
+		std::printf("edits            %lld (%s, %d hops)\n", edits, globalEdits ? "global" : "local", params.localHops);
+		std::printf("  frames/edit    %.1f\n", static_cast<double>(frames) / edits);
+		std::printf("  evals/edit     %.1f\n", static_cast<double>(evaluations) / edits);
+		std::printf("  moved/edit     %.1f nodes\n", static_cast<double>(movedNodes) / edits);
+		std::printf("  elapsed/edit   %.3f ms\n", 1000.0 * editSeconds / edits);
+		std::printf("  fallbacks      %lld\n", fallbacks);
+		std::printf("  unsettled      %lld\n", unsettled);
+
+		//履歴を全て戻すと編集前のリンクに、全てやり直すと編集後のリンクに一致するか
+		const auto linksAfter = SortedEdges(board);
+		core::Board replayed = board;
+		while (history.canUndo())
+		{
+			for (const auto& edit : history.undo())
+			{
+				core::ApplyEdit(replayed, edit);
+			}
+		}
+		const bool isUndone = SameEdges(SortedEdges(replayed), linksBefore);
+		while (history.canRedo())
+		{
+			for (const auto& edit : history.redo())
+			{
+				core::ApplyEdit(replayed, edit);
+			}
+		}
+		const bool isRedone = SameEdges(SortedEdges(replayed), linksAfter);
+
+		std::printf("history          %zu steps, %zu bytes\n", history.stepCount(), history.editCount() * sizeof(core::BoardEdit) + history.stepCount() * sizeof(size_t));
+		std::printf("  undo all       %s\n", isUndone ? "ok" : "MISMATCH");
+		std::printf("  redo all       %s\n", isRedone ? "ok" : "MISMATCH");
+		if (!isUndone || !isRedone)
+		{
+			return 1;
+		}
+	}
+
+	if (!savePath.empty())
+	{
+		std::ofstream ofs(savePath);
+		core::SaveBoardText(ofs, board);
+		if (!ofs)
+		{
+			std::fprintf(stderr, "failed to save %s\n", savePath.c_str());
+			return 1;
+		}
+	}
+
+	if (!snapshotPath.empty() && !core::SaveBoardSnapshot(snapshotPath, board, {}))
+	{
+		std::fprintf(stderr, "failed to save %s\n", snapshotPath.c_str());
+		return 1;
+	}
+}
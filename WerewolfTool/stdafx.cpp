@@ -1 +1 @@
-﻿# include "stdafx.h"
+﻿# include "stdafx.h"